@@ -0,0 +1,465 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Per-frame render benchmark for the effect engine.
+// Every effect of every suite is rendered over a sweep of `coeff` values and
+// the time of each individual frame is recorded.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bsp/led.h"
+#include "effect_cache.h"
+#include "effects.h"
+#include "output.h"
+#include "particles.h"
+#include "playlist.h"
+#include "reference_effects.h"
+
+// Largest difference per channel allowed between a cached effect and rendering every frame.
+#define CACHE_TOLERANCE 4
+
+// A set of effects that can be compared side by side.
+typedef struct {
+    // Name printed in the report.
+    char const*   name;
+    // Render one frame of an effect at a given coeff.
+    void (*render)(size_t effect, float coeff);
+    // Number of effects in the suite.
+    size_t const* effects_len;
+} bench_suite_t;
+
+static void render_reference(size_t effect, float coeff) {
+    ref_effects[effect](coeff);
+}
+
+// Framebuffer the fixed-point effects render into.
+static rgb_t fb[LED_COUNT] __attribute__((aligned(4)));
+
+static void render_fixed(size_t effect, float coeff) {
+    effects[effect].render(fb, (phase_t)(coeff * PHASE_ONE));
+}
+
+// Render an effect from the cache, baking it first if needed.
+static void render_cached(size_t effect, float coeff) {
+    effect_cache_prepare(effect);
+    effect_cache_render(effect, fb, (phase_t)(coeff * PHASE_ONE));
+}
+
+// Output stage for the "output" suite, at the lowest brightness the badge can be set to.
+static output_t output;
+
+// Render an effect and map it to LED levels, like the render task does before sending a frame.
+static void render_output(size_t effect, float coeff) {
+    render_fixed(effect, coeff);
+    output_apply(&output, fb, fb, LED_COUNT);
+}
+
+// Render a crossfade halfway between an effect and the next one.
+static void render_crossfade(size_t effect, float coeff) {
+    crossfade_t fade = {
+        .from     = effect,
+        .to       = (effect + 1) % effects_len,
+        .start    = 0,
+        .duration = 2,
+    };
+    crossfade_render(&fade, fb, (phase_t)(coeff * PHASE_ONE), 1);
+}
+
+// All suites to benchmark; the first one is the baseline for relative numbers.
+static bench_suite_t const suites[] = {
+    {"float", render_reference, &ref_effects_len},
+    {"fixed", render_fixed, &effects_len},
+    {"cached", render_cached, &effects_len},
+    {"output", render_output, &effects_len},
+    {"fade", render_crossfade, &effects_len},
+};
+
+// Number of suites.
+static size_t const suites_len = sizeof(suites) / sizeof(bench_suite_t);
+
+// Results for a range of frames.
+typedef struct {
+    double   mean_ns;
+    uint64_t min_ns;
+    uint64_t median_ns;
+    uint64_t max_ns;
+} bench_result_t;
+
+// Get the current time in nanoseconds.
+static inline uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int cmp_u64(void const* a, void const* b) {
+    uint64_t x = *(uint64_t const*)a;
+    uint64_t y = *(uint64_t const*)b;
+    return (x > y) - (x < y);
+}
+
+// Summarize an array of frame times; sorts the array in place.
+static bench_result_t summarize(uint64_t* samples, size_t len) {
+    bench_result_t res = {0};
+    uint64_t       sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum += samples[i];
+    }
+    qsort(samples, len, sizeof(uint64_t), cmp_u64);
+    res.mean_ns   = sum / (double)len;
+    res.min_ns    = samples[0];
+    res.median_ns = samples[len / 2];
+    res.max_ns    = samples[len - 1];
+    return res;
+}
+
+static void print_header() {
+    printf("%-8s %-14s %10s %12s %10s %10s %10s %8s\n", "suite", "effect", "coeff", "ns/frame", "frames/s", "max ns",
+           "jitter ns", "rel");
+}
+
+// Print one result line; jitter is the worst-case frame time relative to the median.
+static void print_result(char const* suite, size_t effect, char const* coeff, bench_result_t res, double baseline) {
+    char effect_str[24];
+    if (effect < effects_len) {
+        snprintf(effect_str, sizeof(effect_str), "%s", effects[effect].name);
+    } else {
+        snprintf(effect_str, sizeof(effect_str), "%zu", effect);
+    }
+    printf("%-8s %-14s %10s %12.1f %10.0f %10lu %10lu", suite, effect_str, coeff, res.mean_ns, 1e9 / res.mean_ns,
+           (unsigned long)res.max_ns, (unsigned long)(res.max_ns - res.median_ns));
+    if (baseline > 0) {
+        printf(" %7.2fx\n", baseline / res.mean_ns);
+    } else {
+        printf(" %8s\n", "-");
+    }
+}
+
+// Compare the fixed-point effects against the float reference over the sweep.
+// Returns the number of effects that exceed `REF_EFFECT_TOLERANCE`.
+static int compare_reference(size_t frames, float sweep_from, float sweep_to) {
+    static uint16_t const levels[] = {0x100, 0xd0, 0x80, 0x1a};
+    uint8_t               expected[sizeof(host_led_data)];
+    uint16_t              brightness = 0x100;
+    int                   failed     = 0;
+
+    printf("%-14s %10s %10s %10s\n", "effect", "max diff", "at coeff", "status");
+    for (size_t e = 0; e < effects_len && e < ref_effects_len; e++) {
+        int   max_diff  = 0;
+        float max_coeff = 0;
+        for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+            brightness     = levels[l];
+            ref_brightness = levels[l] / 256.0f;
+            size_t steps   = (size_t)((sweep_to - sweep_from) * frames);
+            for (size_t f = 0; f <= steps; f++) {
+                float coeff = sweep_from + f / (float)frames;
+                render_reference(e, coeff);
+                uint32_t len = host_led_data_len;
+                memcpy(expected, host_led_data, len);
+                render_fixed(e, coeff);
+                rgb_scale_buf(fb, LED_COUNT, brightness);
+                uint8_t const* actual = (uint8_t const*)fb;
+                for (uint32_t i = 0; i < len && i < sizeof(fb); i++) {
+                    int diff = abs((int)expected[i] - (int)actual[i]);
+                    if (diff > max_diff) {
+                        max_diff  = diff;
+                        max_coeff = coeff;
+                    }
+                }
+            }
+        }
+        bool ok = max_diff <= REF_EFFECT_TOLERANCE;
+        printf("%-14s %10d %10.4f %10s\n", effects[e].name, max_diff, max_coeff, ok ? "ok" : "FAIL");
+        failed += !ok;
+    }
+    ref_brightness = 1;
+    return failed;
+}
+
+// Compare the cached effects against rendering every frame over the sweep.
+// Returns the number of cached effects that exceed `CACHE_TOLERANCE`.
+static int compare_cache(size_t frames, float sweep_from, float sweep_to) {
+    rgb_t expected[LED_COUNT];
+    int   failed = 0;
+
+    printf("\n%-14s %10s %10s %10s (%zu steps)\n", "cached", "max diff", "at coeff", "status", effect_cache_steps());
+    for (size_t e = 0; e < effects_len; e++) {
+        if (!effect_cache_prepare(e)) {
+            continue;
+        }
+        int    max_diff  = 0;
+        float  max_coeff = 0;
+        size_t steps     = (size_t)((sweep_to - sweep_from) * frames);
+        for (size_t f = 0; f <= steps; f++) {
+            float coeff = sweep_from + f / (float)frames;
+            render_fixed(e, coeff);
+            memcpy(expected, fb, sizeof(fb));
+            render_cached(e, coeff);
+            for (size_t i = 0; i < sizeof(fb); i++) {
+                int diff = abs((int)((uint8_t*)expected)[i] - (int)((uint8_t*)fb)[i]);
+                if (diff > max_diff) {
+                    max_diff  = diff;
+                    max_coeff = coeff;
+                }
+            }
+        }
+        bool ok = max_diff <= CACHE_TOLERANCE;
+        printf("%-14s %10d %10.4f %10s\n", effects[e].name, max_diff, max_coeff, ok ? "ok" : "FAIL");
+        failed += !ok;
+    }
+    return failed;
+}
+
+// Check that the dithered output averages out to the level in the lookup table, over every input level.
+// Returns the number of brightness levels with a channel that is off by more than 1/64th of a level on average.
+static int compare_output() {
+    static uint16_t const levels[] = {0x100, 0x80, 0x1a};
+    int                   failed   = 0;
+
+    printf("\n%-14s %10s %10s %10s\n", "output", "max error", "at input", "status");
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        output_t out = {0};
+        output_set_brightness(&out, levels[l]);
+        double max_error = 0;
+        int    max_input = 0;
+        for (int v = 0; v < 256; v++) {
+            // Only levels of at least one are dithered; below that the output is rounded.
+            if (out.lut[v] < 0x100) {
+                continue;
+            }
+            rgb_t    in  = {v, v, v};
+            uint32_t sum = 0;
+            // Not a multiple of 256 frames, so that the carried error does not cancel out exactly.
+            for (size_t f = 0; f < 100; f++) {
+                rgb_t px;
+                output_apply(&out, &in, &px, 1);
+                sum += px.r;
+            }
+            double error = sum / 100.0 - out.lut[v] / 256.0;
+            if (error < 0) {
+                error = -error;
+            }
+            if (error > max_error) {
+                max_error = error;
+                max_input = v;
+            }
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "0x%03x", levels[l]);
+        bool ok = max_error <= 1 / 64.0;
+        printf("%-14s %10.4f %10d %10s\n", name, max_error, max_input, ok ? "ok" : "FAIL");
+        failed += !ok;
+    }
+    return failed;
+}
+
+// Check that the current limiter keeps every frame that is sent within the budget, at full brightness.
+// Returns the number of effects with a frame that is over budget by more than rounding and dithering explain.
+static int compare_limiter(size_t frames, float sweep_from, float sweep_to) {
+    int failed = 0;
+
+    printf("\n%-14s %10s %10s %10s %10s\n", "limiter", "peak mA", "sent mA", "limited", "status");
+    for (size_t e = 0; e < effects_len; e++) {
+        output_t out  = {.budget_ma = CONFIG_LED_CURRENT_BUDGET_MA};
+        uint32_t peak = 0;
+        output_set_brightness(&out, 0x100);
+        size_t steps = (size_t)((sweep_to - sweep_from) * frames);
+        for (size_t f = 0; f <= steps; f++) {
+            render_fixed(e, sweep_from + f / (float)frames);
+            output_apply(&out, fb, fb, LED_COUNT);
+            uint32_t sum_r = 0, sum_g = 0, sum_b = 0;
+            for (size_t i = 0; i < LED_COUNT; i++) {
+                sum_r += fb[i].r << 8;
+                sum_g += fb[i].g << 8;
+                sum_b += fb[i].b << 8;
+            }
+            uint32_t sent = output_estimate_ma(sum_r, sum_g, sum_b, LED_COUNT);
+            peak          = sent > peak ? sent : peak;
+        }
+        // Rounding and dithering can add up to one level per channel.
+        uint32_t slack = output_estimate_ma(LED_COUNT << 8, LED_COUNT << 8, LED_COUNT << 8, 0);
+        bool     ok    = peak <= CONFIG_LED_CURRENT_BUDGET_MA + slack;
+        printf("%-14s %10u %10u %10u %10s\n", effects[e].name, out.stats.max_unlimited_ma, peak,
+               out.stats.limited_frames, ok ? "ok" : "FAIL");
+        failed += !ok;
+    }
+    return failed;
+}
+
+// Time a step and a frame of the particle engine at every power of two of live particles up to `PARTICLES_MAX`.
+static void bench_particles(size_t frames) {
+    static particles_t ps;
+    uint64_t*          update = malloc(sizeof(uint64_t) * frames);
+    uint64_t*          render = malloc(sizeof(uint64_t) * frames);
+    if (!update || !render) {
+        fprintf(stderr, "Out of memory\n");
+        free(update);
+        free(render);
+        return;
+    }
+
+    printf("%-10s %12s %12s %12s %12s %10s\n", "particles", "update ns", "render ns", "ns/frame", "ns/particle",
+           "frames/s");
+    for (size_t n = 1;; n = n * 2 < PARTICLES_MAX ? n * 2 : PARTICLES_MAX) {
+        // Knight rider heads, which never die, so that the count stays the same.
+        ps = (particles_t){.edge = PARTICLE_EDGE_BOUNCE, .bounce = 256, .random = 1};
+        for (size_t i = 0; i < n; i++) {
+            particle_t head = {
+                .pos  = particles_random_range(&ps, 0, PHASE_ONE),
+                .vel  = particles_random_range(&ps, -2 * (int32_t)PHASE_ONE, 2 * PHASE_ONE),
+                .size = PHASE_ONE / 16,
+                .tail = PHASE_ONE / 4,
+                .col  = {0, 204, 255},
+            };
+            particles_add(&ps, &head);
+        }
+        for (size_t f = 0; f < frames; f++) {
+            uint64_t start = now_ns();
+            particles_update(&ps, PHASE_ONE / 256);
+            uint64_t mid = now_ns();
+            particles_render(&ps, fb);
+            update[f] = mid - start;
+            render[f] = now_ns() - mid;
+        }
+        bench_result_t up   = summarize(update, frames);
+        bench_result_t down = summarize(render, frames);
+        double         ns   = up.mean_ns + down.mean_ns;
+        printf("%-10zu %12.1f %12.1f %12.1f %12.1f %10.0f\n", n, up.mean_ns, down.mean_ns, ns, ns / n, 1e9 / ns);
+        if (n == PARTICLES_MAX) {
+            break;
+        }
+    }
+    free(update);
+    free(render);
+}
+
+static void usage(char const* argv0) {
+    fprintf(stderr,
+            "Usage: %s [-n frames] [-s start] [-e end] [-i step] [-v] [-c] [-p]\n"
+            "  -n  Frames rendered per coeff value (default 256)\n"
+            "  -s  First coeff value of the sweep (default 0)\n"
+            "  -e  Last coeff value of the sweep (default 8)\n"
+            "  -i  Coeff increment of the sweep (default 0.25)\n"
+            "  -v  Also report every coeff value separately\n"
+            "  -c  Check the effects against the float reference, and the cache, output stage and current limiter\n"
+            "  -p  Benchmark the particle engine at every power of two of particles up to the pool size\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    size_t frames     = 256;
+    float  sweep_from = 0;
+    float  sweep_to   = 8;
+    float  sweep_step = 0.25f;
+    bool   verbose    = false;
+    bool   compare    = false;
+    bool   particles  = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:e:i:vcph")) != -1) {
+        switch (opt) {
+            case 'n':
+                frames = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                sweep_from = strtof(optarg, NULL);
+                break;
+            case 'e':
+                sweep_to = strtof(optarg, NULL);
+                break;
+            case 'i':
+                sweep_step = strtof(optarg, NULL);
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            case 'c':
+                compare = true;
+                break;
+            case 'p':
+                particles = true;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (frames == 0 || sweep_step <= 0 || sweep_to < sweep_from) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    output_set_brightness(&output, 0x1a);
+    output.budget_ma = CONFIG_LED_CURRENT_BUDGET_MA;
+    if (compare) {
+        int failed  = compare_reference(frames, sweep_from, sweep_to);
+        failed     += compare_cache(frames, sweep_from, sweep_to);
+        failed     += compare_output();
+        failed     += compare_limiter(frames, sweep_from, sweep_to);
+        return failed ? 1 : 0;
+    }
+    if (particles) {
+        bench_particles(frames);
+        return 0;
+    }
+
+    size_t    points  = (size_t)((sweep_to - sweep_from) / sweep_step) + 1;
+    uint64_t* samples = malloc(sizeof(uint64_t) * points * frames);
+    if (!samples) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    // Mean frame time of the baseline suite, per effect.
+    size_t  max_effects = 0;
+    for (size_t s = 0; s < suites_len; s++) {
+        if (*suites[s].effects_len > max_effects) {
+            max_effects = *suites[s].effects_len;
+        }
+    }
+    double* baseline = calloc(max_effects, sizeof(double));
+
+    print_header();
+    for (size_t s = 0; s < suites_len; s++) {
+        bench_suite_t const* suite = &suites[s];
+        for (size_t e = 0; e < *suite->effects_len; e++) {
+            // Warm up caches and branch predictors.
+            for (size_t f = 0; f < frames; f++) {
+                suite->render(e, sweep_from + f * (1.0f / frames));
+            }
+
+            for (size_t p = 0; p < points; p++) {
+                float     coeff = sweep_from + p * sweep_step;
+                uint64_t* out   = samples + p * frames;
+                for (size_t f = 0; f < frames; f++) {
+                    // Step through one coeff increment in small steps, like an animation would.
+                    float    c     = coeff + f * (sweep_step / frames);
+                    uint64_t start = now_ns();
+                    suite->render(e, c);
+                    out[f] = now_ns() - start;
+                }
+                if (verbose) {
+                    char coeff_str[16];
+                    snprintf(coeff_str, sizeof(coeff_str), "%.3f", coeff);
+                    print_result(suite->name, e, coeff_str, summarize(out, frames), 0);
+                }
+            }
+
+            bench_result_t res = summarize(samples, points * frames);
+            if (s == 0) {
+                baseline[e] = res.mean_ns;
+            }
+            print_result(suite->name, e, "all", res, s == 0 ? 0 : baseline[e]);
+        }
+    }
+
+    fprintf(stderr, "%u frames written to the LEDs\n", host_led_writes);
+    free(baseline);
+    free(samples);
+    return 0;
+}
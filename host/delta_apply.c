@@ -0,0 +1,161 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Applies a patch made by tools/mkdelta.py the way the badge does: the patch is fed in randomly sized pieces, like
+// they come out of the HTTP client, and the old image is only read through the same callbacks. A patch compressed
+// with tools/lzpack.py is decompressed on the way. The hashes in the header are left to tools/ota_e2e.sh, which
+// compares the result with the image the patch was made for.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "delta.h"
+#include "lz.h"
+
+// State of the pseudo-random generator.
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+// Get a pseudo-random number; xorshift64.
+static uint32_t rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state >> 32;
+}
+
+// The old image and the new image being written.
+typedef struct {
+    uint8_t* source;
+    size_t   source_len;
+    FILE*    out;
+    uint32_t reads;
+} apply_t;
+
+// Read a range of the old image.
+static esp_err_t read_source(void* ctx, size_t offset, void* buf, size_t len) {
+    apply_t* apply = ctx;
+    if (offset > apply->source_len || len > apply->source_len - offset) {
+        return ESP_FAIL;
+    }
+    memcpy(buf, apply->source + offset, len);
+    apply->reads++;
+    return ESP_OK;
+}
+
+// Append to the new image.
+static esp_err_t write_target(void* ctx, void const* data, size_t len) {
+    apply_t* apply = ctx;
+    return fwrite(data, 1, len, apply->out) == len ? ESP_OK : ESP_FAIL;
+}
+
+// Check that the patch was made against an image of this size.
+static esp_err_t check_header(void* ctx, delta_header_t const* header) {
+    apply_t* apply = ctx;
+    if (header->source_size != apply->source_len) {
+        fprintf(stderr, "Patch is for a %u byte image, not %zu\n", header->source_size, apply->source_len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+// Apply decompressed patch data.
+static esp_err_t feed_delta(void* ctx, void const* data, size_t len) {
+    return delta_feed(ctx, data, len);
+}
+
+// Read a whole file.
+static uint8_t* read_file(char const* path, size_t* len_out) {
+    FILE* fd = fopen(path, "rb");
+    if (!fd) {
+        perror(path);
+        return NULL;
+    }
+    fseek(fd, 0, SEEK_END);
+    long len = ftell(fd);
+    fseek(fd, 0, SEEK_SET);
+    uint8_t* data = malloc(len > 0 ? len : 1);
+    if (data && fread(data, 1, len, fd) != (size_t)len) {
+        perror(path);
+        free(data);
+        data = NULL;
+    }
+    fclose(fd);
+    *len_out = len;
+    return data;
+}
+
+static void usage(char const* argv0) {
+    fprintf(stderr,
+            "Usage: %s [-c max_chunk] [-s seed] old patch new\n"
+            "  -c  Largest piece of the patch fed at once (default 1436)\n"
+            "  -s  Seed for the piece sizes\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    size_t max_chunk = 1436;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:s:h")) != -1) {
+        switch (opt) {
+            case 'c':
+                max_chunk = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                rng_state = strtoull(optarg, NULL, 0) | 1;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 3 || max_chunk == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    apply_t  apply = {0};
+    size_t   patch_len;
+    uint8_t* patch = read_file(argv[optind + 1], &patch_len);
+    apply.source   = read_file(argv[optind], &apply.source_len);
+    if (!apply.source || !patch) {
+        return 1;
+    }
+    apply.out = fopen(argv[optind + 2], "wb");
+    if (!apply.out) {
+        perror(argv[optind + 2]);
+        return 1;
+    }
+
+    static delta_t delta;
+    static lz_t    lz;
+    delta_init(&delta, read_source, write_target, check_header, &apply);
+    lz_init(&lz, feed_delta, &delta);
+    bool      compressed = patch_len >= 4 && !memcmp(patch, LZ_MAGIC, 4);
+    esp_err_t res        = ESP_OK;
+    size_t    pos        = 0;
+    while (res == ESP_OK && pos < patch_len) {
+        size_t chunk = 1 + rng() % max_chunk;
+        chunk        = chunk < patch_len - pos ? chunk : patch_len - pos;
+        res          = compressed ? lz_feed(&lz, patch + pos, chunk) : delta_feed(&delta, patch + pos, chunk);
+        pos         += chunk;
+    }
+    if (res == ESP_OK && compressed) {
+        res = lz_finish(&lz);
+    }
+    if (res == ESP_OK) {
+        res = delta_finish(&delta);
+    }
+    if (fclose(apply.out) && res == ESP_OK) {
+        res = ESP_FAIL;
+    }
+    if (res != ESP_OK) {
+        fprintf(stderr, "Applying the patch failed at byte %zu: error 0x%x\n", pos, res);
+        return 1;
+    }
+    printf("%zu byte%s patch turned %zu bytes into %zu, %u reads of the old image\n", patch_len,
+           compressed ? " compressed" : "", apply.source_len, delta.written, apply.reads);
+    return 0;
+}
@@ -0,0 +1,437 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Renders effects over a timeline of phases without a badge, to see and check what they produce.
+// The frames can be written as a binary trace, as a PNG timeline strip with one column per frame and one row per LED,
+// or shown in a terminal with ANSI colours. With -g, every effect is compared against its golden trace, so a change
+// that alters the output of an effect by more than the tolerance fails; -u writes the golden traces instead.
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include "effects.h"
+
+// Magic bytes at the start of a trace.
+#define TRACE_MAGIC       "BFXT"
+// Version of the trace format.
+#define TRACE_VERSION     1
+// Largest number of frames in a trace.
+#define TRACE_MAX_FRAMES  65536
+// Largest difference per channel allowed against a golden trace by default.
+#define DEFAULT_TOLERANCE 0
+
+// Trace header, followed by `frames` frames; all numbers are little-endian.
+typedef struct __attribute__((packed)) {
+    // Must be `TRACE_MAGIC`.
+    char     magic[4];
+    // Must be `TRACE_VERSION`.
+    uint8_t  version;
+    // Number of LEDs per frame.
+    uint8_t  led_count;
+    // Must be zero.
+    uint8_t  reserved[2];
+    // Number of frames.
+    uint32_t frames;
+} trace_header_t;
+
+// A frame in a trace.
+typedef struct __attribute__((packed)) {
+    // Phase it was rendered at.
+    phase_t phase;
+    // The LEDs.
+    rgb_t   leds[LED_COUNT];
+} trace_frame_t;
+
+// Frames of one effect.
+typedef struct {
+    trace_frame_t* frames;
+    uint32_t       len;
+} trace_t;
+
+// Render `len` frames of an effect from `start` on, `step` apart, or at the phases of `like` if it is not NULL.
+static bool render_trace(size_t effect, phase_t start, phase_t step, uint32_t len, trace_t const* like,
+                         trace_t* trace) {
+    trace->frames = calloc(len ? len : 1, sizeof(trace_frame_t));
+    trace->len    = len;
+    if (!trace->frames) {
+        return false;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        trace->frames[i].phase = like ? like->frames[i].phase : start + i * step;
+        effects[effect].render(trace->frames[i].leds, trace->frames[i].phase);
+    }
+    return true;
+}
+
+// Write a trace.
+static bool write_trace(char const* path, trace_t const* trace) {
+    FILE* fd = fopen(path, "wb");
+    if (!fd) {
+        perror(path);
+        return false;
+    }
+    trace_header_t header = {
+        .magic     = TRACE_MAGIC,
+        .version   = TRACE_VERSION,
+        .led_count = LED_COUNT,
+        .frames    = trace->len,
+    };
+    bool ok = fwrite(&header, sizeof(header), 1, fd) == 1 &&
+              fwrite(trace->frames, sizeof(trace_frame_t), trace->len, fd) == trace->len;
+    ok      = fclose(fd) == 0 && ok;
+    if (!ok) {
+        perror(path);
+    }
+    return ok;
+}
+
+// Read a trace; fails quietly if the file does not exist.
+static bool read_trace(char const* path, trace_t* trace) {
+    FILE* fd = fopen(path, "rb");
+    if (!fd) {
+        return false;
+    }
+    trace_header_t header;
+    bool ok = fread(&header, sizeof(header), 1, fd) == 1 && !memcmp(header.magic, TRACE_MAGIC, 4) &&
+              header.version == TRACE_VERSION && header.led_count == LED_COUNT && header.frames <= TRACE_MAX_FRAMES;
+    trace->frames = ok ? calloc(header.frames ? header.frames : 1, sizeof(trace_frame_t)) : NULL;
+    trace->len    = ok ? header.frames : 0;
+    ok            = trace->frames && fread(trace->frames, sizeof(trace_frame_t), trace->len, fd) == trace->len;
+    fclose(fd);
+    if (!ok) {
+        fprintf(stderr, "%s: not a trace of %d LEDs\n", path, LED_COUNT);
+        free(trace->frames);
+        trace->frames = NULL;
+    }
+    return ok;
+}
+
+// Table for `crc32`.
+static uint32_t crc_table[256];
+
+// Update a CRC-32 as used by PNG.
+static uint32_t crc32(uint32_t crc, uint8_t const* data, size_t len) {
+    if (!crc_table[1]) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            crc_table[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Store a 32-bit number big-endian.
+static void put_be32(uint8_t* out, uint32_t value) {
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+// Write a PNG chunk.
+static bool write_chunk(FILE* fd, char const* type, uint8_t const* data, size_t len) {
+    uint8_t head[8];
+    uint8_t tail[4];
+    put_be32(head, len);
+    memcpy(head + 4, type, 4);
+    put_be32(tail, crc32(crc32(0, head + 4, 4), data, len));
+    return fwrite(head, 1, 8, fd) == 8 && fwrite(data, 1, len, fd) == len && fwrite(tail, 1, 4, fd) == 4;
+}
+
+// Write a trace as a PNG timeline strip: time runs to the right, the first LED is at the top, and every frame is a
+// `zoom` by `zoom` block per LED. The image data is stored without compression, so no zlib is needed.
+static bool write_png(char const* path, trace_t const* trace, uint32_t zoom) {
+    uint32_t width  = trace->len * zoom;
+    uint32_t height = LED_COUNT * zoom;
+    size_t   stride = 1 + width * 3;
+    size_t   raw    = stride * height;
+    // Zlib header, stored blocks of at most 65535 bytes with a 5-byte header each, and the Adler-32.
+    size_t   blocks = raw / 65535 + 1;
+    uint8_t* idat   = malloc(2 + raw + blocks * 5 + 4);
+    uint8_t* pixels = malloc(raw);
+    if (!idat || !pixels || !width) {
+        free(idat);
+        free(pixels);
+        return false;
+    }
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t* row = pixels + y * stride;
+        row[0]       = 0;
+        for (uint32_t x = 0; x < width; x++) {
+            memcpy(row + 1 + x * 3, &trace->frames[x / zoom].leds[y / zoom], 3);
+        }
+    }
+
+    size_t   len = 0;
+    uint32_t a   = 1;
+    uint32_t b   = 0;
+    idat[len++]  = 0x78;
+    idat[len++]  = 0x01;
+    for (size_t pos = 0; pos < raw;) {
+        size_t chunk = raw - pos < 65535 ? raw - pos : 65535;
+        idat[len++]  = pos + chunk == raw;
+        idat[len++]  = chunk;
+        idat[len++]  = chunk >> 8;
+        idat[len++]  = ~chunk;
+        idat[len++]  = ~chunk >> 8;
+        memcpy(idat + len, pixels + pos, chunk);
+        for (size_t i = 0; i < chunk; i++) {
+            a = (a + pixels[pos + i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        len += chunk;
+        pos += chunk;
+    }
+    put_be32(idat + len, b << 16 | a);
+    len += 4;
+
+    uint8_t ihdr[13] = {0};
+    put_be32(ihdr, width);
+    put_be32(ihdr + 4, height);
+    // 8 bits per channel, RGB.
+    ihdr[8] = 8;
+    ihdr[9] = 2;
+
+    FILE* fd = fopen(path, "wb");
+    bool  ok = fd && fwrite("\x89PNG\r\n\x1a\n", 1, 8, fd) == 8 && write_chunk(fd, "IHDR", ihdr, sizeof(ihdr)) &&
+              write_chunk(fd, "IDAT", idat, len) && write_chunk(fd, "IEND", NULL, 0);
+    if (fd) {
+        ok = fclose(fd) == 0 && ok;
+    }
+    if (!ok) {
+        perror(path);
+    }
+    free(idat);
+    free(pixels);
+    return ok;
+}
+
+// Show a trace in the terminal, one frame per line with the LEDs from left to right.
+static void print_ansi(char const* name, trace_t const* trace) {
+    printf("%s\n", name);
+    for (uint32_t i = 0; i < trace->len; i++) {
+        trace_frame_t const* frame = &trace->frames[i];
+        printf("%10.4f ", frame->phase / (double)PHASE_ONE);
+        for (int led = 0; led < LED_COUNT; led++) {
+            printf("\x1b[48;2;%u;%u;%um  ", frame->leds[led].r, frame->leds[led].g, frame->leds[led].b);
+        }
+        printf("\x1b[0m\n");
+    }
+}
+
+// Get the name of the golden trace of an effect.
+static void golden_path(char* out, size_t size, char const* dir, size_t effect) {
+    int len = snprintf(out, size, "%s/", dir);
+    for (char const* c = effects[effect].name; *c && len < (int)size - 7; c++) {
+        out[len++] = isalnum((unsigned char)*c) ? *c : '-';
+    }
+    snprintf(out + len, size - len, ".trace");
+}
+
+// Compare an effect against its golden trace; returns false if it differs by more than `tolerance`.
+static bool check_golden(size_t effect, trace_t const* golden, int tolerance) {
+    trace_t actual;
+    if (!render_trace(effect, 0, 0, golden->len, golden, &actual)) {
+        return false;
+    }
+    int      max_diff   = 0;
+    uint32_t bad_frames = 0;
+    int64_t  first_bad  = -1;
+    int      first_led  = 0;
+    for (uint32_t i = 0; i < golden->len; i++) {
+        uint8_t const* want      = (uint8_t const*)golden->frames[i].leds;
+        uint8_t const* got       = (uint8_t const*)actual.frames[i].leds;
+        bool           frame_bad = false;
+        for (size_t c = 0; c < sizeof(golden->frames[i].leds); c++) {
+            int diff = abs((int)want[c] - (int)got[c]);
+            max_diff = diff > max_diff ? diff : max_diff;
+            if (diff > tolerance && !frame_bad) {
+                frame_bad = true;
+                if (first_bad < 0) {
+                    first_bad = i;
+                    first_led = c / 3;
+                }
+            }
+        }
+        bad_frames += frame_bad;
+    }
+    bool ok = !bad_frames;
+    printf("%-14s %8u %10d %10u", effects[effect].name, golden->len, max_diff, bad_frames);
+    if (ok) {
+        printf(" %10s\n", "ok");
+    } else {
+        trace_frame_t const* frame = &golden->frames[first_bad];
+        printf(" %10s first at frame %" PRId64 " (phase %.4f), LED %d\n", "FAIL", first_bad,
+               frame->phase / (double)PHASE_ONE, first_led);
+    }
+    free(actual.frames);
+    return ok;
+}
+
+// Find an effect by number or name; returns `effects_len` if there is none.
+static size_t find_effect(char const* str) {
+    char* end;
+    long  no = strtol(str, &end, 10);
+    if (!*end) {
+        return no >= 0 && (size_t)no < effects_len ? (size_t)no : effects_len;
+    }
+    for (size_t i = 0; i < effects_len; i++) {
+        if (!strcasecmp(effects[i].name, str)) {
+            return i;
+        }
+    }
+    return effects_len;
+}
+
+static void usage(char const* argv0) {
+    fprintf(stderr,
+            "Usage: %s [-e effect] [-n frames] [-s start] [-d step] [-i trace] [-o trace] [-p png] [-z zoom] [-a]\n"
+            "       %s -g dir [-u] [-t tolerance] [-e effect] [-n frames] [-s start] [-d step]\n"
+            "  -e  Effect number or name (default: all effects)\n"
+            "  -n  Number of frames (default 64)\n"
+            "  -s  Phase of the first frame, in cycles (default 0)\n"
+            "  -d  Phase between frames, in cycles (default 1/32)\n"
+            "  -i  Show a trace instead of rendering\n"
+            "  -o  Write the frames as a binary trace\n"
+            "  -p  Write the frames as a PNG timeline strip\n"
+            "  -z  Size of an LED in the PNG, in pixels (default 4)\n"
+            "  -a  Show the frames in the terminal with ANSI colours\n"
+            "  -g  Compare every effect against its golden trace in this directory\n"
+            "  -u  Write the golden traces instead of comparing\n"
+            "  -t  Largest difference per channel allowed against a golden trace (default %d)\n",
+            argv0, argv0, DEFAULT_TOLERANCE);
+}
+
+int main(int argc, char** argv) {
+    char const* effect_str = NULL;
+    uint32_t    frames     = 64;
+    double      start      = 0;
+    double      step       = 1.0 / 32;
+    char const* in_path    = NULL;
+    char const* out_path   = NULL;
+    char const* png_path   = NULL;
+    uint32_t    zoom       = 4;
+    bool        ansi       = false;
+    char const* golden_dir = NULL;
+    bool        update     = false;
+    int         tolerance  = DEFAULT_TOLERANCE;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "e:n:s:d:i:o:p:z:ag:ut:h")) != -1) {
+        switch (opt) {
+            case 'e':
+                effect_str = optarg;
+                break;
+            case 'n':
+                frames = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                start = strtod(optarg, NULL);
+                break;
+            case 'd':
+                step = strtod(optarg, NULL);
+                break;
+            case 'i':
+                in_path = optarg;
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            case 'p':
+                png_path = optarg;
+                break;
+            case 'z':
+                zoom = strtoul(optarg, NULL, 0);
+                break;
+            case 'a':
+                ansi = true;
+                break;
+            case 'g':
+                golden_dir = optarg;
+                break;
+            case 'u':
+                update = true;
+                break;
+            case 't':
+                tolerance = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    size_t first = 0;
+    size_t last  = effects_len;
+    if (effect_str) {
+        first = find_effect(effect_str);
+        last  = first + 1;
+    }
+    bool single = last - first == 1 || in_path;
+    if (optind != argc || first >= effects_len || !frames || frames > TRACE_MAX_FRAMES || !zoom || zoom > 64 ||
+        (!single && (out_path || png_path))) {
+        usage(argv[0]);
+        return 1;
+    }
+    phase_t start_phase = (phase_t)(int64_t)(start * PHASE_ONE);
+    phase_t step_phase  = (phase_t)(int64_t)(step * PHASE_ONE);
+
+    if (golden_dir) {
+        int failed = 0;
+        if (!update) {
+            printf("%-14s %8s %10s %10s %10s (tolerance %d)\n", "effect", "frames", "max diff", "bad frames",
+                   "status", tolerance);
+        }
+        for (size_t e = first; e < last; e++) {
+            char    path[256];
+            trace_t trace;
+            golden_path(path, sizeof(path), golden_dir, e);
+            if (update) {
+                bool ok = render_trace(e, start_phase, step_phase, frames, NULL, &trace) && write_trace(path, &trace);
+                printf("%s: %s\n", path, ok ? "written" : "FAILED");
+                failed += !ok;
+            } else if (!read_trace(path, &trace)) {
+                printf("%-14s %8s %10s %10s %10s\n", effects[e].name, "-", "-", "-", "MISSING");
+                failed++;
+                continue;
+            } else {
+                failed += !check_golden(e, &trace, tolerance);
+            }
+            free(trace.frames);
+        }
+        return failed ? 1 : 0;
+    }
+
+    for (size_t e = first; e < last; e++) {
+        trace_t trace;
+        bool ok = in_path ? read_trace(in_path, &trace)
+                          : render_trace(e, start_phase, step_phase, frames, NULL, &trace);
+        if (!ok) {
+            return 1;
+        }
+        char const* name = in_path ? in_path : effects[e].name;
+        if (ansi || (!out_path && !png_path)) {
+            print_ansi(name, &trace);
+        }
+        if ((out_path && !write_trace(out_path, &trace)) || (png_path && !write_png(png_path, &trace, zoom))) {
+            return 1;
+        }
+        free(trace.frames);
+        if (in_path) {
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,22 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Host stand-in for the badge BSP LED driver.
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Largest frame the stand-in driver can record.
+#define HOST_LED_DATA_MAX 4096
+
+// Write raw LED data; on the host this only records the frame.
+esp_err_t bsp_led_write(uint8_t* data, uint32_t length);
+
+// Number of times `bsp_led_write` was called.
+extern uint32_t host_led_writes;
+// Copy of the most recently written LED data.
+extern uint8_t  host_led_data[HOST_LED_DATA_MAX];
+// Length of the most recently written LED data.
+extern uint32_t host_led_data_len;
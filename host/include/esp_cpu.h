@@ -0,0 +1,21 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Host stand-in for ESP-IDF's CPU functions; nanoseconds stand in for CPU cycles.
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// Get the cycle counter of the current core; on the host, the monotonic clock in nanoseconds.
+static inline uint32_t esp_cpu_get_cycle_count() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Get the number of the current core.
+static inline int esp_cpu_get_core_id() {
+    return 0;
+}
@@ -0,0 +1,29 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Host stand-in for the generated sdkconfig.h, with the Kconfig defaults.
+
+#pragma once
+
+#define CONFIG_RENDER_FPS            60
+#define CONFIG_POV_COLUMN_PERIOD_US  500
+#define CONFIG_POV_MAX_COLUMNS       256
+#define CONFIG_PLAYER_BUFFER_COLUMNS 64
+#define CONFIG_EFFECT_CACHE_SIZE     16384
+#define CONFIG_EFFECT_CACHE_LERP     1
+#define CONFIG_LED_COUNT             16
+#define CONFIG_LED_LAYOUT_STRIP      1
+#define CONFIG_LED_ORDER_RGB         1
+#define CONFIG_LED_GAMMA_X100        220
+#define CONFIG_LED_DITHER            1
+#define CONFIG_LED_CURRENT_BUDGET_MA 350
+#define CONFIG_LED_MA_RED            12
+#define CONFIG_LED_MA_GREEN          12
+#define CONFIG_LED_MA_BLUE           12
+#define CONFIG_LED_UA_IDLE           600
+#define CONFIG_PARTICLES_MAX         64
+
+// The performance counters are on for the host tools; the host counts nanoseconds instead of cycles.
+#define CONFIG_PERF_COUNTERS            1
+#define CONFIG_PERF_TRACE_EVENTS        4096
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 1000
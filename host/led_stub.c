@@ -0,0 +1,23 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include <string.h>
+#include "bsp/led.h"
+
+// Number of times `bsp_led_write` was called.
+uint32_t host_led_writes;
+// Copy of the most recently written LED data.
+uint8_t  host_led_data[HOST_LED_DATA_MAX];
+// Length of the most recently written LED data.
+uint32_t host_led_data_len;
+
+// Write raw LED data; on the host this only records the frame.
+esp_err_t bsp_led_write(uint8_t* data, uint32_t length) {
+    if (length > HOST_LED_DATA_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(host_led_data, data, length);
+    host_led_data_len = length;
+    host_led_writes++;
+    return ESP_OK;
+}
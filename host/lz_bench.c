@@ -0,0 +1,173 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Round-trip test and throughput benchmark of the update decompressor.
+// A stream made by tools/lzpack.py is decompressed in randomly sized pieces and compared with the original, a stream
+// cut short must be refused, and then the stream is decompressed repeatedly in `OTA_BUFFER_SIZE` pieces, the way
+// updates are received, to measure throughput.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "lz.h"
+
+// Size of the pieces updates are received in, see wifi_ota.c.
+#define OTA_BUFFER_SIZE 1024
+
+// State of the pseudo-random generator.
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+// Get a pseudo-random number; xorshift64.
+static uint32_t rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state >> 32;
+}
+
+// Get the current time in nanoseconds.
+static inline uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Decompressed data collected so far.
+typedef struct {
+    uint8_t* data;
+    size_t   len;
+    size_t   cap;
+    uint32_t writes;
+} output_t;
+
+// Collect decompressed data.
+static esp_err_t collect(void* ctx, void const* data, size_t len) {
+    output_t* output = ctx;
+    if (len > output->cap - output->len) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(output->data + output->len, data, len);
+    output->len += len;
+    output->writes++;
+    return ESP_OK;
+}
+
+// Discard decompressed data.
+static esp_err_t discard(void* ctx, void const* data, size_t len) {
+    return ESP_OK;
+}
+
+// Decompress a stream in pieces of up to `max_chunk` bytes; random sizes if `random` is set.
+static esp_err_t decompress(lz_t* lz, uint8_t const* data, size_t len, size_t max_chunk, bool random) {
+    esp_err_t res = ESP_OK;
+    for (size_t pos = 0; res == ESP_OK && pos < len;) {
+        size_t chunk = random ? 1 + rng() % max_chunk : max_chunk;
+        chunk        = chunk < len - pos ? chunk : len - pos;
+        res          = lz_feed(lz, data + pos, chunk);
+        pos         += chunk;
+    }
+    return res == ESP_OK ? lz_finish(lz) : res;
+}
+
+// Read a whole file.
+static uint8_t* read_file(char const* path, size_t* len_out) {
+    FILE* fd = fopen(path, "rb");
+    if (!fd) {
+        perror(path);
+        return NULL;
+    }
+    fseek(fd, 0, SEEK_END);
+    long len = ftell(fd);
+    fseek(fd, 0, SEEK_SET);
+    uint8_t* data = malloc(len > 0 ? len : 1);
+    if (data && fread(data, 1, len, fd) != (size_t)len) {
+        perror(path);
+        free(data);
+        data = NULL;
+    }
+    fclose(fd);
+    *len_out = len;
+    return data;
+}
+
+static void usage(char const* argv0) {
+    fprintf(stderr,
+            "Usage: %s [-n repeats] [-c max_chunk] compressed original\n"
+            "  -n  Number of times the stream is decompressed for the benchmark (default 20)\n"
+            "  -c  Largest piece fed at once in the round-trip test (default 1436)\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    uint32_t repeats   = 20;
+    size_t   max_chunk = 1436;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:c:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                repeats = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                max_chunk = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 2 || max_chunk == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    size_t   packed_len;
+    size_t   original_len;
+    uint8_t* packed   = read_file(argv[optind], &packed_len);
+    uint8_t* original = read_file(argv[optind + 1], &original_len);
+    output_t output   = {.data = malloc(original_len + 1), .cap = original_len};
+    if (!packed || !original || !output.data) {
+        return 1;
+    }
+
+    // Round trip.
+    static lz_t lz;
+    lz_init(&lz, collect, &output);
+    esp_err_t res = decompress(&lz, packed, packed_len, max_chunk, true);
+    if (res != ESP_OK) {
+        fprintf(stderr, "Decompressing failed: error 0x%x\n", res);
+        return 1;
+    }
+    if (output.len != original_len || memcmp(output.data, original, original_len)) {
+        fprintf(stderr, "Decompressed %zu bytes that differ from the %zu byte original\n", output.len, original_len);
+        return 1;
+    }
+
+    // A stream that is cut short.
+    output.len = 0;
+    lz_init(&lz, collect, &output);
+    if (packed_len > sizeof(lz_header_t) && decompress(&lz, packed, packed_len - 1, max_chunk, true) == ESP_OK) {
+        fprintf(stderr, "A stream without its last byte was accepted\n");
+        return 1;
+    }
+    printf("Round trip: %zu bytes from %zu (%.1f%%), %u writes\n", original_len, packed_len,
+           100.0 * packed_len / (original_len ? original_len : 1), output.writes);
+
+    // Throughput.
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < repeats; i++) {
+        lz_init(&lz, discard, NULL);
+        if (decompress(&lz, packed, packed_len, OTA_BUFFER_SIZE, false) != ESP_OK) {
+            return 1;
+        }
+    }
+    double secs = (now_ns() - start) / 1e9;
+    if (repeats && secs > 0) {
+        printf("Throughput: %.1f MB/s out, %.1f MB/s in\n", repeats * original_len / secs / 1e6,
+               repeats * packed_len / secs / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,565 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Downloads an update from tools/ota_server.py and installs it into a simulated update partition, the way the badge
+// does, to test interrupted downloads: run the server with --cut and every cut connection is retried with a range
+// request, and with -r the badge also loses power between attempts and continues from the stored progress.
+// The installed image must equal the expected one. With -m the manifest is checked first, on the connection the
+// download then continues on, and nothing is downloaded if it offers the running version. Exits with 2 if the running
+// version is offered, by the manifest or the download.
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <netdb.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "manifest.h"
+#include "ota_stream.h"
+
+// Size of the simulated update partition.
+#define PARTITION_SIZE (1792 * 1024)
+// Size of the buffer downloads are received in, see wifi_ota.c.
+#define BUFFER_SIZE    1024
+
+// State of the pseudo-random generator.
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+// Get a pseudo-random number; xorshift64.
+static uint32_t rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state >> 32;
+}
+
+// The simulated badge; everything but the partitions and `saved` is lost when it loses power.
+typedef struct {
+    // The running firmware.
+    uint8_t*     running;
+    size_t       running_len;
+    // The update partition; erased bytes are 0xff.
+    uint8_t*     update;
+    // Position of the next write to `update`, or -1 if no write was begun.
+    int64_t      write_pos;
+    // Size of the image being written.
+    uint32_t     write_size;
+    // The image the update must install.
+    uint8_t*     expected;
+    size_t       expected_len;
+    // SHA-256 the manifest lists for the image, which `end` must be asked to check; all zeroes without a manifest.
+    uint8_t      manifest_sha256[32];
+    // Stored progress.
+    ota_resume_t saved;
+    bool         have_saved;
+    // Whether the update was installed.
+    bool         installed;
+    // Statistics.
+    uint32_t     saves;
+    uint32_t     erased_sectors;
+} badge_t;
+
+// Response headers of a request.
+typedef struct {
+    int     status;
+    int64_t content_length;
+    char    content_range[64];
+    char    etag[64];
+    char    last_modified[64];
+    // Whether the server closes the connection after the response.
+    bool    close;
+} response_t;
+
+// Read from the running firmware.
+static esp_err_t badge_read_running(void* ctx, size_t offset, void* buf, size_t len) {
+    badge_t* badge = ctx;
+    if (offset > badge->running_len || len > badge->running_len - offset) {
+        return ESP_FAIL;
+    }
+    memcpy(buf, badge->running + offset, len);
+    return ESP_OK;
+}
+
+// Read from the update partition.
+static esp_err_t badge_read_update(void* ctx, size_t offset, void* buf, size_t len) {
+    badge_t* badge = ctx;
+    if (offset > PARTITION_SIZE || len > PARTITION_SIZE - offset) {
+        return ESP_FAIL;
+    }
+    memcpy(buf, badge->update + offset, len);
+    return ESP_OK;
+}
+
+// Only checks the size; the hashes are left to comparing the result with the expected image.
+static esp_err_t badge_check_source(void* ctx, delta_header_t const* header) {
+    badge_t* badge = ctx;
+    return header->source_size == badge->running_len ? ESP_OK : ESP_ERR_INVALID_VERSION;
+}
+
+// Erases like `esp_ota_begin`, which erases the whole partition if the size is not known, and, when resuming, like
+// `esp_ota_resume` with sequential writes.
+static esp_err_t badge_begin(void* ctx, uint32_t size, uint32_t offset) {
+    badge_t* badge = ctx;
+    size           = size ? size : PARTITION_SIZE;
+    if (size > PARTITION_SIZE || offset > size || offset % OTA_SECTOR_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t end = (size + OTA_SECTOR_SIZE - 1) / OTA_SECTOR_SIZE * OTA_SECTOR_SIZE;
+    memset(badge->update + offset, 0xff, end - offset);
+    badge->erased_sectors += (end - offset) / OTA_SECTOR_SIZE;
+    badge->write_pos       = offset;
+    badge->write_size      = size;
+    return ESP_OK;
+}
+
+// Writes like flash does: only erased bytes can be written.
+static esp_err_t badge_write(void* ctx, void const* data, size_t len) {
+    badge_t* badge = ctx;
+    if (badge->write_pos < 0 || len > badge->write_size - badge->write_pos) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (badge->update[badge->write_pos + i] != 0xff) {
+            fprintf(stderr, "Write to unerased flash at %" PRId64 "\n", badge->write_pos + (int64_t)i);
+            return ESP_FAIL;
+        }
+    }
+    memcpy(badge->update + badge->write_pos, data, len);
+    badge->write_pos += len;
+    return ESP_OK;
+}
+
+// Stop writing, leaving what was written.
+static void badge_abort(void* ctx) {
+    badge_t* badge   = ctx;
+    badge->write_pos = -1;
+}
+
+// Stands in for `esp_ota_end`, which validates the image, and for the hash check; the hash itself is left to comparing
+// the result with the expected image, but it must be the one in the manifest, also for continued downloads.
+static esp_err_t badge_end(void* ctx, uint8_t const* sha256) {
+    badge_t*      badge    = ctx;
+    uint8_t const none[32] = {0};
+    int64_t       written  = badge->write_pos;
+    badge->write_pos       = -1;
+    if (memcmp(badge->manifest_sha256, none, sizeof(none)) &&
+        (!sha256 || memcmp(sha256, badge->manifest_sha256, sizeof(badge->manifest_sha256)))) {
+        fprintf(stderr, "Not asked to check the hash in the manifest\n");
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (written != (int64_t)badge->expected_len || memcmp(badge->update, badge->expected, badge->expected_len)) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    badge->installed = true;
+    return ESP_OK;
+}
+
+// Store progress; it survives power losses.
+static void badge_save(void* ctx, ota_resume_t const* resume) {
+    badge_t* badge    = ctx;
+    badge->have_saved = resume != NULL;
+    if (resume) {
+        badge->saved = *resume;
+        badge->saves++;
+    }
+}
+
+// Progress is not shown.
+static void badge_progress(void* ctx, ota_stream_kind_t kind, int percent) {
+}
+
+// How the simulated badge installs updates.
+static ota_stream_io_t const io = {
+    .read_running = badge_read_running,
+    .read_update  = badge_read_update,
+    .check_source = badge_check_source,
+    .begin        = badge_begin,
+    .write        = badge_write,
+    .abort        = badge_abort,
+    .end          = badge_end,
+    .save         = badge_save,
+    .progress     = badge_progress,
+};
+
+// Parsed `http://host:port/path` URL.
+typedef struct {
+    char host[64];
+    char port[8];
+    char path[128];
+} url_t;
+
+// Parse a URL.
+static bool parse_url(char const* str, url_t* url) {
+    strcpy(url->port, "80");
+    if (sscanf(str, "http://%63[^:/]:%7[0-9]%127s", url->host, url->port, url->path) == 3) {
+        return true;
+    }
+    return sscanf(str, "http://%63[^:/]%127s", url->host, url->path) == 2;
+}
+
+// Statistics of a simulated update.
+typedef struct {
+    uint32_t connections;
+    uint32_t requests;
+    uint32_t ranged;
+    uint64_t downloaded;
+} stats_t;
+
+// Connect.
+static int http_connect(url_t const* url) {
+    struct addrinfo  hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    struct addrinfo* addr;
+    if (getaddrinfo(url->host, url->port, &hints, &addr)) {
+        return -1;
+    }
+    int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (fd >= 0 && connect(fd, addr->ai_addr, addr->ai_addrlen)) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(addr);
+    if (fd < 0) {
+        return -1;
+    }
+    struct timeval timeout = {.tv_sec = 5};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+// Send a request for `path`, on the open connection in `fd` if there is one.
+static bool http_request(url_t const* url, char const* path, int* fd, char const* headers, stats_t* stats) {
+    char request[1024];
+    int  len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\n%s\r\n", path, url->host, headers);
+    stats->requests++;
+    if (*fd >= 0 && send(*fd, request, len, MSG_NOSIGNAL) == len) {
+        return true;
+    }
+    if (*fd >= 0) {
+        close(*fd);
+    }
+    *fd = http_connect(url);
+    if (*fd < 0) {
+        return false;
+    }
+    stats->connections++;
+    return send(*fd, request, len, MSG_NOSIGNAL) == len;
+}
+
+// Read the response headers.
+static bool http_response(int fd, response_t* response) {
+    memset(response, 0, sizeof(response_t));
+    response->content_length = -1;
+    char line[256];
+    for (int line_no = 0;; line_no++) {
+        size_t len = 0;
+        char   c   = 0;
+        while (recv(fd, &c, 1, 0) == 1 && c != '\n') {
+            if (len < sizeof(line) - 1 && c != '\r') {
+                line[len++] = c;
+            }
+        }
+        if (c != '\n') {
+            return false;
+        }
+        line[len] = 0;
+        if (!len) {
+            return line_no > 0;
+        }
+        if (line_no == 0) {
+            if (sscanf(line, "HTTP/%*s %d", &response->status) != 1) {
+                return false;
+            }
+        } else if (!strncasecmp(line, "Content-Length: ", 16)) {
+            response->content_length = strtoll(line + 16, NULL, 10);
+        } else if (!strncasecmp(line, "Content-Range: ", 15)) {
+            snprintf(response->content_range, sizeof(response->content_range), "%.63s", line + 15);
+        } else if (!strncasecmp(line, "ETag: ", 6)) {
+            snprintf(response->etag, sizeof(response->etag), "%.63s", line + 6);
+        } else if (!strncasecmp(line, "Last-Modified: ", 15)) {
+            snprintf(response->last_modified, sizeof(response->last_modified), "%.63s", line + 15);
+        } else if (!strcasecmp(line, "Connection: close")) {
+            response->close = true;
+        }
+    }
+}
+
+// Receives the body of a response.
+typedef esp_err_t (*body_sink_t)(void* ctx, void const* data, size_t len);
+
+// Read the body of a response into `sink`, and close the connection unless it can be used for the next request.
+// Returns `ESP_FAIL` if the body was cut off.
+static esp_err_t http_body(int* fd, response_t const* response, body_sink_t sink, void* ctx, stats_t* stats) {
+    int64_t   body = 0;
+    esp_err_t res  = ESP_OK;
+    while (res == ESP_OK && (response->content_length < 0 || body < response->content_length)) {
+        uint8_t buf[BUFFER_SIZE];
+        size_t  want = sizeof(buf);
+        if (response->content_length >= 0 && (uint64_t)(response->content_length - body) < want) {
+            want = response->content_length - body;
+        }
+        ssize_t got = recv(*fd, buf, want, 0);
+        if (got < 0) {
+            res = ESP_FAIL;
+        } else if (got == 0) {
+            break;
+        } else {
+            body              += got;
+            stats->downloaded += got;
+            res                = sink(ctx, buf, got);
+        }
+    }
+    if (res == ESP_OK && response->content_length >= 0 && body != response->content_length) {
+        // Cut off.
+        res = ESP_FAIL;
+    }
+    if (res != ESP_OK || response->content_length < 0 || response->close) {
+        close(*fd);
+        *fd = -1;
+    }
+    return res;
+}
+
+// Install part of the download.
+static esp_err_t feed_stream(void* ctx, void const* data, size_t len) {
+    return ota_stream_feed(ctx, data, len);
+}
+
+// Make one request and install what it returns, like `ota_request` in wifi_ota.c.
+static esp_err_t fetch(url_t const* url, int* fd, ota_stream_t* stream, bool ask_delta, bool ask_compression,
+                       stats_t* stats) {
+    char        headers[512];
+    char const* if_range;
+    uint32_t    offset = ota_stream_range(stream, &if_range);
+    size_t      len    = snprintf(headers, sizeof(headers), "Badge-Firmware: %.32s\r\n", stream->running_version);
+    if (ask_delta && !stream->resumed) {
+        len += snprintf(headers + len, sizeof(headers) - len, "Badge-Delta: %s\r\n", DELTA_MAGIC);
+    }
+    if (ask_compression && !stream->resumed) {
+        len += snprintf(headers + len, sizeof(headers) - len, "Badge-Compression: %s\r\n", LZ_MAGIC);
+    }
+    if (offset) {
+        len += snprintf(headers + len, sizeof(headers) - len, "Range: bytes=%" PRIu32 "-\r\nIf-Range: %s\r\n", offset,
+                        if_range);
+        stats->ranged++;
+    }
+
+    response_t response;
+    if (!http_request(url, url->path, fd, headers, stats) || !http_response(*fd, &response)) {
+        close(*fd);
+        *fd = -1;
+        return ESP_FAIL;
+    }
+    esp_err_t res = ota_stream_response(stream, response.status, response.content_length,
+                                        response.content_range[0] ? response.content_range : NULL,
+                                        response.etag[0] ? response.etag : NULL,
+                                        response.last_modified[0] ? response.last_modified : NULL);
+    if (res != ESP_OK) {
+        close(*fd);
+        *fd = -1;
+        return res;
+    }
+    res = http_body(fd, &response, feed_stream, stream, stats);
+    return res == ESP_OK ? ota_stream_finish(stream) : res;
+}
+
+// A manifest being received.
+typedef struct {
+    uint8_t data[MANIFEST_MAX_SIZE];
+    size_t  len;
+} manifest_buf_t;
+
+// Append to the manifest.
+static esp_err_t feed_manifest(void* ctx, void const* data, size_t len) {
+    manifest_buf_t* manifest = ctx;
+    if (len > sizeof(manifest->data) - manifest->len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(manifest->data + manifest->len, data, len);
+    manifest->len += len;
+    return ESP_OK;
+}
+
+// Fetch the manifest next to `url` and find the channel `url` is the image of, like `ota_check_manifest` in
+// wifi_ota.c.
+static esp_err_t fetch_manifest(url_t const* url, int* fd, char const* running_version, manifest_entry_t* entry,
+                                stats_t* stats) {
+    char        path[sizeof(url->path)];
+    char        channel[32];
+    char const* name = strrchr(url->path, '/') + 1;
+    snprintf(path, sizeof(path), "%.*s%s", (int)(name - url->path), url->path, MANIFEST_NAME);
+    snprintf(channel, sizeof(channel), "%.*s", (int)strcspn(name, "."), name);
+
+    response_t response;
+    if (!http_request(url, path, fd, "", stats) || !http_response(*fd, &response)) {
+        close(*fd);
+        *fd = -1;
+        return ESP_FAIL;
+    }
+    manifest_buf_t manifest = {0};
+    esp_err_t      res      = http_body(fd, &response, feed_manifest, &manifest, stats);
+    if (res == ESP_OK && response.status != 200) {
+        res = ESP_ERR_NOT_FOUND;
+    }
+    return res == ESP_OK ? manifest_find(manifest.data, manifest.len, channel, running_version, entry) : res;
+}
+
+// Read a whole file.
+static uint8_t* read_file(char const* path, size_t* len_out) {
+    FILE* fd = fopen(path, "rb");
+    if (!fd) {
+        perror(path);
+        return NULL;
+    }
+    fseek(fd, 0, SEEK_END);
+    long len = ftell(fd);
+    fseek(fd, 0, SEEK_SET);
+    uint8_t* data = malloc(len > 0 ? len : 1);
+    if (data && fread(data, 1, len, fd) != (size_t)len) {
+        perror(path);
+        free(data);
+        data = NULL;
+    }
+    fclose(fd);
+    *len_out = len;
+    return data;
+}
+
+static void usage(char const* argv0) {
+    fprintf(stderr,
+            "Usage: %s [-r percent] [-b boots] [-p] [-m] [-s seed] url running expected\n"
+            "  -r  Chance that the badge loses power after a failed attempt, in percent (default 0)\n"
+            "  -b  Largest number of times the update is started (default 20)\n"
+            "  -p  Ask for plain images only, no patches or compression\n"
+            "  -m  Check the manifest first\n"
+            "  -s  Seed for the power losses\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    uint32_t reboot_percent = 0;
+    uint32_t max_boots      = 20;
+    bool     negotiate      = true;
+    bool     check_manifest = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:b:pms:h")) != -1) {
+        switch (opt) {
+            case 'r':
+                reboot_percent = strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                max_boots = strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                negotiate = false;
+                break;
+            case 'm':
+                check_manifest = true;
+                break;
+            case 's':
+                rng_state = strtoull(optarg, NULL, 0) | 1;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    url_t url;
+    if (argc - optind != 3 || !parse_url(argv[optind], &url)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    badge_t badge = {.write_pos = -1, .update = malloc(PARTITION_SIZE)};
+    badge.running  = read_file(argv[optind + 1], &badge.running_len);
+    badge.expected = read_file(argv[optind + 2], &badge.expected_len);
+    if (!badge.running || !badge.expected || !badge.update || badge.running_len < OTA_APP_DESC_OFFSET + 48) {
+        return 1;
+    }
+    memset(badge.update, 0xff, PARTITION_SIZE);
+    char running_version[33] = {0};
+    memcpy(running_version, badge.running + OTA_APP_DESC_OFFSET + 16, 32);
+
+    stats_t   stats    = {0};
+    uint64_t  waited   = 0;
+    uint32_t  boots    = 0;
+    uint32_t  attempts = 0;
+    esp_err_t res      = ESP_FAIL;
+    bool      current  = false;
+    while (!badge.installed && !current && boots < max_boots) {
+        boots++;
+        int          fd = -1;
+        ota_stream_t stream;
+        ota_stream_init(&stream, &io, &badge, argv[optind], running_version, badge.have_saved ? &badge.saved : NULL);
+        bool ask_delta = negotiate;
+        if (check_manifest) {
+            manifest_entry_t entry;
+            esp_err_t        manifest_res = fetch_manifest(&url, &fd, running_version, &entry, &stats);
+            if (manifest_res == ESP_OK && manifest_is_current(&entry, running_version)) {
+                current = true;
+                ota_stream_close(&stream, ESP_OK);
+                break;
+            } else if (manifest_res == ESP_OK) {
+                ask_delta = ask_delta && entry.has_delta;
+                ota_stream_expect(&stream, entry.size, entry.version, entry.sha256);
+                memcpy(badge.manifest_sha256, entry.sha256, sizeof(badge.manifest_sha256));
+            } else {
+                fprintf(stderr, "No manifest (error 0x%x), downloading anyway\n", manifest_res);
+            }
+        }
+        bool power_lost = false;
+        for (uint32_t attempt = 0; attempt < OTA_MAX_ATTEMPTS; attempt++) {
+            if (attempt) {
+                waited += ota_stream_backoff_ms(attempt, rng());
+            }
+            attempts++;
+            res     = fetch(&url, &fd, &stream, ask_delta, negotiate, &stats);
+            current = stream.current;
+            if (!ota_stream_retryable(res)) {
+                break;
+            }
+            if (rng() % 100 < reboot_percent) {
+                power_lost = true;
+                break;
+            }
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (power_lost) {
+            // Everything in memory is gone; only the partition and the stored progress remain.
+            free(stream.delta);
+            free(stream.lz);
+            badge.write_pos = -1;
+            continue;
+        }
+        ota_stream_close(&stream, res);
+        if (!ota_stream_retryable(res)) {
+            break;
+        }
+    }
+
+    printf("%s after %u boots and %u requests (%u ranged) on %u connections, %" PRIu64
+           " bytes downloaded for a %zu byte image\n",
+           badge.installed ? "Installed" : current ? "Already up to date" : "Not installed", boots, stats.requests,
+           stats.ranged, stats.connections, stats.downloaded, badge.expected_len);
+    printf("%u progress saves, %u sectors erased, %.1f s spent waiting between attempts\n", badge.saves,
+           badge.erased_sectors, waited / 1000.0);
+    if (current) {
+        return 2;
+    }
+    if (!badge.installed) {
+        fprintf(stderr, "Update failed: error 0x%x\n", res);
+        return 1;
+    }
+    if (badge.have_saved) {
+        fprintf(stderr, "Progress still stored after the update was installed\n");
+        return 1;
+    }
+    return 0;
+}
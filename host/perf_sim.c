@@ -0,0 +1,123 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Runs the render path of the badge through the performance counters: every effect renders frames that go through the
+// output stage and the LED stub, timed like the render task times them. Prints the counters, and writes the trace for
+// tools/perftrace.py with -o. Input and NVS do not exist on the host, so those stages stay empty.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "bsp/led.h"
+#include "effects.h"
+#include "output.h"
+#include "perf.h"
+
+// Get the current time in microseconds.
+static int64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Write the trace to `path`.
+static bool write_trace(char const* path) {
+    size_t   size = perf_trace_size();
+    uint8_t* buf  = malloc(size);
+    FILE*    fd   = fopen(path, "wb");
+    if (!buf || !fd) {
+        perror(path);
+        free(buf);
+        if (fd) {
+            fclose(fd);
+        }
+        return false;
+    }
+    size    = perf_trace_read(buf, size);
+    bool ok = fwrite(buf, 1, size, fd) == size;
+    ok      = !fclose(fd) && ok;
+    free(buf);
+    return ok;
+}
+
+// Print the usage.
+static void usage(char const* argv0) {
+    fprintf(stderr,
+            "Usage: %s [-n frames] [-r] [-H] [-o trace]\n"
+            "  -n  Frames per effect (default 120)\n"
+            "  -r  Render at the badge's frame rate instead of as fast as possible\n"
+            "  -H  Print the histograms too\n"
+            "  -o  Write the trace for tools/perftrace.py\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    uint32_t    frames     = 120;
+    bool        real_time  = false;
+    bool        histograms = false;
+    char const* out_path   = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:rHo:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                frames = strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                real_time = true;
+                break;
+            case 'H':
+                histograms = true;
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc || !frames) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    output_t output = {0};
+    output_set_brightness(&output, 0x100);
+    output.budget_ma = CONFIG_LED_CURRENT_BUDGET_MA;
+
+    rgb_t   fb[LED_COUNT];
+    int64_t frame_time = now_us();
+    for (size_t effect = 0; effect < effects_len; effect++) {
+        for (uint32_t frame = 0; frame < frames; frame++) {
+            if (real_time) {
+                frame_time += 1000000 / CONFIG_RENDER_FPS;
+                int64_t wait = frame_time - now_us();
+                if (wait > 0) {
+                    usleep(wait);
+                }
+            }
+            PERF_START(render_start);
+            effects[effect].render(fb, (phase_t)(frame * PHASE_ONE / 64));
+            PERF_END(PERF_RENDER, render_start);
+            PERF_START(output_start);
+            output_apply(&output, fb, fb, LED_COUNT);
+            PERF_END(PERF_OUTPUT, output_start);
+            PERF_START(write_start);
+            bsp_led_write((uint8_t*)fb, sizeof(fb));
+            PERF_END(PERF_LED_WRITE, write_start);
+        }
+    }
+
+    perf_print_counters();
+    if (histograms) {
+        perf_print_histograms();
+    }
+    if (out_path && !write_trace(out_path)) {
+        return 1;
+    }
+    return 0;
+}
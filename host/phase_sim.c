@@ -0,0 +1,153 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Fast-forwards the render loop's phase clock through weeks of uptime.
+// Every frame's phase is checked against an exact 128-bit reference, and every frame-to-frame step against the exact
+// step for the time between the frames: it may only be rounded, never drift. The old per-frame float accumulator is
+// run alongside for comparison.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "sdkconfig.h"
+#include "timebase.h"
+
+// Speed in thousandths of a cycle per second the simulation starts at, like `DEF_SPEED` in main.c.
+#define START_SPEED 250
+// Speed steps the badge's buttons can select, like `INC_SPEED` and `MAX_SPEED` in main.c.
+#define SPEED_INC   50
+#define SPEED_MAX   2000
+
+// Denominator of the reference phase: microseconds per second times thousandths of a cycle.
+#define REF_DENOM 1000000000ULL
+
+// State of the pseudo-random generator used for jitter and speed changes.
+static uint64_t rng_state = 0x2545f4914f6cdd1dULL;
+
+// Get a pseudo-random number; xorshift64.
+static uint32_t rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state >> 32;
+}
+
+static void usage(char const* argv0) {
+    fprintf(stderr,
+            "Usage: %s [-d days] [-f fps] [-j jitter_us] [-s speed] [-c]\n"
+            "  -d  Simulated uptime in days (default 21)\n"
+            "  -f  Frames rendered per second (default %d)\n"
+            "  -j  Largest random delay of a frame in microseconds (default 0)\n"
+            "  -s  Speed in thousandths of a cycle per second (default %d)\n"
+            "  -c  Change to a random speed every hour\n",
+            argv0, CONFIG_RENDER_FPS, START_SPEED);
+}
+
+int main(int argc, char** argv) {
+    uint32_t days   = 21;
+    uint32_t fps    = CONFIG_RENDER_FPS;
+    uint32_t jitter = 0;
+    uint32_t speed  = START_SPEED;
+    bool     change = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:f:j:s:ch")) != -1) {
+        switch (opt) {
+            case 'd':
+                days = strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                fps = strtoul(optarg, NULL, 0);
+                break;
+            case 'j':
+                jitter = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                speed = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                change = true;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    int64_t period_us = fps ? 1000000 / fps : 0;
+    if (days == 0 || period_us == 0 || jitter >= period_us || speed > TIMEBASE_MAX_SPEED) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    timebase_t timebase;
+    timebase_init(&timebase, 0, speed);
+
+    // Exact phase since boot, in units of 1/`REF_DENOM` phase; the part before the last speed change is in `ref_base`.
+    unsigned __int128 ref_base      = 0;
+    int64_t           ref_base_us   = 0;
+    // The render loop before the timebase: a float step per frame, truncated to whole phase units.
+    phase_t           old_phase     = 0;
+    int64_t           prev_us       = 0;
+    phase_t           prev_phase    = 0;
+    int64_t           next_change   = 3600LL * 1000000;
+    int64_t           end_us        = days * 86400LL * 1000000;
+    uint64_t          frames        = 0;
+    uint64_t          wrong_phase   = 0;
+    uint64_t          uneven_steps  = 0;
+    uint32_t          speed_changes = 0;
+    unsigned __int128 ref           = 0;
+
+    for (int64_t frame_us = period_us; frame_us < end_us; frame_us += period_us) {
+        int64_t now = frame_us + (jitter ? rng() % jitter : 0);
+
+        // Settings are applied at the start of a frame, like `apply_settings`.
+        if (change && now >= next_change) {
+            ref_base      += (unsigned __int128)(now - ref_base_us) * speed * PHASE_ONE;
+            ref_base_us    = now;
+            speed          = rng() % (SPEED_MAX / SPEED_INC + 1) * SPEED_INC;
+            next_change   += 3600LL * 1000000;
+            timebase_set_speed(&timebase, now, speed);
+            speed_changes++;
+        }
+
+        phase_t phase = timebase_phase(&timebase, now);
+        old_phase    += (phase_t)(speed / 1000.0f * (PHASE_ONE / 1000000.0f) * (now - prev_us));
+        ref           = ref_base + (unsigned __int128)(now - ref_base_us) * speed * PHASE_ONE;
+        if (phase != (phase_t)(ref / REF_DENOM)) {
+            if (wrong_phase++ < 10) {
+                fprintf(stderr, "Frame %llu at %lld us: phase 0x%08x, expected 0x%08x\n", (unsigned long long)frames,
+                        (long long)now, phase, (phase_t)(ref / REF_DENOM));
+            }
+        }
+
+        // The step may only differ from the exact step for the elapsed time by rounding.
+        // Right after a speed change the step straddles two speeds; the exact-phase check above covers those frames.
+        if (frames && prev_us >= ref_base_us) {
+            uint64_t exact = (uint64_t)(now - prev_us) * speed * PHASE_ONE;
+            phase_t  step  = phase - prev_phase;
+            if (step != exact / REF_DENOM && step != (exact + REF_DENOM - 1) / REF_DENOM) {
+                if (uneven_steps++ < 10) {
+                    fprintf(stderr, "Frame %llu at %lld us: step %u, expected %.3f\n", (unsigned long long)frames,
+                            (long long)now, step, (double)exact / REF_DENOM);
+                }
+            }
+        }
+        prev_us    = now;
+        prev_phase = phase;
+        frames++;
+    }
+
+    // Drift of the old accumulator, as the signed difference within the wrapped phase.
+    int32_t old_drift = (int32_t)(old_phase - (phase_t)(ref / REF_DENOM));
+    printf("uptime          %10u days at %u fps, %u us jitter\n", days, fps, jitter);
+    printf("frames          %10llu\n", (unsigned long long)frames);
+    printf("speed changes   %10u\n", speed_changes);
+    printf("cycles          %10.3f\n", (double)(ref / REF_DENOM) / PHASE_ONE);
+    printf("wrong phases    %10llu\n", (unsigned long long)wrong_phase);
+    printf("uneven steps    %10llu\n", (unsigned long long)uneven_steps);
+    printf("float drift     %10.3f cycles (old accumulator, for comparison)\n", (double)old_drift / PHASE_ONE);
+
+    return wrong_phase || uneven_steps ? 1 : 0;
+}
@@ -0,0 +1,254 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Streaming player against a generated animation that is far larger than the badge's RAM.
+// Every shown column is checked against the file and every frame that had to wait for the read-ahead counts as a stall.
+// By default the read-ahead runs in lockstep with the frames and answers a wake-up a fixed number of frames late, which
+// makes the result independent of how busy the host is; with -t it runs in its own thread and frames are rendered in
+// real time instead, where a loaded host can cause stalls the badge would not have. With -w the phase starts shortly
+// before it wraps around, which playback must carry on across.
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "image.h"
+#include "player.h"
+
+// Whether the read-ahead runs in its own thread.
+static bool            threaded;
+// Frames the read-ahead takes to respond to a wake-up.
+static uint32_t        latency_frames = 8;
+// Time per frame in nanoseconds.
+static uint64_t        period_ns;
+// Frame being rendered.
+static size_t          current_frame;
+// Frame in which the read-ahead was first woken since it last ran.
+static size_t          woken_frame;
+// Whether the read-ahead has been woken since it last ran.
+static bool            reader_woken;
+// Wakes up the reader thread.
+static pthread_cond_t  reader_cond  = PTHREAD_COND_INITIALIZER;
+// Protects `reader_woken`.
+static pthread_mutex_t reader_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Whether the reader thread should exit.
+static volatile bool   reader_exit;
+
+// Get the current time in nanoseconds.
+static inline uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Stand-in for `xTaskNotifyGive` on the read-ahead task.
+static void reader_wake() {
+    pthread_mutex_lock(&reader_mutex);
+    if (!reader_woken) {
+        reader_woken = true;
+        woken_frame  = current_frame;
+    }
+    pthread_cond_signal(&reader_cond);
+    pthread_mutex_unlock(&reader_mutex);
+}
+
+// Fill the buffer; stops the simulation if there is nothing to play.
+static void reader_fill() {
+    if (!player_fill()) {
+        fprintf(stderr, "Nothing to play\n");
+        exit(1);
+    }
+}
+
+// Stand-in for the read-ahead task.
+static void* reader_thread(void* arg) {
+    while (!reader_exit) {
+        reader_fill();
+        pthread_mutex_lock(&reader_mutex);
+        while (!reader_woken && !reader_exit) {
+            pthread_cond_wait(&reader_cond, &reader_mutex);
+        }
+        reader_woken = false;
+        pthread_mutex_unlock(&reader_mutex);
+        if (latency_frames) {
+            usleep(latency_frames * period_ns / 1000);
+        }
+    }
+    return NULL;
+}
+
+// Write an RGB column image of `columns` columns that encode their own index.
+static bool write_test_file(char const* path, uint32_t columns) {
+    FILE* fd = fopen(path, "wb");
+    if (!fd) {
+        return false;
+    }
+    image_header_t header = {
+        .magic   = {'L', 'C', 'O', 'L'},
+        .version = IMAGE_VERSION,
+        .format  = IMAGE_FORMAT_RGB,
+        .height  = LED_COUNT,
+        .width   = 1,
+        .frames  = 1,
+    };
+    // The header can only describe 65535 frames of 65535 columns; split across frames.
+    while (columns / header.frames > UINT16_MAX || columns % header.frames) {
+        header.frames++;
+    }
+    header.width = columns / header.frames;
+    fwrite(&header, sizeof(header), 1, fd);
+    for (uint32_t i = 0; i < columns; i++) {
+        rgb_t column[LED_COUNT] = {{i, i >> 8, i >> 16}};
+        fwrite(column, sizeof(column), 1, fd);
+    }
+    return fclose(fd) == 0;
+}
+
+static void usage(char const* argv0) {
+    fprintf(stderr,
+            "Usage: %s [-s size_kib] [-f fps] [-k columns_per_frame] [-l latency_frames] [-t] [-w] [-d dir]\n"
+            "  -s  Size of the generated animation in KiB (default 4096)\n"
+            "  -f  Frames rendered per second (default %d)\n"
+            "  -k  Columns played per frame (default 2)\n"
+            "  -l  Frames the read-ahead takes to respond to a wake-up (default 8)\n"
+            "  -t  Run the read-ahead in a thread and render in real time\n"
+            "  -w  Start the phase half the animation before it wraps around\n"
+            "  -d  Directory to write the animation to (default /tmp)\n",
+            argv0, CONFIG_RENDER_FPS);
+}
+
+int main(int argc, char** argv) {
+    size_t      size_kib  = 4096;
+    uint32_t    fps       = CONFIG_RENDER_FPS;
+    uint32_t    per_frame = 2;
+    char const* tmp_dir   = "/tmp";
+    bool        wrap      = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:f:k:l:twd:h")) != -1) {
+        switch (opt) {
+            case 's':
+                size_kib = strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                fps = strtoul(optarg, NULL, 0);
+                break;
+            case 'k':
+                per_frame = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                latency_frames = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                threaded = true;
+                break;
+            case 'w':
+                wrap = true;
+                break;
+            case 'd':
+                tmp_dir = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (size_kib == 0 || fps == 0 || per_frame == 0 || per_frame >= PLAYER_BUFFER_COLUMNS) {
+        usage(argv[0]);
+        return 1;
+    }
+    period_ns = 1000000000ULL / fps;
+
+    char dir[256], path[300];
+    snprintf(dir, sizeof(dir), "%s/player_sim.XXXXXX", tmp_dir);
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/anim.col", dir);
+    uint32_t columns = size_kib * 1024 / (LED_COUNT * sizeof(rgb_t));
+    if (!write_test_file(path, columns)) {
+        perror(path);
+        return 1;
+    }
+
+    // The player effect shows a fallback until the first columns are in, like it does on the badge.
+    player_init(dir, reader_wake);
+    pthread_t reader;
+    if (threaded) {
+        pthread_create(&reader, NULL, reader_thread, NULL);
+        while (!player_available()) {
+            usleep(1000);
+        }
+    } else {
+        reader_fill();
+    }
+
+    // Play the file once and a bit, so starting over at the first column is covered too.
+    size_t   frames       = (columns + columns / 4) / per_frame;
+    // Column the phase starts at; the phase wraps after 2^32 >> (16 - PLAYER_CYCLE_SHIFT) columns.
+    uint32_t first_column = wrap ? (1u << (16 + PLAYER_CYCLE_SHIFT)) - columns / 2 : 0;
+    uint64_t start        = now_ns();
+    uint64_t max_frame_ns = 0;
+    size_t   errors       = 0;
+    size_t   rendered     = 0;
+    rgb_t    fb[LED_COUNT];
+    for (current_frame = 0; current_frame < frames; current_frame++) {
+        if (threaded) {
+            // Block until the frame is due, like the render task waiting for its timer, and skip missed frames.
+            uint64_t        due = start + current_frame * period_ns;
+            struct timespec ts  = {.tv_sec = due / 1000000000, .tv_nsec = due % 1000000000};
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            size_t skip    = (now_ns() - due) / period_ns;
+            current_frame += skip < frames - 1 - current_frame ? skip : frames - 1 - current_frame;
+        } else if (reader_woken && current_frame - woken_frame >= latency_frames) {
+            reader_woken = false;
+            reader_fill();
+        }
+
+        player_stats_t stats;
+        player_get_stats(&stats);
+        uint32_t stalls_before = stats.stalls;
+
+        uint64_t t0 = now_ns();
+        player_render(fb, (phase_t)((first_column + current_frame * per_frame) << (16 - PLAYER_CYCLE_SHIFT)));
+        uint64_t cost = now_ns() - t0;
+        max_frame_ns  = cost > max_frame_ns ? cost : max_frame_ns;
+        rendered++;
+
+        // After a stall the shown column lags behind, so only check frames that got their column.
+        player_get_stats(&stats);
+        uint32_t expected = current_frame * per_frame % columns;
+        uint32_t shown    = fb[0].r | fb[0].g << 8 | fb[0].b << 16;
+        if (stats.stalls == stalls_before && shown != (expected & 0xffffff)) {
+            errors++;
+        }
+    }
+    if (threaded) {
+        reader_exit = true;
+        reader_wake();
+        pthread_join(reader, NULL);
+    }
+
+    player_stats_t stats;
+    player_get_stats(&stats);
+    printf("file            %10zu KiB, %u columns\n", size_kib, columns);
+    printf("buffer          %10zu bytes\n", sizeof(rgb_t) * LED_COUNT * PLAYER_BUFFER_COLUMNS);
+    printf("frames          %10zu of %zu at %u fps, %u columns each\n", rendered, frames, fps, per_frame);
+    printf("read-ahead      %10s, %u frames latency\n", threaded ? "threaded" : "lockstep", latency_frames);
+    printf("phase           %10s\n", wrap ? "wrapping" : "from 0");
+    printf("columns read    %10u\n", stats.columns_read);
+    printf("columns played  %10u\n", stats.columns_played);
+    printf("files opened    %10u\n", stats.files_opened);
+    printf("max frame cost  %10.3f us\n", max_frame_ns / 1000.0);
+    printf("stalls          %10u\n", stats.stalls);
+    printf("wrong columns   %10zu\n", errors);
+
+    remove(path);
+    rmdir(dir);
+    return errors || stats.stalls ? 1 : 0;
+}
@@ -0,0 +1,126 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// POV playback against a simulated column timer.
+// The timer ticks at the configured column period, optionally with wake-up latency and lost ticks, and the
+// timestamp of every emitted column is recorded to check that the engine keeps the image in step with time.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "bsp/led.h"
+#include "flags.h"
+#include "pov.h"
+
+// Get the current time in nanoseconds.
+static inline uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void usage(char const* argv0) {
+    fprintf(stderr,
+            "Usage: %s [-p period_us] [-n columns] [-t ticks] [-l latency_ns] [-m miss_permille]\n"
+            "  -p  Column period in microseconds (default %d)\n"
+            "  -n  Columns in the image (default %d)\n"
+            "  -t  Timer ticks to simulate (default 100000)\n"
+            "  -l  Maximum random wake-up latency in nanoseconds (default 0)\n"
+            "  -m  Chance per tick, in permille, that the wake-up is lost (default 0)\n",
+            argv0, CONFIG_POV_COLUMN_PERIOD_US, POV_MAX_COLUMNS);
+}
+
+int main(int argc, char** argv) {
+    uint32_t period_us   = CONFIG_POV_COLUMN_PERIOD_US;
+    size_t   columns     = POV_MAX_COLUMNS;
+    size_t   ticks       = 100000;
+    uint32_t latency_ns  = 0;
+    uint32_t miss_permil = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:n:t:l:m:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                period_us = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                columns = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                ticks = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                latency_ns = strtoul(optarg, NULL, 0);
+                break;
+            case 'm':
+                miss_permil = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (period_us == 0 || columns == 0 || columns > POV_MAX_COLUMNS || ticks < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    pov_t pov;
+    pov_load_effect(&pov, &effects[EFFECT_FLAGS], columns, flags_len, 0x100);
+
+    // Timestamp and image column of every emitted column.
+    uint64_t* stamps      = malloc(sizeof(uint64_t) * ticks);
+    size_t*   indices     = malloc(sizeof(size_t) * ticks);
+    size_t    emitted     = 0;
+    uint64_t  max_cost_ns = 0;
+    uint32_t  pending     = 0;
+    srand(1);
+
+    for (size_t tick = 0; tick < ticks; tick++) {
+        pending++;
+        if (miss_permil && (uint32_t)(rand() % 1000) < miss_permil) {
+            // The task did not get to run before the next tick.
+            continue;
+        }
+        uint64_t     wake   = tick * period_us * 1000ULL + (latency_ns ? rand() % latency_ns : 0);
+        uint64_t     t0     = now_ns();
+        rgb_t const* column = pov_next(&pov, pending);
+        bsp_led_write((uint8_t*)column, LED_COUNT * sizeof(rgb_t));
+        uint64_t     cost   = now_ns() - t0;
+        if (cost > max_cost_ns) {
+            max_cost_ns = cost;
+        }
+        indices[emitted] = (column - pov.columns) / LED_COUNT;
+        stamps[emitted]  = wake + cost;
+        emitted++;
+        pending = 0;
+    }
+
+    // Every column must be the one that belongs to its tick, even after lost ticks.
+    size_t   errors  = 0;
+    uint64_t min_gap = UINT64_MAX, max_gap = 0;
+    for (size_t i = 0; i < emitted; i++) {
+        size_t tick = (stamps[i] / 1000) / period_us;
+        if (indices[i] != tick % columns) {
+            errors++;
+        }
+        if (i > 0) {
+            uint64_t gap = stamps[i] - stamps[i - 1];
+            min_gap      = gap < min_gap ? gap : min_gap;
+            max_gap      = gap > max_gap ? gap : max_gap;
+        }
+    }
+
+    printf("period          %10u us\n", period_us);
+    printf("columns emitted %10zu of %zu ticks (%u missed)\n", emitted, ticks, pov.missed);
+    printf("column interval %10.3f .. %.3f us\n", min_gap / 1000.0, max_gap / 1000.0);
+    printf("max column cost %10.3f us\n", max_cost_ns / 1000.0);
+    printf("out of step     %10zu\n", errors);
+
+    free(stamps);
+    free(indices);
+    return errors || max_cost_ns > period_us * 1000ULL ? 1 : 0;
+}
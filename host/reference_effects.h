@@ -0,0 +1,23 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// The original floating-point effect implementations.
+// These are the reference the fixed-point effects in `effects.c` are compared against.
+
+#pragma once
+
+#include <stddef.h>
+
+// Largest per-channel difference allowed between a fixed-point effect and its reference.
+#define REF_EFFECT_TOLERANCE 2
+
+// Brightness multiplier of the reference effects.
+extern float ref_brightness;
+
+// A reference effect function.
+typedef void (*ref_effect_t)(float coeff);
+
+// Table of reference effects, in the same order as `effects`.
+extern ref_effect_t const ref_effects[];
+// Number of reference effects.
+extern size_t const       ref_effects_len;
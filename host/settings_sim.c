@@ -0,0 +1,223 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Replays simulated button presses against the settings writer and counts what ends up in flash.
+// The writer is compared with the way settings used to be stored: every press pushed back a one second deadline, after
+// which each setting was written with its own NVS key. Flash use is counted in 32-byte NVS entries: NVS itself skips
+// keys whose value did not change, every other key takes an entry, and a page is erased for every 126 entries written.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "settings.h"
+
+// Number of entries in an NVS page.
+#define NVS_PAGE_ENTRIES 126
+// Number of entries a playlist takes: the blob index, the header of its data and the data.
+#define PLAYLIST_ENTRIES (2 + (sizeof(playlist_t) + 31) / 32)
+// How long the old main loop waited after a press before storing, in microseconds.
+#define OLD_SAVE_DELAY   1000000
+
+// Number of effects to cycle through, counting playlist mode.
+#define EFFECT_STATES 7
+
+// State of the pseudo-random generator.
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+// Get a pseudo-random number; xorshift64.
+static uint32_t rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state >> 32;
+}
+
+// Get a pseudo-random number in [min, max].
+static int64_t rng_range(int64_t min, int64_t max) {
+    return min + rng() % (uint64_t)(max - min + 1);
+}
+
+// Get the current time in nanoseconds.
+static inline uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Settings as stored by the old main loop, and what storing them cost.
+typedef struct {
+    settings_t stored;
+    int64_t    deadline;
+    uint32_t   stores;
+    uint32_t   entries;
+} old_store_t;
+
+// Store the settings like the old main loop did.
+static void old_store(old_store_t* old, settings_t const* settings) {
+    old->entries += settings->effect_no != old->stored.effect_no;
+    old->entries += settings->speed != old->stored.speed;
+    old->entries += settings->brightness != old->stored.brightness;
+    old->stored   = *settings;
+    old->deadline = INT64_MAX;
+    old->stores++;
+}
+
+// Change the settings like one button press on the badge would.
+static void press(settings_t* settings) {
+    switch (rng() % 5) {
+        case 0:
+            settings->speed = settings->speed + 50 < 2000 ? settings->speed + 50 : 2000;
+            break;
+        case 1:
+            settings->speed = settings->speed > 50 ? settings->speed - 50 : 0;
+            break;
+        case 2:
+            settings->brightness = settings->brightness + 26 < 256 ? settings->brightness + 26 : 256;
+            break;
+        case 3:
+            settings->brightness = settings->brightness > 52 ? settings->brightness - 26 : 26;
+            break;
+        default:
+            settings->effect_no = (settings->effect_no + 1) % EFFECT_STATES;
+            break;
+    }
+}
+
+static void usage(char const* argv0) {
+    fprintf(stderr,
+            "Usage: %s [-d days] [-r revert_percent]\n"
+            "  -d  Simulated days of use (default 30)\n"
+            "  -r  Percentage of sessions that end with the settings changed back (default 25)\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    uint32_t days   = 30;
+    uint32_t revert = 25;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:r:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                days = strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                revert = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (days == 0 || revert > 100) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    settings_t settings = {
+        .effect_no  = 0,
+        .speed      = 250,
+        .brightness = 256,
+    };
+    playlist_defaults(&settings.playlist);
+
+    // A badge that has the settings stored but not the playlist, which the first write must add.
+    settings_writer_t writer;
+    uint64_t          record = settings_encode(&settings);
+    settings_writer_init(&writer, &record, NULL);
+    old_store_t old = {.stored = settings, .deadline = INT64_MAX};
+
+    int64_t  end_us        = days * 86400LL * 1000000;
+    int64_t  now           = 0;
+    uint32_t presses       = 0;
+    uint32_t sessions      = 0;
+    uint32_t errors        = 0;
+    uint64_t max_delay_us  = 0;
+    uint64_t max_caller_ns = 0;
+
+    while (now < end_us) {
+        // A session of a few presses, some quick, some after looking at the result for a while.
+        now += rng_range(10 * 60 * 1000000LL, 4 * 3600 * 1000000LL);
+        settings_t start = settings;
+        uint32_t   count = rng_range(1, 12);
+        bool       back  = rng() % 100 < revert;
+        for (uint32_t i = 0; i <= count; i++) {
+            if (i == count && !back) {
+                break;
+            }
+            now += rng() % 10 < 6 ? rng_range(150000, 600000) : rng_range(1000000, 8000000);
+
+            // Let both writers catch up to the time of the press.
+            settings_write_t written;
+            int64_t          due = settings_writer_due(&writer);
+            if (due <= now && settings_writer_take(&writer, due, &written)) {
+                if (written.write_record && written.record == writer.stored) {
+                    fprintf(stderr, "Unchanged settings written\n");
+                    errors++;
+                }
+                if (written.write_playlist && writer.playlist_valid) {
+                    fprintf(stderr, "Unchanged playlist written\n");
+                    errors++;
+                }
+                uint64_t delay = due - writer.first_us;
+                max_delay_us   = delay > max_delay_us ? delay : max_delay_us;
+                settings_writer_done(&writer, &written, true, due, 0);
+            }
+            if (old.deadline <= now) {
+                old_store(&old, &settings);
+            }
+
+            if (i == count) {
+                settings = start;
+            } else {
+                press(&settings);
+            }
+            presses++;
+            old.deadline = now + OLD_SAVE_DELAY;
+
+            uint64_t t0 = now_ns();
+            settings_writer_request(&writer, &settings, now);
+            uint64_t cost = now_ns() - t0;
+            max_caller_ns = cost > max_caller_ns ? cost : max_caller_ns;
+        }
+        sessions++;
+    }
+
+    // Flush whatever is still pending.
+    settings_write_t written;
+    int64_t          due = settings_writer_due(&writer);
+    if (due != INT64_MAX && settings_writer_take(&writer, due, &written)) {
+        settings_writer_done(&writer, &written, true, due, 0);
+    }
+    if (old.deadline != INT64_MAX) {
+        old_store(&old, &settings);
+    }
+    if (writer.stored != settings_encode(&settings)) {
+        fprintf(stderr, "Stored settings differ from the last ones requested\n");
+        errors++;
+    }
+    if (writer.stats.playlist_writes != 1) {
+        fprintf(stderr, "Playlist written %u times instead of once\n", writer.stats.playlist_writes);
+        errors++;
+    }
+    if (max_delay_us > SETTINGS_MAX_DELAY_US) {
+        fprintf(stderr, "A change waited longer than %d us to be written\n", SETTINGS_MAX_DELAY_US);
+        errors++;
+    }
+
+    printf("simulated       %10u days, %u sessions, %u presses\n", days, sessions, presses);
+    printf("old stores      %10u, %u entries, %.1f page erases\n", old.stores, old.entries,
+           (double)old.entries / NVS_PAGE_ENTRIES);
+    uint32_t entries = writer.stats.writes + writer.stats.playlist_writes * PLAYLIST_ENTRIES;
+    printf("writes          %10u, %u entries, %.1f page erases\n", writer.stats.writes, entries,
+           (double)entries / NVS_PAGE_ENTRIES);
+    printf("playlist writes %10u\n", writer.stats.playlist_writes);
+    printf("unchanged       %10u writes skipped\n", writer.stats.unchanged);
+    printf("max delay       %10.3f s\n", max_delay_us / 1000000.0);
+    printf("max caller cost %10.3f us\n", max_caller_ns / 1000.0);
+    printf("errors          %10u\n", errors);
+    return errors ? 1 : 0;
+}
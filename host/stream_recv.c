@@ -0,0 +1,193 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Host build of the LED stream receiver, to test streaming from a lighting controller or tools/ledsend.py without a
+// badge. Packets are taken in by their own thread like on the badge, and frames are rendered at the badge's frame
+// rate, from the stream while it is live and from an effect otherwise. Prints when the stream starts and stops, and
+// the statistics at the end.
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "effects.h"
+#include "sdkconfig.h"
+#include "stream.h"
+#include "timebase.h"
+
+// Animation speed of the fallback effect, in thousandths of a cycle per second.
+#define FALLBACK_SPEED 250
+
+// Whether the receiver thread should exit.
+static volatile bool receiver_exit;
+
+// Get the current time in microseconds.
+static int64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Stand-in for the receiver task.
+static void* receiver_thread(void* arg) {
+    while (!receiver_exit) {
+        if (stream_receive(100) == ESP_FAIL) {
+            fprintf(stderr, "Failed to receive\n");
+            exit(1);
+        }
+    }
+    return NULL;
+}
+
+// Show a frame on one terminal line with ANSI colours.
+static void print_ansi(rgb_t const* fb) {
+    printf("\r");
+    for (size_t led = 0; led < LED_COUNT; led++) {
+        printf("\x1b[48;2;%u;%u;%um  ", fb[led].r, fb[led].g, fb[led].b);
+    }
+    printf("\x1b[0m");
+    fflush(stdout);
+}
+
+// Print the stream statistics.
+static void print_stats(stream_stats_t const* stats) {
+    printf("Packets: %" PRIu32 " received, %" PRIu32 " ignored, %" PRIu32 " lost, %" PRIu32 " late\n",
+           stats->packets, stats->ignored, stats->lost, stats->late);
+    printf("Frames: %" PRIu32 " received, %" PRIu32 " shown, %" PRIu32 " skipped, %" PRIu32 " overflows, %" PRIu32
+           " fallbacks\n",
+           stats->frames, stats->shown, stats->skipped, stats->overflows, stats->fallbacks);
+    printf("Latency: %.1f ms average, %.1f ms max, jitter %.1f ms, interval %.1f ms\n",
+           stats->latency_avg_us / 1000.0, stats->latency_max_us / 1000.0, stats->jitter_us / 1000.0,
+           stats->interval_us / 1000.0);
+}
+
+// Print the usage.
+static void usage(char const* argv0) {
+    fprintf(stderr,
+            "Usage: %s [-d port] [-e port] [-u universe] [-s channel] [-j ms] [-t ms] [-f effect] [-n seconds] [-a]\n"
+            "  -d  UDP port to receive DDP on, or 0 for none (default %d)\n"
+            "  -e  UDP port to receive E1.31 on, or 0 for none (default %d)\n"
+            "  -u  E1.31 universe (default 1)\n"
+            "  -s  DMX channel of the first LED (default 1)\n"
+            "  -j  Jitter buffer delay in milliseconds (default 40)\n"
+            "  -t  Time without frames until the effect takes over, in milliseconds (default 2000)\n"
+            "  -f  Effect number shown without a stream (default 0)\n"
+            "  -n  Stop after this many seconds (default: run until interrupted)\n"
+            "  -a  Show the frames in the terminal with ANSI colours\n",
+            argv0, STREAM_DDP_PORT, STREAM_E131_PORT);
+}
+
+int main(int argc, char** argv) {
+    stream_config_t config = {
+        .ddp_port   = STREAM_DDP_PORT,
+        .e131_port  = STREAM_E131_PORT,
+        .universe   = 1,
+        .start      = 1,
+        .jitter_ms  = 40,
+        .timeout_ms = 2000,
+        .clock      = now_us,
+    };
+    uint32_t effect   = 0;
+    double   duration = 0;
+    bool     ansi     = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:e:u:s:j:t:f:n:ah")) != -1) {
+        switch (opt) {
+            case 'd':
+                config.ddp_port = strtoul(optarg, NULL, 0);
+                break;
+            case 'e':
+                config.e131_port = strtoul(optarg, NULL, 0);
+                break;
+            case 'u':
+                config.universe = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                config.start = strtoul(optarg, NULL, 0);
+                break;
+            case 'j':
+                config.jitter_ms = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                config.timeout_ms = strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                effect = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                duration = strtod(optarg, NULL);
+                break;
+            case 'a':
+                ansi = true;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc || effect >= effects_len || (!config.ddp_port && !config.e131_port)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (stream_open(&config) != ESP_OK) {
+        perror("Failed to open sockets");
+        return 1;
+    }
+    printf("Listening for DDP on port %u and E1.31 universe %u on port %u\n", config.ddp_port, config.universe,
+           config.e131_port);
+    fflush(stdout);
+
+    pthread_t receiver;
+    pthread_create(&receiver, NULL, receiver_thread, NULL);
+
+    int64_t    start = now_us();
+    int64_t    end   = duration > 0 ? start + (int64_t)(duration * 1000000) : INT64_MAX;
+    timebase_t timebase;
+    timebase_init(&timebase, start, FALLBACK_SPEED);
+
+    rgb_t fb[LED_COUNT];
+    rgb_t last_streamed[LED_COUNT] = {0};
+    bool  was_streaming            = false;
+    for (int64_t frame_time = start; frame_time < end; frame_time += 1000000 / CONFIG_RENDER_FPS) {
+        int64_t wait = frame_time - now_us();
+        if (wait > 0) {
+            usleep(wait);
+        }
+        int64_t now       = now_us();
+        bool    streaming = stream_render(fb, now);
+        if (streaming) {
+            memcpy(last_streamed, fb, sizeof(fb));
+        } else {
+            effects[effect].render(fb, timebase_phase(&timebase, now));
+        }
+        if (streaming != was_streaming) {
+            printf("%s%.3f s: %s\n", ansi ? "\r\x1b[K" : "", (now - start) / 1e6,
+                   streaming ? "streaming" : effects[effect].name);
+            was_streaming = streaming;
+        }
+        if (ansi) {
+            print_ansi(fb);
+        }
+    }
+    receiver_exit = true;
+    pthread_join(receiver, NULL);
+
+    if (ansi) {
+        printf("\n");
+    }
+    stream_stats_t stats;
+    stream_get_stats(&stats);
+    print_stats(&stats);
+    printf("Last frame: ");
+    for (size_t led = 0; led < LED_COUNT; led++) {
+        printf("%02x%02x%02x", last_streamed[led].r, last_streamed[led].g, last_streamed[led].b);
+    }
+    printf("\n");
+    return 0;
+}
@@ -3,6 +3,7 @@
 // SPDX-License-Identifer: MIT
 
 #include "color.h"
+#include <assert.h>
 
 // Convert float HSV into uint8_t RGB.
 rgb_t f_hsv_to_rgb(float h, float s, float v) {
@@ -32,4 +33,70 @@ rgb_t f_hsv_to_rgb(float h, float s, float v) {
     rgb.g = (uint8_t)(g * 255.0f);
     rgb.b = (uint8_t)(b * 255.0f);
     return rgb;
-}
\ No newline at end of file
+}
+// Convert fixed-point HSV into uint8_t RGB.
+// Hue is a Q16 fraction of a full turn, saturation and value are 0-255.
+rgb_t q_hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v) {
+    // Sector in the upper bits, position within the sector as Q16 in the lower bits.
+    uint32_t h6 = h * 6;
+    uint32_t i  = h6 >> 16;
+    uint32_t f  = h6 & 0xffff;
+
+    // Saturation as Q16 where 0x10000 is full scale.
+    uint32_t s16 = s * 257 + (s >> 7);
+    uint32_t fs  = (f * s16) >> 16;
+    uint8_t  p   = (v * (0x10000 - s16)) >> 16;
+    uint8_t  q   = (v * (0x10000 - fs)) >> 16;
+    uint8_t  t   = (v * (0x10000 - s16 + fs)) >> 16;
+
+    // clang-format off
+    switch (i) {
+        case 0: return (rgb_t){v, t, p};
+        case 1: return (rgb_t){q, v, p};
+        case 2: return (rgb_t){p, v, t};
+        case 3: return (rgb_t){p, q, v};
+        case 4: return (rgb_t){t, p, v};
+        case 5: return (rgb_t){v, p, q};
+        default: return (rgb_t){0, 0, 0}; // unreachable
+    }
+    // clang-format on
+}
+
+// Scale a buffer of uint8_t RGB colors by a Q8 factor (0x100 is full scale).
+void rgb_scale_buf(rgb_t* buf, size_t len, uint16_t scale) {
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = rgb_scale(buf[i], scale);
+    }
+}
+
+// A 32-bit word that may alias color data.
+typedef uint32_t __attribute__((may_alias)) rgb_word_t;
+
+// Blend two buffers of uint8_t RGB colors into `out`; `alpha` is the Q8 weight of `b` (0x100 is only `b`).
+// All buffers must be 4-byte aligned; `out` may be the same buffer as `a` or `b`.
+void rgb_blend(rgb_t* out, rgb_t const* a, rgb_t const* b, size_t len, uint16_t alpha) {
+    assert(((uintptr_t)out | (uintptr_t)a | (uintptr_t)b) % 4 == 0);
+    uint32_t const inv   = 0x100 - alpha;
+    size_t const   bytes = len * sizeof(rgb_t);
+    size_t const   words = bytes / 4;
+
+    // Blend four channels per word; two at a time, spread out so that each gets 16 bits of headroom.
+    rgb_word_t*       out_w = (rgb_word_t*)out;
+    rgb_word_t const* a_w   = (rgb_word_t const*)a;
+    rgb_word_t const* b_w   = (rgb_word_t const*)b;
+    for (size_t i = 0; i < words; i++) {
+        uint32_t x  = a_w[i];
+        uint32_t y  = b_w[i];
+        uint32_t lo = ((x & 0x00ff00ff) * inv + (y & 0x00ff00ff) * alpha) >> 8;
+        uint32_t hi = ((x >> 8) & 0x00ff00ff) * inv + ((y >> 8) & 0x00ff00ff) * alpha;
+        out_w[i]    = (lo & 0x00ff00ff) | (hi & 0xff00ff00);
+    }
+
+    // Blend the remaining channels one by one.
+    uint8_t*       out_b = (uint8_t*)out;
+    uint8_t const* a_b   = (uint8_t const*)a;
+    uint8_t const* b_b   = (uint8_t const*)b;
+    for (size_t i = words * 4; i < bytes; i++) {
+        out_b[i] = (a_b[i] * inv + b_b[i] * alpha) >> 8;
+    }
+}
@@ -1,10 +1,10 @@
-
 // SPDX-CopyRightText: 2025 Julian Scheffers
 // SPDX-License-Identifer: MIT
 
 #pragma once
 
 #include <math.h>
+#include <stddef.h>
 #include <stdint.h>
 
 // A uint8_t red, green, blue tuple.
@@ -12,9 +12,26 @@ typedef struct {
     uint8_t r, g, b;
 } rgb_t;
 
+// Framebuffers of `rgb_t` are sent to the LEDs as-is.
+_Static_assert(sizeof(rgb_t) == 3, "rgb_t must not be padded");
+
+// A uint16_t red, green, blue tuple, for intermediate results that need more precision than `rgb_t`.
+typedef struct {
+    uint16_t r, g, b;
+} rgb16_t;
+
+// Clamp a channel value to 0-255.
+static inline uint8_t sat_u8(uint32_t x) {
+    return x > 255 ? 255 : x;
+}
+
 // Convert float HSV into uint8_t RGB.
 rgb_t f_hsv_to_rgb(float h, float s, float v);
 
+// Convert fixed-point HSV into uint8_t RGB.
+// Hue is a Q16 fraction of a full turn, saturation and value are 0-255.
+rgb_t q_hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v);
+
 // Convert float RGB into uint8_t RGB.
 static inline rgb_t f_rgb(float r, float g, float b) {
     rgb_t rgb;
@@ -23,3 +40,27 @@ static inline rgb_t f_rgb(float r, float g, float b) {
     rgb.b = (uint8_t)(b * 255.0f);
     return rgb;
 }
+
+// Convert Q16 RGB (0x10000 is full scale) into uint8_t RGB.
+static inline rgb_t q_rgb(uint32_t r, uint32_t g, uint32_t b) {
+    rgb_t rgb;
+    rgb.r = (r * 255) >> 16;
+    rgb.g = (g * 255) >> 16;
+    rgb.b = (b * 255) >> 16;
+    return rgb;
+}
+
+// Scale a uint8_t RGB color by a Q8 factor (0x100 is full scale).
+static inline rgb_t rgb_scale(rgb_t col, uint16_t scale) {
+    col.r = (col.r * scale) >> 8;
+    col.g = (col.g * scale) >> 8;
+    col.b = (col.b * scale) >> 8;
+    return col;
+}
+
+// Scale a buffer of uint8_t RGB colors by a Q8 factor (0x100 is full scale).
+void rgb_scale_buf(rgb_t* buf, size_t len, uint16_t scale);
+
+// Blend two buffers of uint8_t RGB colors into `out`; `alpha` is the Q8 weight of `b` (0x100 is only `b`).
+// All buffers must be 4-byte aligned; `out` may be the same buffer as `a` or `b`.
+void rgb_blend(rgb_t* out, rgb_t const* a, rgb_t const* b, size_t len, uint16_t alpha);
@@ -0,0 +1,136 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "delta.h"
+#include <string.h>
+
+// Value of `op` while the header is being received.
+#define OP_HEADER -1
+
+// Read a little-endian 32-bit number.
+static inline uint32_t get_u32(uint8_t const* data) {
+    return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+// Get the number of argument bytes of an operation, or -1 if it is not a known operation.
+static int args_len(int op) {
+    switch (op) {
+        case DELTA_OP_END:
+            return 0;
+        case DELTA_OP_COPY:
+            return 8;
+        case DELTA_OP_INSERT:
+            return 4;
+        default:
+            return -1;
+    }
+}
+
+// Check that `len` more bytes fit in the new image.
+static esp_err_t check_target(delta_t const* delta, uint32_t len) {
+    return len <= delta->header.target_size - delta->written ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+// Copy a range of the old image to the new image.
+static esp_err_t apply_copy(delta_t* delta, uint32_t offset, uint32_t len) {
+    if (offset > delta->header.source_size || len > delta->header.source_size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t res = check_target(delta, len);
+    while (res == ESP_OK && len) {
+        size_t chunk = len < DELTA_COPY_CHUNK ? len : DELTA_COPY_CHUNK;
+        res          = delta->read(delta->ctx, offset, delta->copy_buf, chunk);
+        if (res == ESP_OK) {
+            res = delta->write(delta->ctx, delta->copy_buf, chunk);
+        }
+        delta->written += chunk;
+        offset         += chunk;
+        len            -= chunk;
+    }
+    return res;
+}
+
+// Check the header once it is complete.
+static esp_err_t apply_header(delta_t* delta) {
+    delta_header_t const* header = &delta->header;
+    if (memcmp(header->magic, DELTA_MAGIC, sizeof(header->magic)) || header->version != DELTA_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    return delta->check ? delta->check(delta->ctx, header) : ESP_OK;
+}
+
+// Start applying a patch.
+void delta_init(delta_t* delta, delta_read_t read, delta_write_t write, delta_check_t check, void* ctx) {
+    memset(delta, 0, offsetof(delta_t, copy_buf));
+    delta->read  = read;
+    delta->write = write;
+    delta->check = check;
+    delta->ctx   = ctx;
+    delta->op    = OP_HEADER;
+}
+
+// Apply the next `len` bytes of the patch; they can be split anywhere.
+esp_err_t delta_feed(delta_t* delta, void const* data, size_t len) {
+    uint8_t const* pos = data;
+    uint8_t const* end = pos + len;
+    esp_err_t      res = ESP_OK;
+    while (res == ESP_OK && pos < end) {
+        if (delta->done) {
+            // Nothing may follow the end of the patch.
+            return ESP_ERR_INVALID_SIZE;
+        } else if (delta->op == OP_HEADER) {
+            size_t chunk = sizeof(delta_header_t) - delta->pending_len;
+            chunk        = chunk < (size_t)(end - pos) ? chunk : (size_t)(end - pos);
+            memcpy((uint8_t*)&delta->header + delta->pending_len, pos, chunk);
+            delta->pending_len += chunk;
+            pos                += chunk;
+            if (delta->pending_len == sizeof(delta_header_t)) {
+                delta->pending_len = 0;
+                delta->op          = DELTA_OP_END;
+                res                = apply_header(delta);
+            }
+        } else if (delta->insert_left) {
+            uint32_t chunk = delta->insert_left < (size_t)(end - pos) ? delta->insert_left : (uint32_t)(end - pos);
+            res            = delta->write(delta->ctx, pos, chunk);
+            delta->written     += chunk;
+            delta->insert_left -= chunk;
+            pos                += chunk;
+        } else if (delta->op == DELTA_OP_END) {
+            // Start of an operation.
+            int op = *pos++;
+            if (args_len(op) < 0) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            delta->op   = op;
+            delta->done = op == DELTA_OP_END;
+        } else {
+            // Arguments of an operation.
+            size_t need  = args_len(delta->op) - delta->pending_len;
+            size_t chunk = need < (size_t)(end - pos) ? need : (size_t)(end - pos);
+            memcpy(delta->args + delta->pending_len, pos, chunk);
+            delta->pending_len += chunk;
+            pos                += chunk;
+            if (delta->pending_len < (size_t)args_len(delta->op)) {
+                continue;
+            }
+            int op             = delta->op;
+            delta->pending_len = 0;
+            delta->op          = DELTA_OP_END;
+            if (op == DELTA_OP_COPY) {
+                res = apply_copy(delta, get_u32(delta->args), get_u32(delta->args + 4));
+            } else {
+                res                = check_target(delta, get_u32(delta->args));
+                delta->insert_left = get_u32(delta->args);
+            }
+        }
+    }
+    return res;
+}
+
+// Check that the whole patch was applied.
+esp_err_t delta_finish(delta_t const* delta) {
+    if (!delta->done || delta->written != delta->header.target_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,89 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Binary patches that turn the running firmware into a new one.
+// A patch is a header followed by operations that either copy a range of the old image or insert new bytes; it is
+// applied as it is received, in a fixed amount of memory. tools/mkdelta.py makes them.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Magic bytes at the start of a patch.
+#define DELTA_MAGIC      "BDLT"
+// Version of the patch format.
+#define DELTA_VERSION    1
+// Size of the buffer used to copy from the old image.
+#define DELTA_COPY_CHUNK 512
+
+// Ends the patch.
+#define DELTA_OP_END    0x00
+// Followed by a 32-bit offset into the old image and a 32-bit length: copy that range.
+#define DELTA_OP_COPY   0x01
+// Followed by a 32-bit length and that many bytes: insert them.
+#define DELTA_OP_INSERT 0x02
+
+// Patch header; all numbers are little-endian.
+typedef struct __attribute__((packed)) {
+    // Must be `DELTA_MAGIC`.
+    char     magic[4];
+    // Must be `DELTA_VERSION`.
+    uint8_t  version;
+    // Must be zero.
+    uint8_t  reserved[3];
+    // Size of the old image.
+    uint32_t source_size;
+    // Size of the new image.
+    uint32_t target_size;
+    // SHA-256 of the old image.
+    uint8_t  source_sha256[32];
+    // SHA-256 of the new image.
+    uint8_t  target_sha256[32];
+} delta_header_t;
+
+// Read `len` bytes at `offset` of the old image.
+typedef esp_err_t (*delta_read_t)(void* ctx, size_t offset, void* buf, size_t len);
+// Append bytes to the new image.
+typedef esp_err_t (*delta_write_t)(void* ctx, void const* data, size_t len);
+// Check the header before anything is applied, e.g. that the old image is the one the patch was made against.
+typedef esp_err_t (*delta_check_t)(void* ctx, delta_header_t const* header);
+
+// State of a patch being applied.
+typedef struct {
+    // Reads the old image.
+    delta_read_t   read;
+    // Writes the new image.
+    delta_write_t  write;
+    // Checks the header; may be NULL.
+    delta_check_t  check;
+    // Passed to the callbacks.
+    void*          ctx;
+    // The header, once received.
+    delta_header_t header;
+    // Number of bytes of the header or the operation arguments received.
+    size_t         pending_len;
+    // Arguments of the operation being received.
+    uint8_t        args[8];
+    // Operation whose arguments are being received, `DELTA_OP_END` between operations, or -1 before the header.
+    int            op;
+    // Bytes left to insert of the current `DELTA_OP_INSERT`.
+    uint32_t       insert_left;
+    // Whether `DELTA_OP_END` was received.
+    bool           done;
+    // Number of bytes of the new image written.
+    size_t         written;
+    // Buffer to copy from the old image with.
+    uint8_t        copy_buf[DELTA_COPY_CHUNK];
+} delta_t;
+
+// Start applying a patch.
+void delta_init(delta_t* delta, delta_read_t read, delta_write_t write, delta_check_t check, void* ctx);
+
+// Apply the next `len` bytes of the patch; they can be split anywhere.
+esp_err_t delta_feed(delta_t* delta, void const* data, size_t len);
+
+// Check that the whole patch was applied.
+esp_err_t delta_finish(delta_t const* delta);
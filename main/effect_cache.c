@@ -0,0 +1,109 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "effect_cache.h"
+#include <string.h>
+
+// Most phase steps per cycle, as a power of two; interpolation weights are Q8, so more steps gain nothing.
+#define MAX_STEPS_SHIFT 8
+
+// One baked frame, padded so that every frame is 4-byte aligned for `rgb_blend`.
+typedef struct {
+    rgb_t px[LED_COUNT];
+} __attribute__((aligned(4))) cache_frame_t;
+
+// Frames that fit in the budget of one cache slot.
+#define SLOT_FRAMES (EFFECT_CACHE_SIZE / EFFECT_CACHE_SLOTS / sizeof(cache_frame_t))
+
+// A cached effect.
+typedef struct {
+    // Whether the slot holds an effect.
+    bool          used;
+    // Index into `effects`.
+    size_t        effect;
+    // The baked cycle; frame `i` is the effect at phase `i / steps`.
+    cache_frame_t frames[SLOT_FRAMES > 0 ? SLOT_FRAMES : 1];
+} cache_slot_t;
+
+// The cache slots.
+static cache_slot_t slots[EFFECT_CACHE_SLOTS];
+// Slot to bake into next.
+static size_t       next_slot;
+// Number of phase steps per cycle, as a power of two, or -1 if it was not worked out yet.
+static int          steps_shift = -1;
+
+// Get the number of phase steps per cached cycle as a power of two, or 0 if nothing can be cached.
+static int get_steps_shift() {
+    if (steps_shift < 0) {
+        // A cycle of one step would show the effect frozen, so caching takes at least two frames.
+        steps_shift = 0;
+        while (steps_shift < MAX_STEPS_SHIFT && (1u << (steps_shift + 1)) <= SLOT_FRAMES) {
+            steps_shift++;
+        }
+    }
+    return steps_shift;
+}
+
+// Get the number of phase steps per cached cycle, or 0 if the budget is too small to cache anything.
+size_t effect_cache_steps() {
+    int shift = get_steps_shift();
+    return shift ? 1u << shift : 0;
+}
+
+// Find the slot an effect is cached in.
+static cache_slot_t* find_slot(size_t effect) {
+    for (size_t i = 0; i < EFFECT_CACHE_SLOTS; i++) {
+        if (slots[i].used && slots[i].effect == effect) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+// Bake one cycle of an effect into a cache slot, if it is cacheable and not cached already.
+// Returns whether the effect is cached.
+bool effect_cache_prepare(size_t effect) {
+    int shift = get_steps_shift();
+    if (!shift || (effects[effect].flags & EFFECT_CACHEABLE) != EFFECT_CACHEABLE) {
+        return false;
+    }
+    if (find_slot(effect)) {
+        return true;
+    }
+
+    // Replace the slot that was baked least recently; the other one may still be fading out.
+    cache_slot_t* slot = &slots[next_slot];
+    next_slot          = (next_slot + 1) % EFFECT_CACHE_SLOTS;
+    for (size_t i = 0; i < (1u << shift); i++) {
+        effects[effect].render(slot->frames[i].px, i << (16 - shift));
+    }
+    slot->used   = true;
+    slot->effect = effect;
+    return true;
+}
+
+// Forget all cached effects.
+void effect_cache_clear() {
+    for (size_t i = 0; i < EFFECT_CACHE_SLOTS; i++) {
+        slots[i].used = false;
+    }
+}
+
+// Render an effect, from the cache if it is cached.
+void effect_cache_render(size_t effect, rgb_t* fb, phase_t phase) {
+    cache_slot_t* slot = find_slot(effect);
+    if (!slot) {
+        effects[effect].render(fb, phase);
+        return;
+    }
+    int      shift = steps_shift;
+    uint16_t frac  = phase_frac(phase);
+    size_t   index = frac >> (16 - shift);
+#if CONFIG_EFFECT_CACHE_LERP
+    size_t   next   = (index + 1) & ((1u << shift) - 1);
+    uint16_t weight = (frac >> (8 - shift)) & 0xff;
+    rgb_blend(fb, slot->frames[index].px, slot->frames[next].px, LED_COUNT, weight);
+#else
+    memcpy(fb, slot->frames[index].px, sizeof(slot->frames[index].px));
+#endif
+}
@@ -0,0 +1,31 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Playback of periodic effects from one baked cycle.
+// Cacheable effects are rendered at a fixed number of phase steps when they are selected; frames are then looked up
+// and optionally interpolated instead of being computed.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "effects.h"
+#include "sdkconfig.h"
+
+// Number of effects that can be cached at the same time; two, so that both sides of a crossfade are cached.
+#define EFFECT_CACHE_SLOTS 2
+// Memory for all cache slots together, in bytes.
+#define EFFECT_CACHE_SIZE  CONFIG_EFFECT_CACHE_SIZE
+
+// Get the number of phase steps per cached cycle, or 0 if the budget is too small to cache anything.
+size_t effect_cache_steps();
+
+// Bake one cycle of an effect into a cache slot, if it is cacheable and not cached already.
+// Returns whether the effect is cached.
+bool effect_cache_prepare(size_t effect);
+
+// Forget all cached effects.
+void effect_cache_clear();
+
+// Render an effect, from the cache if it is cached.
+void effect_cache_render(size_t effect, rgb_t* fb, phase_t phase);
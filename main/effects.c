@@ -1,121 +1,351 @@
-
 // SPDX-CopyRightText: 2025 Julian Scheffers
 // SPDX-License-Identifer: MIT
 
 #include "effects.h"
-#include <esp_log.h>
-#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
-#include "bsp/led.h"
-#include "color.h"
 #include "flags.h"
+#include "image.h"
+#include "particles.h"
+#include "player.h"
 
-#define LED_COUNT 16
-
-// Brightness multiplier.
-float brightness = 1;
+// A simple hue spectrum effect.
+static void effect_hue_spectrum(rgb_t* fb, phase_t phase) {
+    for (size_t i = 0; i < LED_LENGTH; i++) {
+        fb[i] = q_hsv_to_rgb(phase + i * PHASE_ONE / LED_LENGTH, 255, 255);
+    }
+    led_extrude(fb);
+}
 
-// A static buffer to put LED data into.
-static uint8_t led_data[3 * LED_COUNT];
+// A uniform hue shift.
+static void effect_hue_single(rgb_t* fb, phase_t phase) {
+    rgb_t col = q_hsv_to_rgb(phase, 255, 255);
+    for (size_t i = 0; i < LED_COUNT; i++) {
+        fb[i] = col;
+    }
+}
 
-// Set the LED data for a particular LED.
-static inline void set_led(size_t index, rgb_t col) {
-    led_data[index * 3 + 0] = col.r * brightness;
-    led_data[index * 3 + 1] = col.g * brightness;
-    led_data[index * 3 + 2] = col.b * brightness;
+// A knight rider like effect.
+static void effect_knight_rider(rgb_t* fb, phase_t phase) {
+    int32_t frac = phase_frac(phase);
+#if LED_RING
+    // Head position in Q16; goes around the ring twice in a cycle, as fast as it moves on a strip.
+    uint16_t pos = frac * 2;
+#else
+    // Head position in Q16; bounces from one end to the other and back in a cycle.
+    int32_t pos = frac < PHASE_ONE / 2 ? frac * 2 : 2 * PHASE_ONE - frac * 2;
+#endif
+    for (size_t i = 0; i < LED_LENGTH; i++) {
+#if LED_RING
+        // Shortest way around the ring to the head, doubled so that the ring is not lit all around.
+        int32_t dist = (int16_t)(pos - i * PHASE_ONE / LED_LENGTH) * 2;
+#else
+        int32_t dist = pos - (int32_t)(i * PHASE_ONE / (LED_LENGTH > 1 ? LED_LENGTH - 1 : 1));
+#endif
+        uint32_t a = 0;
+        // Brightness falls off as 1 - 4.5 * dist^2, which reaches zero at 0.4714.
+        if (dist > -30894 && dist < 30894) {
+            uint32_t dist_sq = ((uint32_t)(dist * dist)) >> 16;
+            a                = PHASE_ONE - ((9 * dist_sq) >> 1);
+        }
+        fb[i] = (rgb_t){0, (a * 204) >> 16, (a * 255) >> 16};
+    }
+    led_extrude(fb);
 }
 
-// Update the LEDs.
-static void update_leds() {
-    bsp_led_write(led_data, sizeof(led_data));
+// Position in a list that moves on by one entry every cycle.
+typedef struct {
+    // Whether `cycles` and `index` are set.
+    bool     running;
+    // Cycle count of the last phase.
+    uint16_t cycles;
+    // Entry at the last phase.
+    size_t   index;
+} cycle_index_t;
+
+// Get the entry of a list of `len` entries to show at `phase`; unlike `phase_cycles(phase) % len`, it moves on by one
+// where the cycle count wraps around too. Jumps of less than half the cycle count move it either way.
+static size_t cycle_index(cycle_index_t* ci, phase_t phase, size_t len) {
+    uint16_t cycles = phase_cycles(phase);
+    if (!ci->running) {
+        ci->running = true;
+        ci->index   = cycles % len;
+    } else {
+        int32_t step = (int16_t)(cycles - ci->cycles) % (int32_t)len;
+        ci->index    = (ci->index % len + len + step) % len;
+    }
+    ci->cycles = cycles;
+    return ci->index;
 }
 
-// A simple hue spectrum effect.
-static void effect_hue_spectrum(float coeff) {
-    for (size_t i = 0; i < LED_COUNT; i++) {
-        set_led(i, f_hsv_to_rgb(coeff + i / (float)LED_COUNT, 1, 1));
+// Number of rasterised flags kept; the flag being shown and the one scrolling in.
+#define FLAG_STRIPS 2
+
+// Running sums of the channels of a rasterised flag.
+typedef struct {
+    uint32_t r, g, b;
+} flag_sum_t;
+
+// Rasterised flags as running sums: entry `i` is the sum of the first `i` samples.
+static flag_sum_t    flag_sums[FLAG_STRIPS][FLAG_STRIP_LEN + 1];
+// Index into `flags` of each rasterised flag, or -1.
+static int           flag_sums_flag[FLAG_STRIPS] = {-1, -1};
+// Buffer to rasterise into.
+static rgb16_t       flag_strip[FLAG_STRIP_LEN];
+// Flag being shown.
+static cycle_index_t flag_index;
+
+// Get the rasterised version of a flag, rasterising it over the strip that does not hold `keep` if needed.
+static flag_sum_t const* get_flag_sums(int flag, int keep) {
+    for (size_t i = 0; i < FLAG_STRIPS; i++) {
+        if (flag_sums_flag[i] == flag) {
+            return flag_sums[i];
+        }
+    }
+    size_t      slot = flag_sums_flag[0] == keep ? 1 : 0;
+    flag_sum_t* sums = flag_sums[slot];
+    flag_rasterise(&flags[flag], flag_strip);
+    sums[0] = (flag_sum_t){0, 0, 0};
+    for (size_t i = 0; i < FLAG_STRIP_LEN; i++) {
+        sums[i + 1].r = sums[i].r + flag_strip[i].r;
+        sums[i + 1].g = sums[i].g + flag_strip[i].g;
+        sums[i + 1].b = sums[i].b + flag_strip[i].b;
     }
-    update_leds();
+    flag_sums_flag[slot] = flag;
+    return sums;
 }
 
-// A uniform hue shift.
-static void effect_hue_single(float coeff) {
-    rgb_t col = f_hsv_to_rgb(coeff, 1, 1);
-    for (size_t i = 0; i < LED_COUNT; i++) {
-        set_led(i, col);
+// Get the running sum up to sample `i` of two flags put one after the other.
+static inline flag_sum_t flag_sum_at(flag_sum_t const* sums0, flag_sum_t const* sums1, uint32_t i) {
+    if (i <= FLAG_STRIP_LEN) {
+        return sums0[i];
     }
-    update_leds();
+    flag_sum_t const* a = &sums0[FLAG_STRIP_LEN];
+    flag_sum_t const* b = &sums1[i - FLAG_STRIP_LEN];
+    return (flag_sum_t){a->r + b->r, a->g + b->g, a->b + b->b};
 }
 
-// A knight rider like effect.
-static void effect_knight_rider(float coeff) {
-    coeff     = fmodf(coeff, 1);
-    float pos = coeff < 0.5 ? coeff * 2 : 2 - coeff * 2;
-    for (size_t i = 0; i < LED_COUNT; i++) {
-        float dist = pos - i / (float)(LED_COUNT - 1);
-        float a    = fmaxf(0, 1 - 4.5 * dist * dist);
-        set_led(i, f_rgb(0, a * 0.8, a));
+// An effect that scrolls through pride flags.
+static void effect_flags(rgb_t* fb, phase_t phase) {
+    int      flag0  = cycle_index(&flag_index, phase, flags_len);
+    int      flag1  = (flag0 + 1) % flags_len;
+    // Hold the flag for the first 3/4 of the cycle, then scroll to the next; Q16 fraction of the strip.
+    uint32_t scroll = phase_frac(phase) < 3 * PHASE_ONE / 4 ? 0 : 4 * (phase_frac(phase) - 3 * PHASE_ONE / 4);
+
+    // The two flags form one strip of `2 * FLAG_STRIP_LEN` samples; find the scroll position in Q8 samples.
+    flag_sum_t const* sums0 = get_flag_sums(flag0, flag1);
+    flag_sum_t const* sums1 = get_flag_sums(flag1, flag0);
+    uint32_t          pos   = (scroll * FLAG_STRIP_LEN) >> 8;
+    uint32_t          first = pos >> 8;
+    uint32_t          frac  = pos & 0xff;
+
+    // Box filter every LED over its samples, shifted by `frac` between sample `first` and `first + 1`.
+    // That is a blend of the sums over the samples starting at `first` and at `first + 1`.
+    flag_sum_t prev = flag_sum_at(sums0, sums1, first);
+    flag_sum_t next = flag_sum_at(sums0, sums1, first + 1);
+    for (size_t i = 0; i < LED_LENGTH; i++) {
+        uint32_t   end       = first + (i + 1) * FLAG_SUPERSAMPLE;
+        flag_sum_t end_prev = flag_sum_at(sums0, sums1, end);
+        flag_sum_t end_next = flag_sum_at(sums0, sums1, end + 1);
+        uint32_t   r        = (end_prev.r - prev.r) * (256 - frac) + (end_next.r - next.r) * frac;
+        uint32_t   g        = (end_prev.g - prev.g) * (256 - frac) + (end_next.g - next.g) * frac;
+        uint32_t   b        = (end_prev.b - prev.b) * (256 - frac) + (end_next.b - next.b) * frac;
+        prev                = end_prev;
+        next                = end_next;
+
+        // Sums are in Q8 samples of 16 bits; scale down to 8 bits, saturating in case of rounding.
+        fb[i] = (rgb_t){
+            sat_u8(r / (FLAG_SUPERSAMPLE * 257 * 256)),
+            sat_u8(g / (FLAG_SUPERSAMPLE * 257 * 256)),
+            sat_u8(b / (FLAG_SUPERSAMPLE * 257 * 256)),
+        };
     }
-    update_leds();
+    led_extrude(fb);
 }
 
-// Helper function for `project_flag` that projects a single color band.
-static void project_band(float start, float size, rgb_t col) {
-    // Normalize into pixel amounts.
-    start     *= LED_COUNT;
-    size      *= LED_COUNT;
-    float end  = start + size;
+// Image being shown by `effect_images`.
+static cycle_index_t image_index;
 
-    start = fmaxf(0, start);
-    end   = fminf(LED_COUNT, end);
+// An effect that scrolls through the column images in flash, one image per cycle.
+static void effect_images(rgb_t* fb, phase_t phase) {
+    // Images are loaded in the background at boot.
+    size_t len = __atomic_load_n(&images_len, __ATOMIC_ACQUIRE);
+    if (!len) {
+        // No images were found (yet); show something rather than nothing.
+        effect_hue_spectrum(fb, phase);
+        return;
+    }
+    image_t const* image   = &images[cycle_index(&image_index, phase, len)];
+    size_t         columns = (uint32_t)image->header->width * image->header->frames;
+    size_t         index   = (uint64_t)phase_frac(phase) * columns >> 16;
+    image_column(image, index / image->header->width, index % image->header->width, fb);
+    led_extrude(fb);
+}
 
-    if (start >= end) {
+// An effect that streams the column images and animations in flash, one column per 1/64th of a cycle.
+static void effect_player(rgb_t* fb, phase_t phase) {
+    if (!player_available()) {
+        // Nothing has been read (yet); show something rather than nothing.
+        effect_hue_spectrum(fb, phase);
         return;
     }
+    player_render(fb, phase);
+    led_extrude(fb);
+}
 
-    int led0 = floorf(start);
-    int led1 = ceilf(end);
+// Simulate a particle effect up to `phase` and draw it.
+static void render_particles(particles_t* ps, rgb_t* fb, phase_t phase) {
+    particles_run(ps, phase);
+    particles_render(ps, fb);
+    led_extrude(fb);
+}
 
-    for (int led = led0; led <= led1; led++) {
-        float cov = fminf(end, led + 1) - fmaxf(start, led);
-        if (cov > 0) {
-            led_data[led * 3 + 0] += col.r * cov;
-            led_data[led * 3 + 1] += col.g * cov;
-            led_data[led * 3 + 2] += col.b * cov;
-        }
-    }
+// Launch a comet from one end, or anywhere on a ring, in a random colour.
+static void comets_spawn(particles_t* ps) {
+    int32_t    vel   = particles_random_range(ps, PHASE_ONE / 2, 3 * PHASE_ONE / 2);
+    bool       up    = particles_random(ps) & 1;
+    particle_t comet = {
+        .pos   = LED_RING ? particles_random_range(ps, 0, PHASE_ONE) : up ? 0 : PHASE_ONE,
+        .vel   = up ? vel : -vel,
+        .decay = PHASE_ONE / 3,
+        .size  = PHASE_ONE / 32,
+        .tail  = PHASE_ONE / 3,
+        .col   = q_hsv_to_rgb(particles_random(ps), 255, 255),
+    };
+    particles_add(ps, &comet);
 }
 
-// Helper function for `effect_flags` that projects one flag onto (a portion of) the LEDs.
-static void project_flag(flag_t flag, float offset) {
-    float const band_size = 1.0f / flag.bands_len;
-    for (size_t i = 0; i < flag.bands_len; i++) {
-        project_band(offset + i * band_size, band_size, flag.bands[i]);
+// Comets with long tails.
+static particles_t comets = {
+    .edge     = PARTICLE_EDGE_DIE,
+    .interval = PHASE_ONE / 3,
+    .spawn    = comets_spawn,
+    .seed     = 0x636f6d65,
+};
+
+// Comets that shoot along the strip, fading out as they go.
+static void effect_comets(rgb_t* fb, phase_t phase) {
+    render_particles(&comets, fb, phase);
+}
+
+// Number of sparks in a burst.
+#define SPARKS_BURST 16
+
+// Throw a burst of sparks both ways from a random spot.
+static void sparks_spawn(particles_t* ps) {
+    int32_t pos = particles_random_range(ps, PHASE_ONE / 8, 7 * PHASE_ONE / 8);
+    for (size_t i = 0; i < SPARKS_BURST; i++) {
+        int32_t    vel   = particles_random_range(ps, PHASE_ONE / 4, 2 * PHASE_ONE);
+        particle_t spark = {
+            .pos   = pos,
+            .vel   = i & 1 ? vel : -vel,
+            .decay = particles_random_range(ps, 2 * PHASE_ONE, 4 * PHASE_ONE),
+            .size  = PHASE_ONE / 64,
+            .tail  = PHASE_ONE / 16,
+            // Red to yellow, some of them white hot.
+            .col   = q_hsv_to_rgb(particles_random_range(ps, 0, PHASE_ONE / 6), particles_random_range(ps, 64, 256),
+                                  255),
+        };
+        particles_add(ps, &spark);
     }
 }
 
-// An effect that scrolls through pride flags.
-static void effect_flags(float coeff) {
-    memset(led_data, 0, sizeof(led_data));
-    int flag0 = ((int)coeff) % flags_len;
-    int flag1 = (flag0 + 1) % flags_len;
-    coeff     = fminf(0, 3 - 4 * fmodf(coeff, 1));
-    project_flag(flags[flag0], coeff);
-    if (coeff) {
-        project_flag(flags[flag1], coeff + 1);
+// Sparks that slow down and burn out.
+static particles_t sparks = {
+    .edge     = PARTICLE_EDGE_DIE,
+    .drag     = 4 * PHASE_ONE,
+    .interval = PHASE_ONE / 2,
+    .spawn    = sparks_spawn,
+    .seed     = 0x73706b73,
+};
+
+// Bursts of sparks.
+static void effect_sparks(rgb_t* fb, phase_t phase) {
+    render_particles(&sparks, fb, phase);
+}
+
+// Number of bouncing dots.
+#define BOUNCING_DOTS 5
+
+// Add the dots, and throw the ones that came to rest at the bottom up again.
+static void bouncing_dots_spawn(particles_t* ps) {
+    for (size_t i = 0; i < ps->count; i++) {
+        if (ps->pos[i] < (int32_t)PHASE_ONE / 32 && abs(ps->vel[i]) < (int32_t)PHASE_ONE / 4) {
+            ps->vel[i] = particles_random_range(ps, 3 * PHASE_ONE, 5 * PHASE_ONE);
+        }
     }
-    for (size_t i = 0; i < sizeof(led_data); i++) {
-        led_data[i] = led_data[i] * brightness;
+    while (ps->count < BOUNCING_DOTS) {
+        particle_t dot = {
+            .pos  = LED_RING ? particles_random_range(ps, 0, PHASE_ONE) : 0,
+            .vel  = particles_random_range(ps, 3 * PHASE_ONE, 5 * PHASE_ONE),
+            .size = PHASE_ONE / 24,
+            .tail = PHASE_ONE / 24,
+            .col  = q_hsv_to_rgb(ps->count * PHASE_ONE / BOUNCING_DOTS, 255, 255),
+        };
+        particles_add(ps, &dot);
     }
-    update_leds();
+}
+
+// Dots that fall towards the first LED and bounce; on a ring, where there is no bottom, they circle instead.
+static particles_t bouncing_dots = {
+    .edge     = PARTICLE_EDGE_BOUNCE,
+    .gravity  = LED_RING ? 0 : 12 * PHASE_ONE,
+    .bounce   = 218,
+    .interval = PHASE_ONE / 4,
+    .spawn    = bouncing_dots_spawn,
+    .seed     = 0x646f7473,
+};
+
+// Bouncing dots in the colours of the rainbow.
+static void effect_bouncing_dots(rgb_t* fb, phase_t phase) {
+    render_particles(&bouncing_dots, fb, phase);
+}
+
+// Number of knight rider heads.
+#define KNIGHT_RIDERS 4
+
+// Add the heads, each at its own speed.
+static void knight_riders_spawn(particles_t* ps) {
+    while (ps->count < KNIGHT_RIDERS) {
+        int32_t    vel  = particles_random_range(ps, 3 * PHASE_ONE / 2, 5 * PHASE_ONE / 2);
+        particle_t head = {
+            .pos  = particles_random_range(ps, 0, PHASE_ONE),
+            .vel  = ps->count & 1 ? vel : -vel,
+            .size = PHASE_ONE / 16,
+            .tail = PHASE_ONE / 4,
+            .col  = {0, 204, 255},
+        };
+        particles_add(ps, &head);
+    }
+}
+
+// Knight rider heads that bounce between the ends without losing speed.
+static particles_t knight_riders = {
+    .edge     = PARTICLE_EDGE_BOUNCE,
+    .bounce   = 256,
+    .interval = PHASE_ONE,
+    .spawn    = knight_riders_spawn,
+    .seed     = 0x6b6e6974,
+};
+
+// Several knight rider heads at once, adding up where they cross.
+static void effect_knight_riders(rgb_t* fb, phase_t phase) {
+    render_particles(&knight_riders, fb, phase);
 }
 
 // Table of all effects.
 effect_t const effects[] = {
-    effect_hue_spectrum,
-    effect_hue_single,
-    effect_knight_rider,
-    effect_flags,
+    {"hue spectrum", effect_hue_spectrum, EFFECT_PERIODIC | EFFECT_PURE},
+    {"hue single", effect_hue_single, EFFECT_PERIODIC | EFFECT_PURE},
+    {"knight rider", effect_knight_rider, EFFECT_PERIODIC | EFFECT_PURE},
+    {"flags", effect_flags, EFFECT_PURE},
+    {"images", effect_images, 0},
+    {"player", effect_player, 0},
+    {"comets", effect_comets, 0},
+    {"sparks", effect_sparks, 0},
+    {"bouncing dots", effect_bouncing_dots, 0},
+    {"knight riders", effect_knight_riders, 0},
 };
 
 // Number of effects.
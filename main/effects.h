@@ -1,4 +1,3 @@
-
 // SPDX-CopyRightText: 2025 Julian Scheffers
 // SPDX-License-Identifer: MIT
 
@@ -6,12 +5,51 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "color.h"
+#include "leds.h"
+
+// Animation phase in Q16.16 cycles.
+// The integer part counts whole cycles, the fractional part is the position within the current cycle.
+typedef uint32_t phase_t;
+
+// One full cycle of an animation.
+#define PHASE_ONE ((phase_t)0x10000)
+
+// Get the position within the current cycle as a Q16 fraction.
+static inline uint16_t phase_frac(phase_t phase) {
+    return phase & 0xffff;
+}
+
+// Get the number of whole cycles in a phase.
+static inline uint16_t phase_cycles(phase_t phase) {
+    return phase >> 16;
+}
+
+// Render one frame of an effect at `phase` into `fb`, which holds `LED_COUNT` pixels.
+// Effects render at full brightness and must write every pixel; they draw along the line of `LED_LENGTH` pixels and
+// call `led_extrude` to fill the rest of a matrix.
+typedef void (*effect_render_t)(rgb_t* fb, phase_t phase);
+
+// The effect repeats every cycle: it only depends on `phase_frac(phase)`.
+#define EFFECT_PERIODIC  0x01
+// The effect only depends on the phase, not on images, files or other state; it may remember the last phase to count
+// cycles past the point where `phase_cycles` wraps around.
+#define EFFECT_PURE      0x02
+// Effects with all of these flags can be played back from a baked cycle.
+#define EFFECT_CACHEABLE (EFFECT_PERIODIC | EFFECT_PURE)
 
-// Brightness multiplier.
-extern float brightness;
+// An effect.
+typedef struct {
+    // Human-readable name, for logs and tools.
+    char const*     name;
+    // Render function.
+    effect_render_t render;
+    // Bitwise OR of `EFFECT_PERIODIC` and `EFFECT_PURE`.
+    uint8_t         flags;
+} effect_t;
 
-// An effect function.
-typedef void (*effect_t)(float coeff);
+// Index of the pride flags effect in `effects`.
+#define EFFECT_FLAGS 3
 
 // Table of all effects.
 extern effect_t const effects[];
@@ -66,3 +66,29 @@ flag_t const flags[] = {
 
 // Number of flags.
 size_t const flags_len = sizeof(flags) / sizeof(flag_t);
+
+// Rasterise a flag into `FLAG_STRIP_LEN` samples of 16 bits per channel, with exact coverage at the band edges.
+void flag_rasterise(flag_t const* flag, rgb16_t* strip) {
+    // Positions are in units of 1/bands_len samples, so that every band edge falls on a whole unit.
+    uint32_t const bands = flag->bands_len;
+    uint32_t       band  = 0;
+    for (uint32_t i = 0; i < FLAG_STRIP_LEN; i++) {
+        uint32_t start = i * bands;
+        uint32_t end   = start + bands;
+        uint32_t r = 0, g = 0, b = 0;
+        // Add up every band that overlaps the sample, weighted by how much of the sample it covers.
+        for (uint32_t pos = start; pos < end; band++) {
+            uint32_t band_end = (band + 1) * FLAG_STRIP_LEN;
+            uint32_t cov      = (band_end < end ? band_end : end) - pos;
+
+            r   += flag->bands[band].r * cov;
+            g   += flag->bands[band].g * cov;
+            b   += flag->bands[band].b * cov;
+            pos += cov;
+            if (band_end > end) {
+                break;
+            }
+        }
+        strip[i] = (rgb16_t){r * 257 / bands, g * 257 / bands, b * 257 / bands};
+    }
+}
@@ -6,6 +6,15 @@
 
 #include <stddef.h>
 #include "color.h"
+#include "effects.h"
+
+// Most samples in a rasterised flag; bounds the memory the flags effect needs on long strips.
+#define FLAG_MAX_SAMPLES 1024
+// Samples per LED in a rasterised flag; fewer on long strips, where the bands are many LEDs wide anyway.
+#define FLAG_SUPERSAMPLE                                                                                               \
+    (LED_LENGTH * 16 <= FLAG_MAX_SAMPLES ? 16 : LED_LENGTH < FLAG_MAX_SAMPLES ? FLAG_MAX_SAMPLES / LED_LENGTH : 1)
+// Number of samples in a rasterised flag.
+#define FLAG_STRIP_LEN   (FLAG_SUPERSAMPLE * LED_LENGTH)
 
 // A simple flag with horizontal color bands.
 typedef struct {
@@ -20,3 +29,6 @@ typedef struct {
 extern flag_t const flags[];
 // Number of flags.
 extern size_t const flags_len;
+
+// Rasterise a flag into `FLAG_STRIP_LEN` samples of 16 bits per channel, with exact coverage at the band edges.
+void flag_rasterise(flag_t const* flag, rgb16_t* strip);
@@ -0,0 +1,104 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "image.h"
+#include <string.h>
+#include "effects.h"
+
+// All registered images.
+image_t images[IMAGES_MAX];
+// Number of registered images.
+size_t  images_len;
+
+// Check a column image header and compute the size of one column in bytes.
+esp_err_t image_check_header(image_header_t const* header, size_t* column_size) {
+    if (memcmp(header->magic, IMAGE_MAGIC, 4) || header->version != IMAGE_VERSION) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (header->height == 0 || header->width == 0 || header->frames == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    switch (header->format) {
+        case IMAGE_FORMAT_RGB:
+            *column_size = header->height * sizeof(rgb_t);
+            break;
+        case IMAGE_FORMAT_PAL8:
+            *column_size = header->height;
+            break;
+        case IMAGE_FORMAT_PAL4:
+            *column_size = (header->height + 1) / 2;
+            break;
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+    if (header->format != IMAGE_FORMAT_RGB && header->palette_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+// Check a column image and point `image` into it; `data` must stay valid for as long as `image` is used.
+esp_err_t image_parse(image_t* image, void const* data, size_t size) {
+    image_header_t const* header = data;
+    if (size < sizeof(image_header_t)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t    column_size;
+    esp_err_t res = image_check_header(header, &column_size);
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    // In 64 bits, as the size of a broken header can exceed what fits in a `size_t`.
+    uint64_t palette_size = (uint64_t)header->palette_len * sizeof(rgb_t);
+    uint64_t data_size    = (uint64_t)column_size * header->width * header->frames;
+    if (size < sizeof(image_header_t) + palette_size + data_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    image->header      = header;
+    image->palette     = (rgb_t const*)(header + 1);
+    image->data        = (uint8_t const*)(header + 1) + palette_size;
+    image->column_size = column_size;
+    return ESP_OK;
+}
+
+// Check and register a column image, which must stay in memory.
+esp_err_t image_add(void const* data, size_t size) {
+    if (images_len >= IMAGES_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t res = image_parse(&images[images_len], data, size);
+    if (res == ESP_OK) {
+        // Images can be added while effects are being rendered; publish the image only once it is complete.
+        __atomic_store_n(&images_len, images_len + 1, __ATOMIC_RELEASE);
+    }
+    return res;
+}
+
+// Look up a palette entry, treating out-of-range indices as black.
+static inline rgb_t palette_get(image_t const* image, uint8_t index) {
+    return index < image->header->palette_len ? image->palette[index] : (rgb_t){0, 0, 0};
+}
+
+// Decode one column of an image into `LED_LENGTH` pixels.
+void image_column(image_t const* image, size_t frame, size_t x, rgb_t* out) {
+    image_header_t const* header = image->header;
+    uint8_t const*        column = image->data + (frame * header->width + x) * image->column_size;
+    for (size_t i = 0; i < LED_LENGTH; i++) {
+        // Nearest pixel, for images converted for a different LED count.
+        size_t y = header->height == LED_LENGTH ? i : i * header->height / LED_LENGTH;
+        switch (header->format) {
+            case IMAGE_FORMAT_RGB:
+                out[i] = ((rgb_t const*)column)[y];
+                break;
+            case IMAGE_FORMAT_PAL8:
+                out[i] = palette_get(image, column[y]);
+                break;
+            case IMAGE_FORMAT_PAL4:
+                out[i] = palette_get(image, (column[y / 2] >> (y % 2 * 4)) & 15);
+                break;
+        }
+    }
+}
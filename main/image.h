@@ -0,0 +1,75 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "color.h"
+#include "esp_err.h"
+
+// Magic bytes at the start of a column image.
+#define IMAGE_MAGIC   "LCOL"
+// Version of the column image layout.
+#define IMAGE_VERSION 1
+// Maximum number of images that can be registered.
+#define IMAGES_MAX    16
+// Where the locfd partition is mounted.
+#define LOCFD_PATH    "/locfd"
+
+// Pixel format of a column image.
+typedef enum {
+    // Three bytes per pixel.
+    IMAGE_FORMAT_RGB  = 0,
+    // One palette index per pixel.
+    IMAGE_FORMAT_PAL8 = 1,
+    // Two palette indices per byte, first pixel in the low nibble; columns start on a byte boundary.
+    IMAGE_FORMAT_PAL4 = 2,
+} image_format_t;
+
+// Header of a column image, as written by tools/png2col.py.
+// It is followed by `palette_len` RGB palette entries and then the pixel data, frame by frame and column by column.
+typedef struct __attribute__((packed)) {
+    char     magic[4];
+    uint8_t  version;
+    uint8_t  format;
+    // Pixels per column.
+    uint16_t height;
+    // Columns per frame.
+    uint16_t width;
+    // Number of frames.
+    uint16_t frames;
+    // Number of palette entries.
+    uint16_t palette_len;
+    // Time per frame in milliseconds.
+    uint16_t frame_delay_ms;
+} image_header_t;
+
+// A column image that has been checked and can be read in place.
+typedef struct {
+    image_header_t const* header;
+    rgb_t const*          palette;
+    uint8_t const*        data;
+    // Size of one column in bytes.
+    size_t                column_size;
+} image_t;
+
+// All registered images.
+extern image_t images[IMAGES_MAX];
+// Number of registered images.
+extern size_t  images_len;
+
+// Check a column image header and compute the size of one column in bytes.
+esp_err_t image_check_header(image_header_t const* header, size_t* column_size);
+
+// Check a column image and point `image` into it; `data` must stay valid for as long as `image` is used.
+esp_err_t image_parse(image_t* image, void const* data, size_t size);
+
+// Check and register a column image, which must stay in memory.
+esp_err_t image_add(void const* data, size_t size);
+
+// Decode one column of an image into `LED_LENGTH` pixels.
+void image_column(image_t const* image, size_t frame, size_t x, rgb_t* out);
+
+// Map all column images in the locfd partition, without copying them.
+esp_err_t images_load();
@@ -0,0 +1,106 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Maps the column images of the locfd FAT partition straight out of flash.
+// The partition is a read-only FAT image without wear levelling, generated at build time, so every file is one
+// contiguous run of clusters and can be read in place through the flash cache.
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "diskio_impl.h"
+#include "diskio_rawflash.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_vfs_fat.h"
+#include "ff.h"
+#include "image.h"
+
+static char const TAG[] = "image";
+
+// Find the offset of a file in its partition; fails if the file is not stored contiguously.
+static esp_err_t file_offset(BYTE pdrv, char const* name, size_t* offset, size_t* size) {
+    char path[16 + FF_MAX_LFN];
+    snprintf(path, sizeof(path), "%u:/%s", pdrv, name);
+
+    FIL fil;
+    if (f_open(&fil, path, FA_READ) != FR_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    FATFS* fs = fil.obj.fs;
+#if FF_MAX_SS != FF_MIN_SS
+    size_t sector_size = fs->ssize;
+#else
+    size_t sector_size = FF_MAX_SS;
+#endif
+    size_t  cluster_size = fs->csize * sector_size;
+    DWORD   first        = fil.obj.sclust;
+    FSIZE_t len          = f_size(&fil);
+
+    // Seeking one byte into every cluster makes FatFs follow the chain; every step must be the next cluster.
+    esp_err_t res = ESP_OK;
+    for (FSIZE_t pos = cluster_size; pos < len && res == ESP_OK; pos += cluster_size) {
+        if (f_lseek(&fil, pos + 1) != FR_OK || fil.clust != first + pos / cluster_size) {
+            res = ESP_ERR_INVALID_STATE;
+        }
+    }
+    f_close(&fil);
+    if (res != ESP_OK || first < 2) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *offset = (fs->database + (LBA_t)(first - 2) * fs->csize) * sector_size;
+    *size   = len;
+    return ESP_OK;
+}
+
+// Map all column images in the locfd partition, without copying them.
+esp_err_t images_load() {
+    esp_partition_t const* part =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, "locfd");
+    if (!part) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_vfs_fat_mount_config_t const mount_config = {
+        .max_files = 2,
+    };
+    esp_err_t res = esp_vfs_fat_spiflash_mount_ro(LOCFD_PATH, "locfd", &mount_config);
+    if (res != ESP_OK) {
+        return res;
+    }
+    BYTE pdrv = ff_diskio_get_pdrv_raw(part);
+
+    // Map the whole partition once; images point straight into it.
+    void const*                 base;
+    esp_partition_mmap_handle_t map;
+    res = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &base, &map);
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    DIR* dir = opendir(LOCFD_PATH);
+    if (!dir) {
+        return ESP_FAIL;
+    }
+    struct dirent* ent;
+    while ((ent = readdir(dir))) {
+        size_t name_len = strlen(ent->d_name);
+        if (name_len < 4 || strcasecmp(ent->d_name + name_len - 4, ".col")) {
+            continue;
+        }
+        size_t offset, size;
+        res = file_offset(pdrv, ent->d_name, &offset, &size);
+        if (res == ESP_OK && offset + size <= part->size) {
+            res = image_add((uint8_t const*)base + offset, size);
+        }
+        if (res != ESP_OK) {
+            ESP_LOGW(TAG, "Skipping %s: %s", ent->d_name, esp_err_to_name(res));
+        }
+    }
+    closedir(dir);
+
+    ESP_LOGI(TAG, "Mapped %zu images", images_len);
+    return ESP_OK;
+}
@@ -0,0 +1,86 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// LED geometry of the target, fixed at compile time by the "LED layout" Kconfig options in sdkconfigs/<device>.
+// Effects draw one line of `LED_LENGTH` pixels: the whole strip or ring, or the first column of a matrix, which
+// `led_extrude` then copies to the other columns. On strips and rings that is a no-op that compiles away.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "color.h"
+#include "sdkconfig.h"
+
+// Number of LEDs in a frame.
+#define LED_COUNT CONFIG_LED_COUNT
+
+#if CONFIG_LED_LAYOUT_MATRIX
+// Number of columns of the matrix.
+#define LED_COLUMNS CONFIG_LED_MATRIX_WIDTH
+#else
+#define LED_COLUMNS 1
+#endif
+
+// Number of pixels in the line that effects draw.
+#define LED_LENGTH (LED_COUNT / LED_COLUMNS)
+
+// Whether the ends of the line are next to each other, so that effects can wrap around instead of bouncing.
+#if CONFIG_LED_LAYOUT_RING
+#define LED_RING 1
+#else
+#define LED_RING 0
+#endif
+
+_Static_assert(LED_COUNT % LED_COLUMNS == 0, "LED_COUNT must be a multiple of LED_MATRIX_WIDTH");
+
+// Offsets of the channels within the three bytes sent to an LED.
+#if CONFIG_LED_ORDER_GRB
+#define LED_OFFSET_R 1
+#define LED_OFFSET_G 0
+#define LED_OFFSET_B 2
+#elif CONFIG_LED_ORDER_BRG
+#define LED_OFFSET_R 1
+#define LED_OFFSET_G 2
+#define LED_OFFSET_B 0
+#elif CONFIG_LED_ORDER_RBG
+#define LED_OFFSET_R 0
+#define LED_OFFSET_G 2
+#define LED_OFFSET_B 1
+#elif CONFIG_LED_ORDER_GBR
+#define LED_OFFSET_R 2
+#define LED_OFFSET_G 0
+#define LED_OFFSET_B 1
+#elif CONFIG_LED_ORDER_BGR
+#define LED_OFFSET_R 2
+#define LED_OFFSET_G 1
+#define LED_OFFSET_B 0
+#else
+#define LED_OFFSET_R 0
+#define LED_OFFSET_G 1
+#define LED_OFFSET_B 2
+#endif
+
+// Store levels into `px` in the channel order the LEDs expect; the result is only meant for `bsp_led_write`.
+static inline void led_store(rgb_t* px, uint8_t r, uint8_t g, uint8_t b) {
+    uint8_t* raw      = (uint8_t*)px;
+    raw[LED_OFFSET_R] = r;
+    raw[LED_OFFSET_G] = g;
+    raw[LED_OFFSET_B] = b;
+}
+
+// Copy the line in the first `LED_LENGTH` pixels of `fb` to every column of the frame.
+// A matrix is wired row by row, in either direction; every row becomes a single colour, so the direction does not
+// matter. Rows are filled from the last one back, so that no pixel of the line is overwritten before it is copied.
+static inline void led_extrude(rgb_t* fb) {
+#if LED_COLUMNS > 1
+    for (size_t y = LED_LENGTH; y-- > 0;) {
+        rgb_t col = fb[y];
+        for (size_t x = 0; x < LED_COLUMNS; x++) {
+            fb[y * LED_COLUMNS + x] = col;
+        }
+    }
+#else
+    (void)fb;
+#endif
+}
@@ -0,0 +1,110 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "lz.h"
+#include <string.h>
+
+// Mask for positions in the window.
+#define WINDOW_MASK (LZ_WINDOW_SIZE - 1)
+
+// Check the header once it is complete.
+static esp_err_t apply_header(lz_t* lz) {
+    lz_header_t const* header = &lz->header;
+    if (memcmp(header->magic, LZ_MAGIC, sizeof(header->magic)) || header->version != LZ_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header->window_bits < 1 || header->window_bits > LZ_WINDOW_BITS_MAX || header->length_bits < 1 ||
+        header->length_bits > LZ_LENGTH_BITS_MAX) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    lz->match_bits = 1 + header->window_bits + header->length_bits;
+    lz->min_match  = LZ_MIN_MATCH(header->window_bits, header->length_bits);
+    return ESP_OK;
+}
+
+// Write out the part of the window decompressed since it was last written out.
+static esp_err_t flush(lz_t* lz) {
+    size_t len = lz->out & WINDOW_MASK ? lz->out & WINDOW_MASK : LZ_WINDOW_SIZE;
+    return lz->write(lz->ctx, lz->window, len);
+}
+
+// Decode the tokens in `bits`, leaving a partial token for the next byte.
+static esp_err_t decode(lz_t* lz) {
+    esp_err_t res = ESP_OK;
+    while (res == ESP_OK && lz->bit_count && lz->out < lz->header.size) {
+        uint32_t len;
+        uint32_t dist;
+        if (lz->bits >> (lz->bit_count - 1) & 1) {
+            if (lz->bit_count < 9) {
+                break;
+            }
+            lz->bit_count                     -= 9;
+            lz->window[lz->out++ & WINDOW_MASK] = lz->bits >> lz->bit_count;
+            if (!(lz->out & WINDOW_MASK) || lz->out == lz->header.size) {
+                res = flush(lz);
+            }
+            continue;
+        }
+        if (lz->bit_count < lz->match_bits) {
+            break;
+        }
+        lz->bit_count  -= lz->match_bits;
+        uint32_t token  = lz->bits >> lz->bit_count;
+        len             = (token & ((1 << lz->header.length_bits) - 1)) + lz->min_match;
+        dist            = (token >> lz->header.length_bits & ((1 << lz->header.window_bits) - 1)) + 1;
+        if (dist > lz->out || len > lz->header.size - lz->out) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        while (res == ESP_OK && len--) {
+            lz->window[lz->out & WINDOW_MASK] = lz->window[(lz->out - dist) & WINDOW_MASK];
+            lz->out++;
+            if (!(lz->out & WINDOW_MASK) || lz->out == lz->header.size) {
+                res = flush(lz);
+            }
+        }
+    }
+    return res;
+}
+
+// Start decompressing a stream.
+void lz_init(lz_t* lz, lz_write_t write, void* ctx) {
+    memset(lz, 0, offsetof(lz_t, window));
+    lz->write = write;
+    lz->ctx   = ctx;
+}
+
+// Decompress the next `len` bytes of the stream; they can be split anywhere.
+esp_err_t lz_feed(lz_t* lz, void const* data, size_t len) {
+    uint8_t const* pos = data;
+    uint8_t const* end = pos + len;
+    esp_err_t      res = ESP_OK;
+    if (lz->header_len < sizeof(lz_header_t)) {
+        size_t chunk = sizeof(lz_header_t) - lz->header_len;
+        chunk        = chunk < len ? chunk : len;
+        memcpy((uint8_t*)&lz->header + lz->header_len, pos, chunk);
+        lz->header_len += chunk;
+        pos            += chunk;
+        if (lz->header_len < sizeof(lz_header_t)) {
+            return ESP_OK;
+        }
+        res = apply_header(lz);
+    }
+    while (res == ESP_OK && pos < end) {
+        if (lz->out == lz->header.size) {
+            // Only the padding of the last byte may follow the last token.
+            return ESP_ERR_INVALID_SIZE;
+        }
+        lz->bits       = lz->bits << 8 | *pos++;
+        lz->bit_count += 8;
+        res            = decode(lz);
+    }
+    return res;
+}
+
+// Check that the whole stream was decompressed.
+esp_err_t lz_finish(lz_t const* lz) {
+    if (lz->header_len < sizeof(lz_header_t) || lz->out != lz->header.size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,81 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Streaming decompression of LZSS-compressed updates.
+// A compressed stream is a header followed by a bitstream of tokens, most significant bit first: a 1 bit and 8 bits
+// of literal, or a 0 bit, `window_bits` bits of distance - 1 and `length_bits` bits of length - `LZ_MIN_MATCH`.
+// The decompressed data is kept in a fixed window of `LZ_WINDOW_SIZE` bytes and written out whenever it fills up.
+// tools/lzpack.py compresses.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Magic bytes at the start of a compressed stream.
+#define LZ_MAGIC           "BLZS"
+// Version of the compressed format.
+#define LZ_VERSION         1
+// Largest `window_bits` that can be decompressed.
+#define LZ_WINDOW_BITS_MAX 12
+// Size of the window buffer.
+#define LZ_WINDOW_SIZE     (1 << LZ_WINDOW_BITS_MAX)
+// Largest `length_bits` that can be decompressed.
+#define LZ_LENGTH_BITS_MAX 8
+
+// Shortest match for a window and length size: the shortest match that is smaller than the literals it replaces.
+#define LZ_MIN_MATCH(window_bits, length_bits) ((1 + (window_bits) + (length_bits)) / 9 + 1)
+
+// Compressed stream header; all numbers are little-endian.
+typedef struct __attribute__((packed)) {
+    // Must be `LZ_MAGIC`.
+    char     magic[4];
+    // Must be `LZ_VERSION`.
+    uint8_t  version;
+    // Number of bits of a match distance.
+    uint8_t  window_bits;
+    // Number of bits of a match length.
+    uint8_t  length_bits;
+    // Must be zero.
+    uint8_t  reserved;
+    // Size of the decompressed data.
+    uint32_t size;
+} lz_header_t;
+
+// Receives decompressed data.
+typedef esp_err_t (*lz_write_t)(void* ctx, void const* data, size_t len);
+
+// State of a stream being decompressed.
+typedef struct {
+    // Receives the decompressed data.
+    lz_write_t  write;
+    // Passed to `write`.
+    void*       ctx;
+    // The header, once received.
+    lz_header_t header;
+    // Number of bytes of the header received.
+    size_t      header_len;
+    // Number of bits of a match token, including the flag.
+    uint8_t     match_bits;
+    // Length of the shortest match.
+    uint8_t     min_match;
+    // Bits received but not decoded yet, in the lowest `bit_count` bits.
+    uint32_t    bits;
+    // Number of bits in `bits`.
+    uint8_t     bit_count;
+    // Number of bytes decompressed.
+    uint32_t    out;
+    // The last `LZ_WINDOW_SIZE` bytes decompressed, at their position modulo `LZ_WINDOW_SIZE`.
+    uint8_t     window[LZ_WINDOW_SIZE];
+} lz_t;
+
+// Start decompressing a stream.
+void lz_init(lz_t* lz, lz_write_t write, void* ctx);
+
+// Decompress the next `len` bytes of the stream; they can be split anywhere.
+esp_err_t lz_feed(lz_t* lz, void const* data, size_t len);
+
+// Check that the whole stream was decompressed.
+esp_err_t lz_finish(lz_t const* lz);
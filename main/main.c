@@ -1,4 +1,4 @@
-#include <math.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include "bsp/device.h"
 #include "bsp/i2c.h"
@@ -8,157 +8,424 @@
 #include "effects.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "flags.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "image.h"
 #include "nvs_flash.h"
+#include "perf.h"
+#include "player.h"
+#include "playlist.h"
+#include "pov.h"
+#include "render.h"
+#include "settings.h"
+#include "stream.h"
 #include "wifi_connection.h"
 #include "wifi_ota.h"
 #include "wifi_settings.h"
 
-#define MAX_SPEED 2.0   // Every 500ms
-#define DEF_SPEED 0.25  // Every 4s
+// Speed in thousandths of a cycle per second, see `render_set_speed`.
+#define MAX_SPEED 2000  // Every 500ms
+#define DEF_SPEED 250   // Every 4s
 #define MIN_SPEED 0     // Stopped
-#define INC_SPEED 0.05
+#define INC_SPEED 50
 
-#define OTA_BASE_URL "https://selfsigned.ota.badge.team/bornhack2024-"
+// Brightness in Q8, see `brightness`.
+#define MAX_BRIGHTNESS 256
+#define MIN_BRIGHTNESS 26
+#define INC_BRIGHTNESS 26
+// Number of brightness levels, see `brightness_levels`.
+#define BRIGHTNESS_LEVELS (sizeof(brightness_levels) / sizeof(brightness_levels[0]))
 
-#define MAX_BRIGHTNESS 1.0
-#define MIN_BRIGHTNESS 0.1
-#define INC_BRIGHTNESS 0.1
+#define NVS_NAMESPACE      "bh24effect"
+#define STATS_LOG_INTERVAL 60000000
+// Longest wait for input that is timed in one go, in milliseconds; longer waits overflow the cycle counter.
+#define PERF_MAX_WAIT_MS   5000
 
-#define SETTINGS_SAVE_DELAY 1000000
+static uint32_t   effect_no  = 0;
+static uint32_t   speed      = DEF_SPEED;
+static uint16_t   brightness = MAX_BRIGHTNESS;
+static char const TAG[]      = "main";
+static playlist_t playlist;
 
-static uint32_t   effect_no = 0;
-static float      speed     = DEF_SPEED;
-static char const TAG[]     = "main";
+// Brightness levels the buttons step through, up and down alike: every `INC_BRIGHTNESS` from `MIN_BRIGHTNESS`, and
+// `MAX_BRIGHTNESS` last. Also the levels of the brightness steps stored by older firmware.
+static uint16_t const brightness_levels[] = {26, 52, 78, 104, 130, 156, 182, 208, 234, 256};
 
-static void load_effect_settings(nvs_handle_t nvs_handle) {
-    uint32_t speed_proxy = UINT32_MAX, brightness_proxy = UINT32_MAX;
-    nvs_get_u32(nvs_handle, "effect_no", &effect_no);
-    if (effect_no >= effects_len) {
+// Get the next brightness level above `level`, or below if not `up`; stays at the first or last level.
+static uint16_t step_brightness(uint16_t level, bool up) {
+    if (up) {
+        size_t i = 0;
+        while (i < BRIGHTNESS_LEVELS - 1 && brightness_levels[i] <= level) {
+            i++;
+        }
+        return brightness_levels[i];
+    }
+    size_t i = BRIGHTNESS_LEVELS - 1;
+    while (i > 0 && brightness_levels[i] >= level) {
+        i--;
+    }
+    return brightness_levels[i];
+}
+
+// Hand the current settings to the settings writer, which stores them once they stop changing.
+static void store_settings() {
+    settings_t settings = {
+        .effect_no  = effect_no,
+        .speed      = speed,
+        .brightness = brightness,
+        .playlist   = playlist,
+    };
+    settings_store(&settings);
+}
+
+// Read the settings as they were stored before they were kept in one record; returns false if there were none.
+// The old keys are left alone, so nothing is lost if the badge is switched off before the record is written; once it
+// has been, they are no longer looked at.
+static bool migrate_legacy_settings(settings_t* settings) {
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return false;
+    }
+    uint32_t legacy_effect_no, speed_proxy, brightness_proxy;
+    bool     found = false;
+    if (nvs_get_u32(nvs_handle, "effect_no", &legacy_effect_no) == ESP_OK) {
+        found               = true;
+        settings->effect_no = legacy_effect_no;
+    }
+    if (nvs_get_u32(nvs_handle, "speed", &speed_proxy) == ESP_OK) {
+        found           = true;
+        // Steps of `INC_SPEED`; the last one may be smaller to end at `MAX_SPEED`.
+        uint32_t max_proxy = (MAX_SPEED - MIN_SPEED + INC_SPEED - 1) / INC_SPEED;
+        speed_proxy        = speed_proxy < max_proxy ? speed_proxy : max_proxy;
+        settings->speed    = MIN_SPEED + speed_proxy * INC_SPEED < MAX_SPEED ? MIN_SPEED + speed_proxy * INC_SPEED
+                                                                             : MAX_SPEED;
+    }
+    if (nvs_get_u32(nvs_handle, "brightness", &brightness_proxy) == ESP_OK) {
+        found                = true;
+        settings->brightness =
+            brightness_levels[brightness_proxy < BRIGHTNESS_LEVELS ? brightness_proxy : BRIGHTNESS_LEVELS - 1];
+    }
+    nvs_close(nvs_handle);
+    return found;
+}
+
+// Load the settings, falling back to the defaults for anything that is invalid, and start the settings writer.
+static void load_settings() {
+    settings_t settings = {
+        .effect_no  = 0,
+        .speed      = DEF_SPEED,
+        .brightness = MAX_BRIGHTNESS,
+    };
+    playlist_defaults(&settings.playlist);
+    esp_err_t res      = settings_start(NVS_NAMESPACE, &settings);
+    bool      migrated = res == ESP_ERR_NOT_FOUND && migrate_legacy_settings(&settings);
+    if (res != ESP_OK && res != ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "Failed to load settings: %s; settings cannot be stored", esp_err_to_name(res));
+    }
+
+    effect_no         = settings.effect_no;
+    bool effect_valid = effect_no < effects_len || effect_no == PLAYLIST_EFFECT_NO;
+#ifdef CONFIG_BSP_TARGET_BORNHACK_2024_POV
+    effect_valid |= effect_no == POV_EFFECT_NO;
+#endif
+    if (!effect_valid) {
         effect_no = 0;
     }
-    nvs_get_u32(nvs_handle, "speed", &speed_proxy);
-    nvs_get_u32(nvs_handle, "brightness", &brightness_proxy);
-    if (speed_proxy != UINT32_MAX) {
-        speed = fminf(MAX_SPEED, speed_proxy * INC_SPEED + MIN_SPEED);
+    playlist   = settings.playlist;
+    speed      = settings.speed < MAX_SPEED ? settings.speed : MAX_SPEED;
+    brightness = settings.brightness < MIN_BRIGHTNESS   ? MIN_BRIGHTNESS
+                 : settings.brightness < MAX_BRIGHTNESS ? settings.brightness
+                                                        : MAX_BRIGHTNESS;
+    if (migrated) {
+        ESP_LOGI(TAG, "Converted settings to version %d", SETTINGS_VERSION);
     }
-    if (brightness_proxy != UINT32_MAX) {
-        brightness = fminf(MAX_BRIGHTNESS, brightness_proxy * INC_BRIGHTNESS + MIN_BRIGHTNESS);
+    // Writes whatever is not stored yet, like the default playlist on a new badge; nothing if all of it is.
+    store_settings();
+}
+
+#ifdef CONFIG_BSP_TARGET_BORNHACK_2024_POV
+// Image shown in POV mode.
+static pov_t pov;
+
+// Switch between rendering effects and POV playback.
+static void set_pov_mode(bool enable) {
+    if (enable) {
+        render_pause();
+        if (images_len) {
+            pov_load_image(&pov, &images[0], brightness);
+        } else {
+            pov_load_effect(&pov, &effects[EFFECT_FLAGS], POV_MAX_COLUMNS, flags_len, brightness);
+        }
+        ESP_ERROR_CHECK(pov_start(&pov));
+    } else {
+        pov_stop();
+        ESP_ERROR_CHECK(render_resume());
     }
 }
+#endif
 
-static void store_effect_settings(nvs_handle_t nvs_handle) {
-    nvs_set_u32(nvs_handle, "effect_no", effect_no);
-    nvs_set_u32(nvs_handle, "speed", (speed - MIN_SPEED + 0.001) / INC_SPEED);
-    nvs_set_u32(nvs_handle, "brightness", (brightness - MIN_BRIGHTNESS + 0.001) / INC_BRIGHTNESS);
-    nvs_commit(nvs_handle);
+// Go to the next effect, or from the last effect into playlist mode (and POV mode on the POV badge).
+static void next_effect() {
+#ifdef CONFIG_BSP_TARGET_BORNHACK_2024_POV
+    if (effect_no == PLAYLIST_EFFECT_NO) {
+        effect_no = POV_EFFECT_NO;
+        ESP_LOGI(TAG, "POV mode");
+        set_pov_mode(true);
+        return;
+    } else if (effect_no == POV_EFFECT_NO) {
+        // Leave POV mode and continue as if coming from playlist mode.
+        set_pov_mode(false);
+        effect_no = PLAYLIST_EFFECT_NO;
+    }
+#endif
+    if (effect_no == PLAYLIST_EFFECT_NO) {
+        effect_no = 0;
+        ESP_LOGI(TAG, "Effect changed to %u", effect_no);
+    } else if (effect_no + 1 < effects_len) {
+        effect_no++;
+        ESP_LOGI(TAG, "Effect changed to %u", effect_no);
+    } else {
+        effect_no = PLAYLIST_EFFECT_NO;
+        ESP_LOGI(TAG, "Playlist mode");
+    }
+    render_set_effect(effect_no);
 }
 
 bool wifi_stack_get_initialized(void) {
     return true;
 }
 
+// Start the Wi-Fi stack with the event network added, for updates and streams.
+static void wifi_init() {
+    wifi_connection_init_stack();
+
+    wifi_settings_t settings = {
+        .ssid     = "bornhack-nat",
+        .authmode = WIFI_AUTH_OPEN,
+    };
+    wifi_settings_set(0, &settings);
+}
+
 static void firmware_update_callback(const char* status_text, uint8_t progress) {
     printf("OTA status changed [%u%%]: %s\r\n", progress, status_text);
-    double  progress_leds            = (progress * 16.0f) / 100.0f;
-    double  progress_leds_integer    = 0;
-    double  progress_leds_fractional = modf(progress_leds, &progress_leds_integer);
-    uint8_t led_data[3 * 16]         = {0};
-    for (uint8_t led = 0; led < 16; led++) {
-        if (led < (uint8_t)(progress_leds_integer)) {
-            led_data[3 * led + 0] = 0;
-            led_data[3 * led + 1] = 64;
-            led_data[3 * led + 2] = 0;
+    // Progress bar over all LEDs in Q8 LEDs; the LED at the end of the bar fades from red to green.
+    uint32_t progress_leds = progress * LED_COUNT * 256 / 100;
+    uint32_t done          = progress_leds >> 8;
+    uint32_t fraction      = progress_leds & 0xff;
+    rgb_t    led_data[LED_COUNT];
+    for (size_t led = 0; led < LED_COUNT; led++) {
+        if (led < done) {
+            led_store(&led_data[led], 0, 64, 0);
+        } else if (led == done) {
+            led_store(&led_data[led], 64 * (256 - fraction) >> 8, 64 * fraction >> 8, 16);
         } else {
-            led_data[3 * led + 0] = 64;
-            led_data[3 * led + 1] = 0;
-            led_data[3 * led + 2] = 0;
+            led_store(&led_data[led], 64, 0, 0);
         }
     }
-    led_data[3 * (uint8_t)(progress_leds_integer) + 0] = 64 * (1.0f - progress_leds_fractional);
-    led_data[3 * (uint8_t)(progress_leds_integer) + 1] = 64 * (progress_leds_fractional);
-    led_data[3 * (uint8_t)(progress_leds_integer) + 2] = 16;
-    bsp_led_write(led_data, sizeof(led_data));
+    bsp_led_write((uint8_t*)led_data, sizeof(led_data));
+}
+
+// Maximum number of boot stages that are timed.
+#define BOOT_STAGES_MAX 8
+
+// A timed boot stage.
+typedef struct {
+    // Name of the stage, for the log.
+    char const* name;
+    // Time at which the stage finished, in microseconds since boot.
+    int64_t     end_us;
+} boot_stage_t;
+
+// Boot stages, in the order they finished.
+static boot_stage_t boot_stages[BOOT_STAGES_MAX];
+// Number of boot stages that finished.
+static size_t       boot_stages_len;
+
+// Record that a boot stage finished just now.
+static void boot_stage(char const* name) {
+    if (boot_stages_len < BOOT_STAGES_MAX) {
+        boot_stages[boot_stages_len++] = (boot_stage_t){name, esp_timer_get_time()};
+    }
+}
+
+// Log how long each boot stage took and when the first frame was sent to the LEDs.
+static void log_boot_stages() {
+    int64_t prev = 0;
+    for (size_t i = 0; i < boot_stages_len; i++) {
+        ESP_LOGI(TAG, "Boot: %-8s %6" PRId64 " us, done at %6" PRId64 " us", boot_stages[i].name,
+                 boot_stages[i].end_us - prev, boot_stages[i].end_us);
+        prev = boot_stages[i].end_us;
+    }
+    // The first frame usually goes out while the images are still being loaded.
+    render_stats_t stats;
+    render_get_stats(&stats);
+    for (int i = 0; i < 10 && !stats.first_frame_us; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        render_get_stats(&stats);
+    }
+    ESP_LOGI(TAG, "Boot: first light at %" PRId64 " us", stats.first_frame_us);
+}
+
+// Whether the effect shown at boot needs the images.
+static bool effect_needs_images() {
+    if (effect_no == PLAYLIST_EFFECT_NO) {
+        return !(effects[playlist.entries[0].effect].flags & EFFECT_PURE);
+    }
+    return effect_no >= effects_len || !(effects[effect_no].flags & EFFECT_PURE);
+}
+
+// Map the images and start streaming them.
+static void load_images() {
+    esp_err_t image_res = images_load();
+    if (image_res != ESP_OK) {
+        ESP_LOGW(TAG, "No images available: %s", esp_err_to_name(image_res));
+    } else {
+        ESP_ERROR_CHECK(player_start(LOCFD_PATH));
+    }
+    boot_stage("images");
 }
 
 void app_main() {
+    boot_stage("startup");
     esp_err_t nvs_res = nvs_flash_init();
     if (nvs_res == ESP_ERR_NVS_NO_FREE_PAGES || nvs_res == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         nvs_res = nvs_flash_init();
     }
-
-    float coeff = 0;
-
-    nvs_handle_t nvs_handle;
     if (nvs_res != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to init NVS; settings cannot be stored");
-    } else {
-        nvs_res = nvs_open("bh24effect", NVS_READWRITE, &nvs_handle);
-    }
-    if (nvs_res == ESP_OK) {
-        load_effect_settings(nvs_handle);
+        ESP_LOGW(TAG, "Failed to init NVS: %s", esp_err_to_name(nvs_res));
     }
+    boot_stage("nvs");
+    load_settings();
+    boot_stage("settings");
 
     ESP_ERROR_CHECK(bsp_device_initialize());
-
     if (bsp_device_get_initialized_without_coprocessor()) {
         ESP_LOGE(TAG, "Coprocessor not initialized");
         return;
     }
-
     QueueHandle_t event_queue;
     ESP_ERROR_CHECK(bsp_input_get_queue(&event_queue));
+    boot_stage("bsp");
 
     ESP_LOGI(TAG, "Bornhack 2024 LEDs firmware starting");
 
     bool do_cycle = true;
 
-    ESP_ERROR_CHECK(initialize_custom_ca_store());
-
 #ifdef CONFIG_BSP_TARGET_BORNHACK_2024_POV
     bool do_update = false;
     bsp_input_read_navigation_key(BSP_INPUT_NAVIGATION_KEY_UP, &do_update);
 
     if (do_update) {
-        wifi_connection_init_stack();
-
-        wifi_settings_t settings = {
-            .ssid     = "bornhack-nat",
-            .authmode = WIFI_AUTH_OPEN,
-        };
-        wifi_settings_set(0, &settings);
+        // Only the update needs TLS, so the certificates are not loaded on a normal boot.
+        ESP_ERROR_CHECK(initialize_custom_ca_store());
+        wifi_init();
 
         bool do_unstable = false;
         bsp_input_read_navigation_key(BSP_INPUT_NAVIGATION_KEY_DOWN, &do_unstable);
 
-        ota_update(do_unstable ? OTA_BASE_URL "staging.bin" : OTA_BASE_URL "stable.bin", firmware_update_callback);
+        ota_update(CONFIG_OTA_BASE_URL, do_unstable ? "staging" : "stable", firmware_update_callback);
         esp_restart();
     }
 #endif
 
-    int64_t prev_time           = esp_timer_get_time();
-    int64_t store_settings_when = INT64_MAX;
+    // Effects that do not need the images start before the images are loaded, so the LEDs light up sooner.
+    bool images_first = effect_needs_images();
+    if (images_first) {
+        load_images();
+    }
+
+    render_set_effect(effect_no == POV_EFFECT_NO ? 0 : effect_no);
+    render_set_speed(speed);
+    render_set_brightness(brightness);
+    render_set_playlist(&playlist);
+    ESP_ERROR_CHECK(render_start());
+    boot_stage("render");
+
+    if (!images_first) {
+        load_images();
+    }
+#if CONFIG_STREAM_RECEIVER
+    wifi_init();
+    ESP_ERROR_CHECK(stream_start());
+#endif
+#ifdef CONFIG_BSP_TARGET_BORNHACK_2024_POV
+    if (effect_no == POV_EFFECT_NO) {
+        set_pov_mode(true);
+    }
+#endif
+    log_boot_stages();
+#if CONFIG_PERF_COUNTERS
+    esp_err_t perf_res = perf_console_start();
+    if (perf_res != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start the console: %s", esp_err_to_name(perf_res));
+    }
+#endif
+
+    // Rendering and storing settings happen in their own tasks; this task only handles input.
+    int64_t log_stats_when = esp_timer_get_time() + STATS_LOG_INTERVAL;
     while (1) {
-        if (nvs_res == ESP_OK && esp_timer_get_time() > store_settings_when) {
-            store_settings_when = INT64_MAX;
-            store_effect_settings(nvs_handle);
+        int64_t now = esp_timer_get_time();
+        if (now >= log_stats_when) {
+            log_stats_when += STATS_LOG_INTERVAL;
+            render_stats_t stats;
+            render_get_stats(&stats);
+            ESP_LOGI(TAG, "Frames: %" PRIu32 " rendered, %" PRIu32 " dropped, %" PRIu32 " late, max %" PRIu32 " us",
+                     stats.frames_rendered, stats.frames_dropped, stats.deadline_misses, stats.max_frame_us);
+            ESP_LOGI(TAG, "Frames: %" PRIu32 " transmitted, %" PRIu32 " skipped, idle for %" PRIu64 " ms",
+                     stats.frames_transmitted, stats.frames_skipped, stats.idle_us / 1000);
+            ESP_LOGI(TAG, "LEDs: %" PRIu32 " mA, %" PRIu32 " frames limited, %" PRIu32 " mA peak unlimited",
+                     stats.current_ma, stats.limited_frames, stats.max_unlimited_ma);
+            player_stats_t player_stats;
+            player_get_stats(&player_stats);
+            if (player_stats.columns_read) {
+                ESP_LOGI(TAG, "Player: %" PRIu32 " columns read, %" PRIu32 " played, %" PRIu32 " stalls",
+                         player_stats.columns_read, player_stats.columns_played, player_stats.stalls);
+            }
+            settings_stats_t settings_stats;
+            settings_get_stats(&settings_stats);
+            ESP_LOGI(TAG, "Settings: %" PRIu32 " changes, %" PRIu32 " writes, %" PRIu32 " unchanged, max %" PRIu32 " us",
+                     settings_stats.requests, settings_stats.writes, settings_stats.unchanged,
+                     settings_stats.max_write_us);
+#if CONFIG_STREAM_RECEIVER
+            stream_stats_t stream_stats;
+            stream_get_stats(&stream_stats);
+            if (stream_stats.packets) {
+                ESP_LOGI(TAG, "Stream: %" PRIu32 " packets, %" PRIu32 " lost, %" PRIu32 " late, %" PRIu32 " ignored",
+                         stream_stats.packets, stream_stats.lost, stream_stats.late, stream_stats.ignored);
+                ESP_LOGI(TAG,
+                         "Stream: %" PRIu32 " frames, %" PRIu32 " shown, %" PRIu32 " skipped, %" PRIu32
+                         " overflows, %" PRIu32 " fallbacks",
+                         stream_stats.frames, stream_stats.shown, stream_stats.skipped, stream_stats.overflows,
+                         stream_stats.fallbacks);
+                ESP_LOGI(TAG, "Stream: latency %" PRIu32 " us average, %" PRIu32 " us max, jitter %" PRIu32 " us",
+                         stream_stats.latency_avg_us, stream_stats.latency_max_us, stream_stats.jitter_us);
+            }
+#endif
         }
 
-        // Check for events.
+        // Wait for events until stats need to be logged.
+        int64_t wait_ms = (log_stats_when - now) / 1000 + 1;
+#if CONFIG_PERF_COUNTERS
+        if (wait_ms > PERF_MAX_WAIT_MS) {
+            wait_ms = PERF_MAX_WAIT_MS;
+        }
+#endif
+
         bsp_input_event_t event;
-        if (xQueueReceive(event_queue, &event, pdMS_TO_TICKS(portTICK_PERIOD_MS * 2)) &&
-            event.type == INPUT_EVENT_TYPE_NAVIGATION) {
+        PERF_START(wait_start);
+        BaseType_t received = xQueueReceive(event_queue, &event, pdMS_TO_TICKS(wait_ms));
+        PERF_END(PERF_INPUT_WAIT, wait_start);
+        if (received && event.type == INPUT_EVENT_TYPE_NAVIGATION) {
             if (event.args_navigation.key == BSP_INPUT_NAVIGATION_KEY_SELECT ||
                 event.args_navigation.key == BSP_INPUT_NAVIGATION_KEY_RETURN) {
                 if (event.args_navigation.state) {
                     do_cycle = true;
                 } else if (do_cycle) {
                     // If select is released without up/down presses in the mean time, go to next effect.
-                    effect_no           = (effect_no + 1) % effects_len;
-                    store_settings_when = esp_timer_get_time() + SETTINGS_SAVE_DELAY;
-                    ESP_LOGI(TAG, "Effect changed to %u", effect_no);
+                    next_effect();
+                    store_settings();
                 }
             } else if (event.args_navigation.state &&
                        (event.args_navigation.key == BSP_INPUT_NAVIGATION_KEY_UP ||
@@ -170,15 +437,17 @@ void app_main() {
                 }
                 if (select) {
                     // Increase brightness.
-                    brightness = fminf(1, brightness + 0.1);
-                    do_cycle   = false;
-                    ESP_LOGI(TAG, "Brightness increased to %.1f", brightness);
+                    brightness = step_brightness(brightness, true);
+                    do_cycle = false;
+                    render_set_brightness(brightness);
+                    ESP_LOGI(TAG, "Brightness increased to %d%%", brightness * 100 / MAX_BRIGHTNESS);
                 } else {
                     // Increase speed.
-                    speed = fminf(MAX_SPEED, speed + INC_SPEED);
-                    ESP_LOGI(TAG, "Speed increased to %.1f", speed);
+                    speed = speed + INC_SPEED < MAX_SPEED ? speed + INC_SPEED : MAX_SPEED;
+                    render_set_speed(speed);
+                    ESP_LOGI(TAG, "Speed increased to %" PRIu32 ".%02" PRIu32, speed / 1000, speed % 1000 / 10);
                 }
-                store_settings_when = esp_timer_get_time() + SETTINGS_SAVE_DELAY;
+                store_settings();
             } else if (event.args_navigation.state &&
                        (event.args_navigation.key == BSP_INPUT_NAVIGATION_KEY_DOWN ||
                         event.args_navigation.key == BSP_INPUT_NAVIGATION_KEY_VOLUME_DOWN)) {
@@ -189,21 +458,18 @@ void app_main() {
                 }
                 if (select) {
                     // Decrease brightness.
-                    brightness = fmaxf(0.1, brightness - 0.1);
-                    do_cycle   = false;
-                    ESP_LOGI(TAG, "Brightness decreased to %.1f", brightness);
+                    brightness = step_brightness(brightness, false);
+                    do_cycle = false;
+                    render_set_brightness(brightness);
+                    ESP_LOGI(TAG, "Brightness decreased to %d%%", brightness * 100 / MAX_BRIGHTNESS);
                 } else {
                     // Decrease speed.
-                    speed = fmaxf(MIN_SPEED, speed - INC_SPEED);
-                    ESP_LOGI(TAG, "Speed decreased to %.1f", speed);
+                    speed = speed > MIN_SPEED + INC_SPEED ? speed - INC_SPEED : MIN_SPEED;
+                    render_set_speed(speed);
+                    ESP_LOGI(TAG, "Speed decreased to %" PRIu32 ".%02" PRIu32, speed / 1000, speed % 1000 / 10);
                 }
-                store_settings_when = esp_timer_get_time() + SETTINGS_SAVE_DELAY;
+                store_settings();
             }
         }
-
-        int64_t time  = esp_timer_get_time();
-        coeff        += speed * 0.000001 * (time - prev_time);
-        prev_time     = time;
-        effects[effect_no](coeff);
     }
 }
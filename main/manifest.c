@@ -0,0 +1,66 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "manifest.h"
+#include <string.h>
+
+// Compare a zero-padded field with a string.
+static bool field_equals(char const* field, size_t size, char const* str) {
+    size_t len = strnlen(str, size + 1);
+    return len <= size && !memcmp(field, str, len) && (len == size || field[len] == 0);
+}
+
+// Find what the manifest in `data` offers on `channel` to a badge running `running_version`.
+// Returns `ESP_ERR_INVALID_VERSION` if it is not a valid manifest and `ESP_ERR_NOT_FOUND` if the channel is not in it.
+esp_err_t manifest_find(void const* data, size_t len, char const* channel, char const* running_version,
+                        manifest_entry_t* entry) {
+    uint8_t const*    pos = data;
+    manifest_header_t header;
+    if (len < sizeof(header)) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    memcpy(&header, pos, sizeof(header));
+    if (memcmp(header.magic, MANIFEST_MAGIC, sizeof(header.magic)) || header.version != MANIFEST_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    pos += sizeof(header);
+    len -= sizeof(header);
+
+    for (uint8_t i = 0; i < header.channel_count; i++) {
+        manifest_channel_t info;
+        if (len < sizeof(info)) {
+            return ESP_ERR_INVALID_VERSION;
+        }
+        memcpy(&info, pos, sizeof(info));
+        pos += sizeof(info);
+        len -= sizeof(info);
+        if (len < (size_t)info.delta_count * sizeof(manifest_delta_t)) {
+            return ESP_ERR_INVALID_VERSION;
+        }
+        if (!field_equals(info.name, sizeof(info.name), channel)) {
+            pos += info.delta_count * sizeof(manifest_delta_t);
+            len -= info.delta_count * sizeof(manifest_delta_t);
+            continue;
+        }
+
+        memset(entry, 0, sizeof(manifest_entry_t));
+        memcpy(entry->version, info.version, sizeof(entry->version));
+        memcpy(entry->sha256, info.sha256, sizeof(entry->sha256));
+        entry->size = info.size;
+        for (uint8_t j = 0; j < info.delta_count; j++) {
+            manifest_delta_t delta;
+            memcpy(&delta, pos + j * sizeof(delta), sizeof(delta));
+            if (field_equals(delta.source_version, sizeof(delta.source_version), running_version)) {
+                entry->has_delta  = true;
+                entry->delta_size = delta.size;
+            }
+        }
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// Check whether an entry offers the running version, which means there is nothing to update.
+bool manifest_is_current(manifest_entry_t const* entry, char const* running_version) {
+    return field_equals(entry->version, sizeof(entry->version), running_version);
+}
@@ -0,0 +1,80 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Manifest of the firmware the update server offers, so that a badge can find out whether it needs an update with one
+// small request. It lists, for every channel, the version, size and SHA-256 of the image and the versions there are
+// patches from. tools/mkmanifest.py makes it; tools/ota_server.py serves one for the directory it serves.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Magic bytes at the start of a manifest.
+#define MANIFEST_MAGIC    "BMAN"
+// Version of the manifest format.
+#define MANIFEST_VERSION  1
+// Largest manifest that is read.
+#define MANIFEST_MAX_SIZE 4096
+// Name of the manifest, appended to the base URL like the names of the images.
+#define MANIFEST_NAME     "manifest.bin"
+
+// Manifest header; all numbers are little-endian.
+typedef struct __attribute__((packed)) {
+    // Must be `MANIFEST_MAGIC`.
+    char    magic[4];
+    // Must be `MANIFEST_VERSION`.
+    uint8_t version;
+    // Number of channels that follow.
+    uint8_t channel_count;
+    // Must be zero.
+    uint8_t reserved[2];
+} manifest_header_t;
+
+// A channel in the manifest, followed by `delta_count` patches.
+typedef struct __attribute__((packed)) {
+    // Name of the channel, e.g. "stable"; padded with zeroes.
+    char     name[16];
+    // Version of its image, as in the application description.
+    char     version[32];
+    // Size of the image.
+    uint32_t size;
+    // SHA-256 of the image.
+    uint8_t  sha256[32];
+    // Number of patches to the image.
+    uint8_t  delta_count;
+    // Must be zero.
+    uint8_t  reserved[3];
+} manifest_channel_t;
+
+// A patch to the image of a channel.
+typedef struct __attribute__((packed)) {
+    // Version the patch applies to.
+    char     source_version[32];
+    // Size of the patch.
+    uint32_t size;
+} manifest_delta_t;
+
+// What the manifest offers a badge on one channel.
+typedef struct {
+    // Version of the image.
+    char     version[32];
+    // Size of the image.
+    uint32_t size;
+    // SHA-256 of the image.
+    uint8_t  sha256[32];
+    // Whether there is a patch from the running version.
+    bool     has_delta;
+    // Size of that patch.
+    uint32_t delta_size;
+} manifest_entry_t;
+
+// Find what the manifest in `data` offers on `channel` to a badge running `running_version`.
+// Returns `ESP_ERR_INVALID_VERSION` if it is not a valid manifest and `ESP_ERR_NOT_FOUND` if the channel is not in it.
+esp_err_t manifest_find(void const* data, size_t len, char const* channel, char const* running_version,
+                        manifest_entry_t* entry);
+
+// Check whether an entry offers the running version, which means there is nothing to update.
+bool manifest_is_current(manifest_entry_t const* entry, char const* running_version);
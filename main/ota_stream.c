@@ -0,0 +1,436 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "ota_stream.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+
+static char const TAG[] = "ota_stream";
+
+// Offset of the version string in the application description.
+#define APP_VERSION_OFFSET    16
+// Offset of the ELF hash in the application description.
+#define APP_ELF_SHA256_OFFSET 144
+
+// Hash a URL; FNV-1a.
+static uint32_t hash_url(char const* url) {
+    uint32_t hash = 2166136261u;
+    for (; *url; url++) {
+        hash = (hash ^ (uint8_t)*url) * 16777619u;
+    }
+    return hash;
+}
+
+// Copy a string into a buffer of `size` bytes; it stays empty if the string does not fit.
+static void copy_string(char* dst, size_t size, char const* src) {
+    size_t len = src ? strlen(src) : 0;
+    len        = len < size ? len : 0;
+    memcpy(dst, src ? src : "", len);
+    dst[len] = 0;
+}
+
+// Get the validator of a response: a strong entity tag, or else the date of the last change; NULL if there is neither.
+// Weak entity tags cannot be used in `If-Range`.
+static char const* get_validator(char const* etag, char const* last_modified) {
+    return etag && strncmp(etag, "W/", 2) ? etag : last_modified;
+}
+
+// Forget everything about the download, keeping only what the update was started with.
+static void clear(ota_stream_t* stream) {
+    ota_stream_io_t const* io       = stream->io;
+    void*                  ctx      = stream->ctx;
+    uint32_t               url_hash      = stream->url_hash;
+    uint32_t               expected_size = stream->expected_size;
+    uint8_t                expected_sha256[sizeof(stream->expected_sha256)];
+    char                   running_version[sizeof(stream->running_version)];
+    memcpy(expected_sha256, stream->expected_sha256, sizeof(expected_sha256));
+    memcpy(running_version, stream->running_version, sizeof(running_version));
+    free(stream->delta);
+    free(stream->lz);
+
+    memset(stream, 0, sizeof(ota_stream_t));
+    stream->io            = io;
+    stream->ctx           = ctx;
+    stream->url_hash      = url_hash;
+    stream->expected_size = expected_size;
+    stream->percent_shown = -1;
+    memcpy(stream->expected_sha256, expected_sha256, sizeof(expected_sha256));
+    memcpy(stream->running_version, running_version, sizeof(running_version));
+}
+
+// Throw away what was installed so far, so that the next request starts at the beginning again.
+static void restart(ota_stream_t* stream) {
+    if (stream->begun) {
+        stream->io->abort(stream->ctx);
+    }
+    if (stream->resume.format) {
+        stream->io->save(stream->ctx, NULL);
+    }
+    clear(stream);
+}
+
+// Start writing new firmware.
+static esp_err_t begin(ota_stream_t* stream, uint32_t size, uint32_t offset) {
+    stream->target_size = size;
+    esp_err_t res       = stream->io->begin(stream->ctx, size, offset);
+    stream->begun       = res == ESP_OK;
+    return res;
+}
+
+// Write new firmware, and store the progress of plain images every `OTA_RESUME_INTERVAL` bytes.
+static esp_err_t write_firmware(void* ctx, void const* data, size_t len) {
+    ota_stream_t* stream = ctx;
+    if (stream->target_size && len > stream->target_size - stream->written) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t res = stream->io->write(stream->ctx, data, len);
+    if (res != ESP_OK) {
+        return res;
+    }
+    uint32_t before  = stream->written;
+    stream->written += len;
+
+    int percent = stream->target_size ? (int64_t)stream->written * 100 / stream->target_size : 0;
+    if (percent != stream->percent_shown) {
+        stream->percent_shown = percent;
+        stream->io->progress(stream->ctx, stream->kind, percent);
+    }
+    // Progress is useless without a validator, as the download could not be continued.
+    if (stream->resume.format && stream->validator[0] &&
+        stream->written / OTA_RESUME_INTERVAL != before / OTA_RESUME_INTERVAL && stream->written < stream->target_size) {
+        stream->resume.written = stream->written / OTA_RESUME_INTERVAL * OTA_RESUME_INTERVAL;
+        memcpy(stream->resume.validator, stream->validator, sizeof(stream->resume.validator));
+        stream->io->save(stream->ctx, &stream->resume);
+    }
+    return ESP_OK;
+}
+
+// Read from the running firmware, for a patch.
+static esp_err_t read_running(void* ctx, size_t offset, void* buf, size_t len) {
+    ota_stream_t* stream = ctx;
+    return stream->io->read_running(stream->ctx, offset, buf, len);
+}
+
+// Check the header of a patch, and start writing the new firmware.
+static esp_err_t check_patch(void* ctx, delta_header_t const* header) {
+    ota_stream_t* stream = ctx;
+    esp_err_t     res    = stream->io->check_source(stream->ctx, header);
+    if (res != ESP_OK) {
+        return res;
+    }
+    bool in_manifest = header->target_size == stream->expected_size &&
+                       !memcmp(header->target_sha256, stream->expected_sha256, sizeof(stream->expected_sha256));
+    if (stream->expected_size && !in_manifest) {
+        ESP_LOGW(TAG, "Patch does not lead to the firmware in the manifest");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    ESP_LOGI(TAG, "Patching %" PRIu32 " bytes into %" PRIu32 " bytes", header->source_size, header->target_size);
+    return begin(stream, header->target_size, 0);
+}
+
+// Get the identity of a firmware image from its application description.
+static bool read_app_desc(uint8_t const* desc, ota_image_id_t* id) {
+    uint32_t magic;
+    memcpy(&magic, desc, sizeof(magic));
+    memcpy(id->version, desc + APP_VERSION_OFFSET, sizeof(id->version));
+    memcpy(id->elf_sha256, desc + APP_ELF_SHA256_OFFSET, sizeof(id->elf_sha256));
+    return magic == OTA_APP_DESC_MAGIC;
+}
+
+// Find out what the new firmware is from its first bytes in `head`, and start installing it.
+// Leaves `kind` unknown if more bytes are needed; sets `current` and stops the download if it is the running firmware.
+static esp_err_t identify(ota_stream_t* stream) {
+    if (stream->head_len < sizeof(DELTA_MAGIC) - 1) {
+        return ESP_OK;
+    }
+    if (!memcmp(stream->head, DELTA_MAGIC, sizeof(DELTA_MAGIC) - 1)) {
+        stream->delta = malloc(sizeof(delta_t));
+        if (!stream->delta) {
+            return ESP_ERR_NO_MEM;
+        }
+        delta_init(stream->delta, read_running, write_firmware, check_patch, stream);
+        stream->kind = OTA_STREAM_DELTA;
+        return ESP_OK;
+    }
+    if (stream->head[0] != OTA_IMAGE_MAGIC) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (stream->head_len < sizeof(stream->head)) {
+        return ESP_OK;
+    }
+
+    ota_image_id_t id;
+    if (!read_app_desc(stream->head + OTA_APP_DESC_OFFSET, &id)) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    ESP_LOGI(TAG, "Running firmware version: %.32s, available firmware version: %.32s", stream->running_version,
+             id.version);
+    if (!memcmp(id.version, stream->running_version, sizeof(id.version))) {
+        stream->current = true;
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Without a `Content-Length`, as with chunked transfer, the size comes from the manifest if there is one.
+    uint32_t size = stream->lz ? stream->lz->header.size : stream->download_size;
+    if ((stream->lz && !size) || (size && stream->expected_size && size != stream->expected_size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    size         = size ? size : stream->expected_size;
+    stream->kind = OTA_STREAM_IMAGE;
+    if (!stream->lz && size) {
+        // Only plain images can continue after a restart; the others would need the state of the decoders.
+        stream->resume.format   = OTA_RESUME_VERSION;
+        stream->resume.id       = id;
+        stream->resume.url_hash = stream->url_hash;
+        stream->resume.size     = size;
+    }
+    return begin(stream, size, 0);
+}
+
+// Install decompressed bytes of the download.
+static esp_err_t install(ota_stream_t* stream, uint8_t const* data, size_t len) {
+    if (stream->kind == OTA_STREAM_DELTA) {
+        return delta_feed(stream->delta, data, len);
+    }
+    return write_firmware(stream, data, len);
+}
+
+// Install the next bytes of the download, after decompression.
+static esp_err_t payload(void* ctx, void const* data, size_t len) {
+    ota_stream_t*  stream = ctx;
+    uint8_t const* pos    = data;
+    if (stream->kind == OTA_STREAM_UNKNOWN) {
+        size_t chunk = sizeof(stream->head) - stream->head_len;
+        chunk        = chunk < len ? chunk : len;
+        memcpy(stream->head + stream->head_len, pos, chunk);
+        stream->head_len += chunk;
+        pos              += chunk;
+        len              -= chunk;
+        esp_err_t res     = identify(stream);
+        if (res != ESP_OK || stream->kind == OTA_STREAM_UNKNOWN) {
+            return res;
+        }
+        res = install(stream, stream->head, stream->head_len);
+        if (res != ESP_OK) {
+            return res;
+        }
+    }
+    return len ? install(stream, pos, len) : ESP_OK;
+}
+
+// Check that the start of a plain image written before a restart is still in the update partition.
+static esp_err_t check_resumed(ota_stream_t* stream) {
+    uint8_t        desc[OTA_APP_DESC_SIZE];
+    ota_image_id_t id;
+    esp_err_t      res = stream->io->read_update(stream->ctx, OTA_APP_DESC_OFFSET, desc, sizeof(desc));
+    if (res != ESP_OK || !read_app_desc(desc, &id) || memcmp(&id, &stream->resume.id, sizeof(id))) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    return ESP_OK;
+}
+
+// Parse a `Content-Range` header.
+static bool parse_content_range(char const* value, uint32_t* start, uint32_t* end, uint32_t* total) {
+    return value && sscanf(value, "bytes %" SCNu32 "-%" SCNu32 "/%" SCNu32, start, end, total) == 3;
+}
+
+// Start an update from `url`; `resume` is the stored progress, or NULL if none is.
+void ota_stream_init(ota_stream_t* stream, ota_stream_io_t const* io, void* ctx, char const* url,
+                     char const* running_version, ota_resume_t const* resume) {
+    memset(stream, 0, sizeof(ota_stream_t));
+    stream->io       = io;
+    stream->ctx      = ctx;
+    stream->url_hash = hash_url(url);
+    memcpy(stream->running_version, running_version, strnlen(running_version, sizeof(stream->running_version)));
+    clear(stream);
+    if (!resume) {
+        return;
+    }
+    bool has_validator = resume->validator[0] && !resume->validator[sizeof(resume->validator) - 1];
+    if (resume->format != OTA_RESUME_VERSION || resume->url_hash != stream->url_hash || !resume->written ||
+        resume->written >= resume->size || resume->written % OTA_SECTOR_SIZE || !has_validator) {
+        io->save(ctx, NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "Continuing the download of version %.32s at %" PRIu32 " of %" PRIu32 " bytes", resume->id.version,
+             resume->written, resume->size);
+    stream->resume        = *resume;
+    stream->resumed       = true;
+    stream->kind          = OTA_STREAM_IMAGE;
+    stream->received      = resume->written;
+    stream->written       = resume->written;
+    stream->download_size = resume->size;
+    stream->target_size   = resume->size;
+    stream->magic_len     = sizeof(stream->magic);
+    copy_string(stream->validator, sizeof(stream->validator), resume->validator);
+}
+
+// Set the size, version and SHA-256 the new firmware must have, from the manifest.
+// A download continued from before a restart is started over if it is of other firmware.
+void ota_stream_expect(ota_stream_t* stream, uint32_t size, char const* version, uint8_t const* sha256) {
+    if (stream->resumed && (stream->resume.size != size ||
+                            memcmp(stream->resume.id.version, version, sizeof(stream->resume.id.version)))) {
+        ESP_LOGW(TAG, "Manifest offers other firmware than the download from before the restart; starting over");
+        restart(stream);
+    }
+    stream->expected_size = size;
+    memcpy(stream->expected_sha256, sha256, sizeof(stream->expected_sha256));
+}
+
+// Get the offset the next request should start at, and the validator to send in `If-Range`, or NULL if it starts at
+// the beginning; a download without a validator is started over.
+uint32_t ota_stream_range(ota_stream_t* stream, char const** if_range) {
+    if (stream->received && !stream->validator[0]) {
+        // Without `If-Range`, the rest could be of a file that changed since the first part was downloaded.
+        ESP_LOGW(TAG, "Server sent nothing to check that the download did not change; starting over");
+        restart(stream);
+    }
+    *if_range = stream->received ? stream->validator : NULL;
+    return stream->received;
+}
+
+// Handle the response to a request; `content_length` is -1 and the headers NULL if absent.
+esp_err_t ota_stream_response(ota_stream_t* stream, int status, int64_t content_length, char const* content_range,
+                              char const* etag, char const* last_modified) {
+    char const* validator = get_validator(etag, last_modified);
+    if (status == 200) {
+        if (stream->received) {
+            ESP_LOGW(TAG, "Server sent the whole download instead of the rest; starting over");
+            restart(stream);
+        }
+        stream->download_size = content_length > 0 && content_length <= UINT32_MAX ? content_length : 0;
+        copy_string(stream->validator, sizeof(stream->validator), validator);
+        return ESP_OK;
+    }
+
+    uint32_t start;
+    uint32_t end;
+    uint32_t total;
+    if (status == 206 && stream->received && parse_content_range(content_range, &start, &end, &total) &&
+        start == stream->received && end + 1 == total && (!stream->download_size || total == stream->download_size) &&
+        (!validator || !strcmp(validator, stream->validator))) {
+        stream->download_size = total;
+        if (stream->begun || !stream->resumed) {
+            return ESP_OK;
+        }
+        // Continuing a plain image after a restart.
+        esp_err_t res = check_resumed(stream);
+        if (res == ESP_OK) {
+            res = begin(stream, stream->target_size, stream->written);
+        }
+        if (res != ESP_OK) {
+            ESP_LOGW(TAG, "Cannot continue the download from before the restart; starting over");
+            restart(stream);
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        return ESP_OK;
+    }
+    if (status == 206 || status == 416) {
+        ESP_LOGW(TAG, "Server cannot continue the download; starting over");
+        restart(stream);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    ESP_LOGE(TAG, "Server responded with status %d", status);
+    return status >= 500 || status == 408 || status == 429 ? ESP_FAIL : ESP_ERR_NOT_FOUND;
+}
+
+// Install the next `len` bytes of the download.
+esp_err_t ota_stream_feed(ota_stream_t* stream, void const* data, size_t len) {
+    uint8_t const* pos = data;
+    if (stream->download_size && len > stream->download_size - stream->received) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    stream->received += len;
+    if (stream->magic_len < sizeof(stream->magic)) {
+        size_t chunk = sizeof(stream->magic) - stream->magic_len;
+        chunk        = chunk < len ? chunk : len;
+        memcpy(stream->magic + stream->magic_len, pos, chunk);
+        stream->magic_len += chunk;
+        pos               += chunk;
+        len               -= chunk;
+        if (stream->magic_len < sizeof(stream->magic)) {
+            return ESP_OK;
+        }
+        if (!memcmp(stream->magic, LZ_MAGIC, sizeof(stream->magic))) {
+            stream->lz = malloc(sizeof(lz_t));
+            if (!stream->lz) {
+                return ESP_ERR_NO_MEM;
+            }
+            lz_init(stream->lz, payload, stream);
+        }
+        esp_err_t res = stream->lz ? lz_feed(stream->lz, stream->magic, sizeof(stream->magic))
+                                   : payload(stream, stream->magic, sizeof(stream->magic));
+        if (res != ESP_OK) {
+            return res;
+        }
+    }
+    if (!len) {
+        return ESP_OK;
+    }
+    return stream->lz ? lz_feed(stream->lz, pos, len) : payload(stream, pos, len);
+}
+
+// Install the update once it has been downloaded completely.
+esp_err_t ota_stream_finish(ota_stream_t* stream) {
+    esp_err_t res = ESP_OK;
+    if (stream->download_size && stream->received != stream->download_size) {
+        res = ESP_ERR_INVALID_SIZE;
+    }
+    if (res == ESP_OK && stream->lz) {
+        res = lz_finish(stream->lz);
+    }
+    if (res == ESP_OK && stream->delta) {
+        res = delta_finish(stream->delta);
+    }
+    if (res == ESP_OK && (!stream->begun || !stream->written ||
+                          (stream->target_size && stream->written != stream->target_size))) {
+        res = ESP_ERR_INVALID_SIZE;
+    }
+    if (res == ESP_OK) {
+        // A resumed image is checked whole too: `io->begin` hashed what was written before the restart.
+        uint8_t const* sha256 = NULL;
+        if (stream->delta) {
+            sha256 = stream->delta->header.target_sha256;
+        } else if (stream->expected_size) {
+            sha256 = stream->expected_sha256;
+        }
+        res           = stream->io->end(stream->ctx, sha256);
+        stream->begun = false;
+    }
+    return res;
+}
+
+// Stop an update that ended with `res`; the progress of a plain image is kept if `res` is worth retrying later.
+void ota_stream_close(ota_stream_t* stream, esp_err_t res) {
+    if (stream->begun) {
+        stream->io->abort(stream->ctx);
+        stream->begun = false;
+    }
+    if (stream->resume.format && !ota_stream_retryable(res)) {
+        stream->io->save(stream->ctx, NULL);
+    }
+    free(stream->delta);
+    free(stream->lz);
+    stream->delta = NULL;
+    stream->lz    = NULL;
+}
+
+// Check whether a download that failed with `res` is worth retrying.
+bool ota_stream_retryable(esp_err_t res) {
+    return res == ESP_FAIL || res == ESP_ERR_TIMEOUT || res == ESP_ERR_INVALID_RESPONSE;
+}
+
+// Get the time to wait before retry number `attempt`, in milliseconds, spread out by `random`.
+uint32_t ota_stream_backoff_ms(uint32_t attempt, uint32_t random) {
+    uint32_t max = OTA_BACKOFF_MIN_MS;
+    for (uint32_t i = 1; i < attempt && max < OTA_BACKOFF_MAX_MS; i++) {
+        max *= 2;
+    }
+    max = max < OTA_BACKOFF_MAX_MS ? max : OTA_BACKOFF_MAX_MS;
+    // Wait at least half of it; the rest is random so that badges that lost the network together do not return
+    // together.
+    return max / 2 + random % (max / 2 + 1);
+}
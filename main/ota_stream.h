@@ -0,0 +1,180 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Installation of an update while it downloads, independent of how it is downloaded and where it is written.
+// The download is a firmware image, a patch against the running firmware (see delta.h), or either compressed (see
+// lz.h); which one is found out from its first bytes. Interrupted downloads continue with an HTTP range request:
+// within one update the decoders simply carry on, and the progress of plain images is also stored so that an update
+// after a restart continues where the last one stopped. A range is only asked for with `If-Range`, so a download the
+// server sent no validator for (an entity tag or a date) starts over instead.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "delta.h"
+#include "esp_err.h"
+#include "lz.h"
+
+// First byte of a firmware image.
+#define OTA_IMAGE_MAGIC     0xE9
+// Offset of the application description in a firmware image, after the image header and the first segment header.
+#define OTA_APP_DESC_OFFSET 32
+// Size of the application description.
+#define OTA_APP_DESC_SIZE   256
+// Magic word of the application description.
+#define OTA_APP_DESC_MAGIC  0xABCD5432
+// Size of the flash sectors; the progress of plain images is stored in whole sectors.
+#define OTA_SECTOR_SIZE     4096
+// Progress of plain images is stored every this many bytes.
+#define OTA_RESUME_INTERVAL (64 * 1024)
+// Version of `ota_resume_t`.
+#define OTA_RESUME_VERSION  1
+
+// Number of download attempts in one update.
+#define OTA_MAX_ATTEMPTS   8
+// Time waited before the first retry, in milliseconds; it doubles with every retry.
+#define OTA_BACKOFF_MIN_MS 1000
+// Longest time waited before a retry, in milliseconds.
+#define OTA_BACKOFF_MAX_MS 30000
+
+// What a download contains.
+typedef enum {
+    // Not known yet.
+    OTA_STREAM_UNKNOWN,
+    // A firmware image.
+    OTA_STREAM_IMAGE,
+    // A patch against the running firmware.
+    OTA_STREAM_DELTA,
+} ota_stream_kind_t;
+
+// Identity of a firmware image, from its application description.
+typedef struct {
+    // Version string.
+    char    version[32];
+    // SHA-256 of the ELF file it was made from.
+    uint8_t elf_sha256[32];
+} ota_image_id_t;
+
+// Progress of a plain image download, stored across restarts.
+typedef struct {
+    // Must be `OTA_RESUME_VERSION`.
+    uint8_t        format;
+    // Image being downloaded.
+    ota_image_id_t id;
+    // Validator the server sent with it, see `ota_stream_t`.
+    char           validator[64];
+    // Hash of the URL it is downloaded from.
+    uint32_t       url_hash;
+    // Size of the image.
+    uint32_t       size;
+    // Number of bytes of it written to the update partition; a multiple of `OTA_SECTOR_SIZE`.
+    uint32_t       written;
+} ota_resume_t;
+
+// Where an update is installed.
+typedef struct {
+    // Read from the running firmware.
+    esp_err_t (*read_running)(void* ctx, size_t offset, void* buf, size_t len);
+    // Read from the update partition.
+    esp_err_t (*read_update)(void* ctx, size_t offset, void* buf, size_t len);
+    // Check that a patch was made against the running firmware.
+    esp_err_t (*check_source)(void* ctx, delta_header_t const* header);
+    // Start writing `size` bytes of new firmware to the update partition; from `offset` on, if that much was written
+    // before, in which case those bytes are read back so that `end` checks the whole firmware. `size` is 0 if it is
+    // not known, in which case up to the whole partition may be written.
+    esp_err_t (*begin)(void* ctx, uint32_t size, uint32_t offset);
+    // Write the next bytes of new firmware.
+    esp_err_t (*write)(void* ctx, void const* data, size_t len);
+    // Stop writing new firmware, leaving what was written.
+    void      (*abort)(void* ctx);
+    // Check the new firmware and boot it next; `sha256` is its expected hash, or NULL if it is not known.
+    esp_err_t (*end)(void* ctx, uint8_t const* sha256);
+    // Store the progress of a download, or erase it if `resume` is NULL.
+    void      (*save)(void* ctx, ota_resume_t const* resume);
+    // Report progress.
+    void      (*progress)(void* ctx, ota_stream_kind_t kind, int percent);
+} ota_stream_io_t;
+
+// State of an update being installed.
+typedef struct {
+    // Where the update is installed.
+    ota_stream_io_t const* io;
+    // Passed to `io`.
+    void*                  ctx;
+    // Version of the running firmware.
+    char                   running_version[32];
+    // Hash of the URL the update is downloaded from.
+    uint32_t               url_hash;
+    // What the download contains, after decompression.
+    ota_stream_kind_t      kind;
+    // Whether the download is the running firmware, which is not installed again; check this rather than the error
+    // the download stopped with, which other failures can share.
+    bool                   current;
+    // Whether the download continues one from before a restart, which must not be negotiated again.
+    bool                   resumed;
+    // Whether `io->begin` was called, and `io->abort` or `io->end` not yet.
+    bool                   begun;
+    // Number of bytes of the download received.
+    uint32_t               received;
+    // Size of the whole download, or 0 if it is not known.
+    uint32_t               download_size;
+    // Strong entity tag of the download or, if the server sent none, the date it last changed; empty if neither.
+    char                   validator[64];
+    // Size the new firmware must have according to the manifest, or 0 if it is not known.
+    uint32_t               expected_size;
+    // SHA-256 the new firmware must have according to the manifest, if `expected_size` is set.
+    uint8_t                expected_sha256[32];
+    // Size of the new firmware, or 0 if it is not known.
+    uint32_t               target_size;
+    // Number of bytes of new firmware written.
+    uint32_t               written;
+    // Last percentage reported.
+    int                    percent_shown;
+    // Progress of a plain image, for storing; `format` is zero if the download is not a plain image.
+    ota_resume_t           resume;
+    // Magic bytes at the start of the download, to find out whether it is compressed.
+    uint8_t                magic[4];
+    // Number of bytes in `magic`.
+    size_t                 magic_len;
+    // First bytes of the new firmware, to find out what it is.
+    uint8_t                head[OTA_APP_DESC_OFFSET + OTA_APP_DESC_SIZE];
+    // Number of bytes in `head`.
+    size_t                 head_len;
+    // Applies the patch, if the download is one.
+    delta_t*               delta;
+    // Decompresses the download, if it is compressed.
+    lz_t*                  lz;
+} ota_stream_t;
+
+// Start an update from `url`; `resume` is the stored progress, or NULL if none is.
+void ota_stream_init(ota_stream_t* stream, ota_stream_io_t const* io, void* ctx, char const* url,
+                     char const* running_version, ota_resume_t const* resume);
+
+// Set the size, version and SHA-256 the new firmware must have, from the manifest.
+// A download continued from before a restart is started over if it is of other firmware.
+void ota_stream_expect(ota_stream_t* stream, uint32_t size, char const* version, uint8_t const* sha256);
+
+// Get the offset the next request should start at, and the validator to send in `If-Range`, or NULL if it starts at
+// the beginning; a download without a validator is started over.
+uint32_t ota_stream_range(ota_stream_t* stream, char const** if_range);
+
+// Handle the response to a request; `content_length` is -1 and the headers NULL if absent.
+esp_err_t ota_stream_response(ota_stream_t* stream, int status, int64_t content_length, char const* content_range,
+                              char const* etag, char const* last_modified);
+
+// Install the next `len` bytes of the download.
+esp_err_t ota_stream_feed(ota_stream_t* stream, void const* data, size_t len);
+
+// Install the update once it has been downloaded completely.
+esp_err_t ota_stream_finish(ota_stream_t* stream);
+
+// Stop an update that ended with `res`; the progress of a plain image is kept if `res` is worth retrying later.
+void ota_stream_close(ota_stream_t* stream, esp_err_t res);
+
+// Check whether a download that failed with `res` is worth retrying.
+bool ota_stream_retryable(esp_err_t res);
+
+// Get the time to wait before retry number `attempt`, in milliseconds, spread out by `random`.
+uint32_t ota_stream_backoff_ms(uint32_t attempt, uint32_t random);
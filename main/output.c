@@ -0,0 +1,127 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "output.h"
+#include <math.h>
+#include <stdbool.h>
+
+// Output levels in Q16 per input level with only gamma applied; built once.
+static uint16_t gamma_table[256];
+// Whether `gamma_table` has been built.
+static bool     gamma_ready;
+
+// Build the gamma table.
+static void build_gamma_table() {
+    float const gamma = OUTPUT_GAMMA_X100 / 100.0f;
+    for (size_t i = 0; i < 256; i++) {
+        gamma_table[i] = (uint16_t)(powf(i / 255.0f, gamma) * 65535.0f + 0.5f);
+    }
+    gamma_ready = true;
+}
+
+// Set the brightness in Q8 (0x100 is full brightness) and rebuild the lookup table.
+void output_set_brightness(output_t* output, uint16_t brightness) {
+    if (!gamma_ready) {
+        build_gamma_table();
+    }
+    output->brightness = brightness;
+    for (size_t i = 0; i < 256; i++) {
+        // Q16 level times Q8 brightness is Q24; times 255 levels and down by 16 bits is 8.8 fixed point.
+        output->lut[i] = ((uint64_t)gamma_table[i] * brightness * 255 + (1 << 15)) >> 16;
+    }
+}
+
+// Estimate the current a frame of 8.8 fixed-point levels draws, in mA, from the sums of its channels.
+uint32_t output_estimate_ma(uint32_t sum_r, uint32_t sum_g, uint32_t sum_b, size_t len) {
+    uint64_t full_scale = (uint64_t)sum_r * OUTPUT_MA_RED + (uint64_t)sum_g * OUTPUT_MA_GREEN +
+                          (uint64_t)sum_b * OUTPUT_MA_BLUE;
+    return full_scale / (255 * 256) + len * OUTPUT_UA_IDLE / 1000;
+}
+
+// Update the current limiter for a frame and get the scale to apply to its levels, in Q8.
+static uint32_t limit_current(output_t* output, rgb_t const* in, size_t len) {
+    uint32_t scale = 0x100 - output->attenuation;
+    if (!output->budget_ma) {
+        return scale;
+    }
+
+    uint16_t const* lut   = output->lut;
+    uint32_t        sum_r = 0, sum_g = 0, sum_b = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum_r += lut[in[i].r];
+        sum_g += lut[in[i].g];
+        sum_b += lut[in[i].b];
+    }
+    uint32_t idle_ma  = len * OUTPUT_UA_IDLE / 1000;
+    uint32_t total_ma = output_estimate_ma(sum_r, sum_g, sum_b, len);
+    uint32_t led_ma   = total_ma - idle_ma;
+
+    // Scale that would just fit the budget; the idle current can't be dimmed.
+    uint32_t target = 0x100;
+    if (total_ma > output->budget_ma) {
+        target = output->budget_ma > idle_ma ? (output->budget_ma - idle_ma) * 0x100 / led_ma : 0;
+    }
+    // Dim at once to protect the supply, but brighten over a few frames so that the change is not visible as a jump.
+    if (target < scale) {
+        scale = target;
+    } else {
+        scale += (target - scale + 7) / 8;
+    }
+    output->attenuation = 0x100 - scale;
+
+    output_stats_t* stats = &output->stats;
+    if (scale < 0x100) {
+        stats->limited_frames++;
+    }
+    if (total_ma > stats->max_unlimited_ma) {
+        stats->max_unlimited_ma = total_ma;
+    }
+    if (output->attenuation > stats->max_attenuation) {
+        stats->max_attenuation = output->attenuation;
+    }
+    stats->current_ma = idle_ma + led_ma * scale / 0x100;
+    return scale;
+}
+
+// Map one channel through the table, adding and updating the carried error.
+static inline uint8_t dither(uint16_t level, uint8_t* error) {
+    if (level < 0x100) {
+        // Dithering less than one level would blink the LED on and off; round instead.
+        *error = 0;
+        return level >= 0x80;
+    }
+    uint32_t sum = level + *error;
+    *error       = sum & 0xff;
+    return sat_u8(sum >> 8);
+}
+
+// Map a frame of at most `LED_COUNT` pixels to LED levels, carrying the rounding error over to the next frame.
+// `out` is in the channel order of the LEDs; `in` and `out` may be the same buffer.
+void output_apply(output_t* output, rgb_t const* in, rgb_t* out, size_t len) {
+#if CONFIG_LED_DITHER
+    uint32_t const  scale = limit_current(output, in, len);
+    uint16_t const* lut   = output->lut;
+    uint8_t*        error = output->error;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t r = dither(lut[in[i].r] * scale >> 8, &error[i * 3 + 0]);
+        uint8_t g = dither(lut[in[i].g] * scale >> 8, &error[i * 3 + 1]);
+        uint8_t b = dither(lut[in[i].b] * scale >> 8, &error[i * 3 + 2]);
+        led_store(&out[i], r, g, b);
+    }
+#else
+    output_apply_static(output, in, out, len);
+#endif
+}
+
+// Map colours to LED levels without dithering, for static frames and images that are shown more than once.
+// `out` is in the channel order of the LEDs; `in` and `out` may be the same buffer.
+void output_apply_static(output_t* output, rgb_t const* in, rgb_t* out, size_t len) {
+    uint32_t const  scale = limit_current(output, in, len);
+    uint16_t const* lut   = output->lut;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t r = ((lut[in[i].r] * scale >> 8) + 0x80) >> 8;
+        uint8_t g = ((lut[in[i].g] * scale >> 8) + 0x80) >> 8;
+        uint8_t b = ((lut[in[i].b] * scale >> 8) + 0x80) >> 8;
+        led_store(&out[i], r, g, b);
+    }
+}
@@ -0,0 +1,67 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Output stage between the effect framebuffer and the LEDs.
+// Applies gamma and brightness through one lookup table, then dithers the fractional part over time so that dim
+// colours and slow fades keep more levels than 8 bits would give them.
+// If a current budget is set, frames that would draw more are dimmed to fit before they are mapped.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "effects.h"
+#include "sdkconfig.h"
+
+// Gamma of the LEDs, from Kconfig in hundredths; 100 is linear.
+#define OUTPUT_GAMMA_X100 CONFIG_LED_GAMMA_X100
+// Current of one LED's red channel at full scale, in mA.
+#define OUTPUT_MA_RED     CONFIG_LED_MA_RED
+// Current of one LED's green channel at full scale, in mA.
+#define OUTPUT_MA_GREEN   CONFIG_LED_MA_GREEN
+// Current of one LED's blue channel at full scale, in mA.
+#define OUTPUT_MA_BLUE    CONFIG_LED_MA_BLUE
+// Current of one LED that is off, in uA.
+#define OUTPUT_UA_IDLE    CONFIG_LED_UA_IDLE
+
+// Statistics of the current limiter.
+typedef struct {
+    // Number of frames that were dimmed to stay within the budget.
+    uint32_t limited_frames;
+    // Estimated current of the last frame as sent, in mA.
+    uint32_t current_ma;
+    // Highest estimated current a frame would have drawn without the limiter, in mA.
+    uint32_t max_unlimited_ma;
+    // Most the limiter dimmed a frame, in Q8; 0 if it never did.
+    uint16_t max_attenuation;
+} output_stats_t;
+
+// State of the output stage.
+typedef struct {
+    // Output level per input level in 8.8 fixed point, with gamma and brightness applied.
+    uint16_t       lut[256];
+    // Brightness the table was built for, in Q8.
+    uint16_t       brightness;
+    // Fraction of a level carried over to the next frame, per channel.
+    uint8_t        error[LED_COUNT * 3];
+    // Current budget of the LEDs in mA, or 0 to not limit the current.
+    uint32_t       budget_ma;
+    // How much the limiter currently dims the output, in Q8; 0 is not at all.
+    uint16_t       attenuation;
+    // Statistics of the current limiter.
+    output_stats_t stats;
+} output_t;
+
+// Set the brightness in Q8 (0x100 is full brightness) and rebuild the lookup table.
+void output_set_brightness(output_t* output, uint16_t brightness);
+
+// Estimate the current a frame of 8.8 fixed-point levels draws, in mA, from the sums of its channels.
+uint32_t output_estimate_ma(uint32_t sum_r, uint32_t sum_g, uint32_t sum_b, size_t len);
+
+// Map a frame of at most `LED_COUNT` pixels to LED levels, carrying the rounding error over to the next frame.
+// `out` is in the channel order of the LEDs; `in` and `out` may be the same buffer.
+void output_apply(output_t* output, rgb_t const* in, rgb_t* out, size_t len);
+
+// Map colours to LED levels without dithering, for static frames and images that are shown more than once.
+// `out` is in the channel order of the LEDs; `in` and `out` may be the same buffer.
+void output_apply_static(output_t* output, rgb_t const* in, rgb_t* out, size_t len);
@@ -0,0 +1,199 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "particles.h"
+
+// Number of pixels one Q16 line spans: from the first to the last LED on a strip, once around on a ring.
+#if LED_RING
+#define PIXEL_SPAN LED_LENGTH
+#else
+#define PIXEL_SPAN (LED_LENGTH > 1 ? LED_LENGTH - 1 : 1)
+#endif
+
+// Fastest a particle may move, in Q16 lines per cycle; keeps a step of the position within 32 bits.
+#define MAX_SPEED ((int32_t)(16 * PHASE_ONE - 1))
+
+// Remove all particles.
+void particles_clear(particles_t* ps) {
+    ps->count = 0;
+}
+
+// Add a particle; returns false if the pool is full.
+bool particles_add(particles_t* ps, particle_t const* particle) {
+    if (ps->count >= PARTICLES_MAX) {
+        return false;
+    }
+    size_t i         = ps->count++;
+    ps->pos[i]       = particle->pos;
+    ps->vel[i]       = particle->vel;
+    ps->intensity[i] = PHASE_ONE;
+    ps->decay[i]     = particle->decay;
+    ps->size[i]      = particle->size;
+    ps->tail[i]      = particle->tail;
+    ps->r[i]         = particle->col.r;
+    ps->g[i]         = particle->col.g;
+    ps->b[i]         = particle->col.b;
+    return true;
+}
+
+// Remove particle `index`; the last particle takes its place.
+void particles_remove(particles_t* ps, size_t index) {
+    size_t last          = --ps->count;
+    ps->pos[index]       = ps->pos[last];
+    ps->vel[index]       = ps->vel[last];
+    ps->intensity[index] = ps->intensity[last];
+    ps->decay[index]     = ps->decay[last];
+    ps->size[index]      = ps->size[last];
+    ps->tail[index]      = ps->tail[last];
+    ps->r[index]         = ps->r[last];
+    ps->g[index]         = ps->g[last];
+    ps->b[index]         = ps->b[last];
+}
+
+// Get a random number from the pool's generator.
+uint32_t particles_random(particles_t* ps) {
+    // Xorshift; cheap, and the same on every target so that the effects can be checked on the host.
+    uint32_t x  = ps->random;
+    x          ^= x << 13;
+    x          ^= x >> 17;
+    x          ^= x << 5;
+    ps->random  = x;
+    return x;
+}
+
+// Get a random number from `min` up to but not including `max`.
+int32_t particles_random_range(particles_t* ps, int32_t min, int32_t max) {
+    return min + (int32_t)((uint64_t)particles_random(ps) * (uint32_t)(max - min) >> 32);
+}
+
+// Move every particle on by `dt` and remove the ones that died; `dt` must be at most `PARTICLES_STEP`.
+void particles_update(particles_t* ps, phase_t dt) {
+    size_t const count     = ps->count;
+    int32_t*     pos       = ps->pos;
+    int32_t*     vel       = ps->vel;
+    int32_t*     intensity = ps->intensity;
+
+    // Forces over this step.
+    int32_t const dv   = (int64_t)ps->gravity * dt >> 16;
+    int32_t const drag = (uint64_t)ps->drag * dt >> 16;
+    for (size_t i = 0; i < count; i++) {
+        int32_t v = vel[i] - (int32_t)((int64_t)vel[i] * drag >> 16) - dv;
+        vel[i]    = v < -MAX_SPEED ? -MAX_SPEED : v > MAX_SPEED ? MAX_SPEED : v;
+    }
+    for (size_t i = 0; i < count; i++) {
+        pos[i] += vel[i] * (int32_t)dt >> 16;
+    }
+    for (size_t i = 0; i < count; i++) {
+        intensity[i] -= (uint64_t)ps->decay[i] * dt >> 16;
+    }
+
+    particle_edge_t const edge = LED_RING ? PARTICLE_EDGE_WRAP : ps->edge;
+    for (size_t i = 0; i < count; i++) {
+        if (edge == PARTICLE_EDGE_WRAP) {
+            pos[i] &= PHASE_ONE - 1;
+        } else if (edge == PARTICLE_EDGE_BOUNCE && (pos[i] < 0 || pos[i] > (int32_t)PHASE_ONE)) {
+            pos[i] = pos[i] < 0 ? -pos[i] : 2 * (int32_t)PHASE_ONE - pos[i];
+            vel[i] = -vel[i] * ps->bounce >> 8;
+        } else if (edge == PARTICLE_EDGE_DIE) {
+            // Dead once the tail has left the line too.
+            int32_t reach = ps->size[i] + ps->tail[i];
+            if (pos[i] < -reach || pos[i] > (int32_t)PHASE_ONE + reach) {
+                intensity[i] = 0;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < ps->count;) {
+        if (intensity[i] <= 0) {
+            particles_remove(ps, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+// Bring the pool to `phase`, calling `spawn` at every multiple of `interval` on the way.
+// The first call, a jump backwards and a jump of more than `PARTICLES_MAX_GAP` restart the pool from its seed.
+void particles_run(particles_t* ps, phase_t phase) {
+    if (!ps->running || phase - ps->phase > PARTICLES_MAX_GAP) {
+        particles_clear(ps);
+        ps->random  = ps->seed ? ps->seed : 1;
+        ps->phase   = phase;
+        ps->running = true;
+        ps->spawn(ps);
+    }
+    while (ps->phase != phase) {
+        phase_t dt   = phase - ps->phase;
+        phase_t next = ps->interval - ps->phase % ps->interval;
+        dt           = dt < next ? dt : next;
+        dt           = dt < PARTICLES_STEP ? dt : PARTICLES_STEP;
+        particles_update(ps, dt);
+        ps->phase += dt;
+        if (ps->phase % ps->interval == 0) {
+            ps->spawn(ps);
+        }
+    }
+}
+
+// Add the light of particle `i` to the accumulator, fading out linearly over its size in front and its tail behind.
+static inline void splat(particles_t* ps, size_t i) {
+    // Everything in Q8 pixels; a particle is at least a pixel wide, so that it never falls between two LEDs.
+    int32_t center = ps->pos[i] * PIXEL_SPAN >> 8;
+    int32_t front  = ps->size[i] * PIXEL_SPAN >> 8;
+    int32_t back   = ps->tail[i] * PIXEL_SPAN >> 8;
+    front          = front > 0x100 ? front : 0x100;
+    back           = back > 0x100 ? back : 0x100;
+    int32_t below  = ps->vel[i] < 0 ? front : back;
+    int32_t above  = ps->vel[i] < 0 ? back : front;
+
+    // Weight per Q8 pixel of distance, in Q16, on either side.
+    uint32_t inv_below = (0x100 << 16) / below;
+    uint32_t inv_above = (0x100 << 16) / above;
+    // Colour at the particle's brightness, in Q8 levels.
+    uint32_t level     = ps->intensity[i] >> 8;
+    uint32_t r         = ps->r[i] * level;
+    uint32_t g         = ps->g[i] * level;
+    uint32_t b         = ps->b[i] * level;
+
+    int32_t first = (center - below + 0xff) >> 8;
+    int32_t last  = (center + above) >> 8;
+#if LED_RING
+    int32_t index = (first % LED_LENGTH + LED_LENGTH) % LED_LENGTH;
+#else
+    first         = first > 0 ? first : 0;
+    last          = last < LED_LENGTH - 1 ? last : LED_LENGTH - 1;
+    int32_t index = first;
+#endif
+    uint32_t* light = ps->light;
+    for (int32_t x = first; x <= last; x++) {
+        int32_t  dist    = x * 0x100 - center;
+        uint32_t w       = dist < 0 ? 0x100 - ((uint32_t)-dist * inv_below >> 16)
+                                    : 0x100 - ((uint32_t)dist * inv_above >> 16);
+        light[index * 3 + 0] += r * w >> 8;
+        light[index * 3 + 1] += g * w >> 8;
+        light[index * 3 + 2] += b * w >> 8;
+#if LED_RING
+        index = index + 1 < LED_LENGTH ? index + 1 : 0;
+#else
+        index++;
+#endif
+    }
+}
+
+// Draw the particles into the first `LED_LENGTH` pixels of `fb`, adding up their light.
+void particles_render(particles_t* ps, rgb_t* fb) {
+    uint32_t* light = ps->light;
+    for (size_t i = 0; i < LED_LENGTH * 3; i++) {
+        light[i] = 0;
+    }
+    for (size_t i = 0; i < ps->count; i++) {
+        splat(ps, i);
+    }
+    for (size_t i = 0; i < LED_LENGTH; i++) {
+        fb[i] = (rgb_t){
+            sat_u8((light[i * 3 + 0] + 0x80) >> 8),
+            sat_u8((light[i * 3 + 1] + 0x80) >> 8),
+            sat_u8((light[i * 3 + 2] + 0x80) >> 8),
+        };
+    }
+}
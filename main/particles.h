@@ -0,0 +1,125 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Particle engine for effects that keep state from frame to frame, like comets, sparks and bouncing dots.
+// Every effect owns a pool of at most `PARTICLES_MAX` particles, stored as a structure of arrays so that a step is a
+// few tight loops over plain integers, with the live particles packed at the front. Particles are drawn by adding
+// their light into an accumulator, so overlapping particles mix instead of hiding each other.
+// Positions are Q16 fractions of the line of `LED_LENGTH` pixels, times are Q16 cycles of the animation phase.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "effects.h"
+#include "sdkconfig.h"
+
+// Number of particles a pool holds.
+#define PARTICLES_MAX     CONFIG_PARTICLES_MAX
+// Longest time simulated in one step; longer times are split up so that fast particles do not skip over the ends.
+#define PARTICLES_STEP    (PHASE_ONE / 32)
+// Longest time a pool catches up on; a longer jump, or one backwards, restarts it.
+#define PARTICLES_MAX_GAP PHASE_ONE
+
+// What particles do when they reach an end of the line; on a ring the ends meet, so particles always wrap around.
+typedef enum {
+    // Disappear once they are past the end.
+    PARTICLE_EDGE_DIE,
+    // Bounce back, keeping `bounce` of their speed.
+    PARTICLE_EDGE_BOUNCE,
+    // Come back in at the other end.
+    PARTICLE_EDGE_WRAP,
+} particle_edge_t;
+
+// Initial state of a particle.
+typedef struct {
+    // Position in Q16 lines.
+    int32_t  pos;
+    // Speed in Q16 lines per cycle; positive is away from the first LED.
+    int32_t  vel;
+    // Brightness lost per cycle, in Q16; 0 to live until removed.
+    uint32_t decay;
+    // Distance in front of the particle over which it fades out, in Q16 lines.
+    uint16_t size;
+    // Length of the tail behind the particle, in Q16 lines.
+    uint16_t tail;
+    // Colour at full brightness.
+    rgb_t    col;
+} particle_t;
+
+struct particles;
+
+// Add particles to a pool; called when the pool starts and then at every multiple of the spawn interval.
+typedef void (*particles_spawn_t)(struct particles* ps);
+
+// A pool of particles.
+typedef struct particles {
+    // Number of live particles; they are the first `count` entries of every array.
+    size_t            count;
+    // Positions in Q16 lines.
+    int32_t           pos[PARTICLES_MAX];
+    // Speeds in Q16 lines per cycle.
+    int32_t           vel[PARTICLES_MAX];
+    // Brightness in Q16; the particle is removed when it reaches 0.
+    int32_t           intensity[PARTICLES_MAX];
+    // Brightness lost per cycle, in Q16.
+    uint32_t          decay[PARTICLES_MAX];
+    // Distance in front over which the particle fades out, in Q16 lines.
+    uint16_t          size[PARTICLES_MAX];
+    // Length of the tail, in Q16 lines.
+    uint16_t          tail[PARTICLES_MAX];
+    // Red channel of the colours.
+    uint8_t           r[PARTICLES_MAX];
+    // Green channel of the colours.
+    uint8_t           g[PARTICLES_MAX];
+    // Blue channel of the colours.
+    uint8_t           b[PARTICLES_MAX];
+    // Light added up per pixel and channel while drawing, in Q8 levels.
+    uint32_t          light[LED_LENGTH * 3];
+    // What particles do at the ends of the line.
+    particle_edge_t   edge;
+    // Acceleration towards the first LED, in Q16 lines per cycle squared.
+    int32_t           gravity;
+    // Fraction of the speed lost per cycle, in Q16; below 32 per cycle, so that a step never takes all of it.
+    uint32_t          drag;
+    // Fraction of the speed kept when bouncing, in Q8.
+    uint16_t          bounce;
+    // Phase between two calls of `spawn`.
+    phase_t           interval;
+    // Called to add particles; may also change the live ones.
+    particles_spawn_t spawn;
+    // Seed the random numbers restart from, so that a restarted pool plays the same again.
+    uint32_t          seed;
+    // State of the random numbers.
+    uint32_t          random;
+    // Phase the pool was simulated up to.
+    phase_t           phase;
+    // Whether the pool has been started.
+    bool              running;
+} particles_t;
+
+// Remove all particles.
+void particles_clear(particles_t* ps);
+
+// Add a particle; returns false if the pool is full.
+bool particles_add(particles_t* ps, particle_t const* particle);
+
+// Remove particle `index`; the last particle takes its place.
+void particles_remove(particles_t* ps, size_t index);
+
+// Get a random number from the pool's generator.
+uint32_t particles_random(particles_t* ps);
+
+// Get a random number from `min` up to but not including `max`.
+int32_t particles_random_range(particles_t* ps, int32_t min, int32_t max);
+
+// Move every particle on by `dt` and remove the ones that died; `dt` must be at most `PARTICLES_STEP`.
+void particles_update(particles_t* ps, phase_t dt);
+
+// Bring the pool to `phase`, calling `spawn` at every multiple of `interval` on the way.
+// The first call, a jump backwards and a jump of more than `PARTICLES_MAX_GAP` restart the pool from its seed.
+void particles_run(particles_t* ps, phase_t phase);
+
+// Draw the particles into the first `LED_LENGTH` pixels of `fb`, adding up their light.
+void particles_render(particles_t* ps, rgb_t* fb);
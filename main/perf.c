@@ -0,0 +1,180 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "perf.h"
+#if CONFIG_PERF_COUNTERS
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+// Width of the longest histogram bar, in characters.
+#define HISTOGRAM_WIDTH 40
+
+// Names of the stages.
+char const* const perf_stage_names[PERF_STAGES] = {
+    [PERF_RENDER]     = "render",
+    [PERF_OUTPUT]     = "output",
+    [PERF_LED_WRITE]  = "led_write",
+    [PERF_INPUT_WAIT] = "input_wait",
+    [PERF_NVS_COMMIT] = "nvs_commit",
+};
+
+// Timings of each stage.
+static perf_counter_t counters[PERF_STAGES] = {
+    [0 ... PERF_STAGES - 1] = {.min = UINT32_MAX},
+};
+
+#if CONFIG_PERF_TRACE_EVENTS
+// The most recent timings.
+static perf_event_t         trace[CONFIG_PERF_TRACE_EVENTS];
+// Number of timings ever put into `trace`.
+static atomic_uint_fast32_t trace_head;
+#endif
+
+// Count a timing of `stage` from cycle `start` to cycle `end`.
+void perf_record(perf_stage_t stage, uint32_t start, uint32_t end) {
+    uint32_t        cycles  = end - start;
+    perf_counter_t* counter = &counters[stage];
+    size_t          bucket  = cycles ? 32 - __builtin_clz(cycles) : 0;
+    counter->count++;
+    counter->total += cycles;
+    if (cycles < counter->min) {
+        counter->min = cycles;
+    }
+    if (cycles > counter->max) {
+        counter->max = cycles;
+    }
+    counter->buckets[bucket < PERF_BUCKETS ? bucket : PERF_BUCKETS - 1]++;
+
+#if CONFIG_PERF_TRACE_EVENTS
+    uint32_t index = atomic_fetch_add(&trace_head, 1) % CONFIG_PERF_TRACE_EVENTS;
+    trace[index]   = (perf_event_t){
+        .start  = start,
+        .cycles = cycles,
+        .stage  = stage,
+        .core   = esp_cpu_get_core_id(),
+    };
+#endif
+}
+
+// Get a copy of the timings of `stage`.
+void perf_get_counter(perf_stage_t stage, perf_counter_t* counter) {
+    *counter = counters[stage];
+}
+
+// Estimate the timing that `permille` thousandths of the timings of `counter` do not exceed, in cycles.
+// This is the upper end of the histogram bucket it falls in.
+uint32_t perf_percentile(perf_counter_t const* counter, uint32_t permille) {
+    uint64_t wanted = ((uint64_t)counter->count * permille + 999) / 1000;
+    uint64_t seen   = 0;
+    for (size_t bucket = 0; bucket < PERF_BUCKETS; bucket++) {
+        seen += counter->buckets[bucket];
+        if (seen >= wanted) {
+            uint32_t end = (uint32_t)1 << bucket;
+            return end < counter->max ? end : counter->max;
+        }
+    }
+    return counter->max;
+}
+
+// Forget all timings and the trace.
+void perf_reset() {
+    for (size_t stage = 0; stage < PERF_STAGES; stage++) {
+        counters[stage] = (perf_counter_t){.min = UINT32_MAX};
+    }
+#if CONFIG_PERF_TRACE_EVENTS
+    atomic_store(&trace_head, 0);
+#endif
+}
+
+// Get the number of events in the trace.
+static size_t trace_events() {
+#if CONFIG_PERF_TRACE_EVENTS
+    uint32_t head = atomic_load(&trace_head);
+    return head < CONFIG_PERF_TRACE_EVENTS ? head : CONFIG_PERF_TRACE_EVENTS;
+#else
+    return 0;
+#endif
+}
+
+// Get the size of the trace in bytes.
+size_t perf_trace_size() {
+    return sizeof(perf_trace_header_t) + trace_events() * sizeof(perf_event_t);
+}
+
+// Write the trace into `buf`, which must be `perf_trace_size()` bytes; returns the number of bytes written.
+size_t perf_trace_read(uint8_t* buf, size_t size) {
+    if (size < sizeof(perf_trace_header_t)) {
+        return 0;
+    }
+    size_t events = (size - sizeof(perf_trace_header_t)) / sizeof(perf_event_t);
+    if (events > trace_events()) {
+        events = trace_events();
+    }
+    perf_trace_header_t header = {
+        .version       = PERF_TRACE_VERSION,
+        .stages        = PERF_STAGES,
+        .cycles_per_us = PERF_CYCLES_PER_US,
+        .events        = events,
+    };
+    memcpy(header.magic, PERF_TRACE_MAGIC, sizeof(header.magic));
+    memcpy(buf, &header, sizeof(header));
+
+#if CONFIG_PERF_TRACE_EVENTS
+    // Events that are recorded while this runs may overwrite the oldest ones; they are only a sample anyway.
+    uint32_t head = atomic_load(&trace_head);
+    for (size_t i = 0; i < events; i++) {
+        perf_event_t const* event = &trace[(head - events + i) % CONFIG_PERF_TRACE_EVENTS];
+        memcpy(buf + sizeof(header) + i * sizeof(perf_event_t), event, sizeof(perf_event_t));
+    }
+#endif
+    return sizeof(header) + events * sizeof(perf_event_t);
+}
+
+// Print the timings of every stage as a table.
+void perf_print_counters() {
+    printf("%-12s %10s %10s %10s %10s %10s %10s\n", "stage", "count", "avg us", "min us", "max us", "p50 us",
+           "p99 us");
+    for (size_t stage = 0; stage < PERF_STAGES; stage++) {
+        perf_counter_t counter;
+        perf_get_counter(stage, &counter);
+        if (!counter.count) {
+            printf("%-12s %10d\n", perf_stage_names[stage], 0);
+            continue;
+        }
+        printf("%-12s %10" PRIu32 " %10.1f %10.1f %10.1f %10.1f %10.1f\n", perf_stage_names[stage], counter.count,
+               (double)counter.total / counter.count / PERF_CYCLES_PER_US, (double)counter.min / PERF_CYCLES_PER_US,
+               (double)counter.max / PERF_CYCLES_PER_US,
+               (double)perf_percentile(&counter, 500) / PERF_CYCLES_PER_US,
+               (double)perf_percentile(&counter, 990) / PERF_CYCLES_PER_US);
+    }
+}
+
+// Print the histograms of every stage that was timed.
+void perf_print_histograms() {
+    for (size_t stage = 0; stage < PERF_STAGES; stage++) {
+        perf_counter_t counter;
+        perf_get_counter(stage, &counter);
+        if (!counter.count) {
+            continue;
+        }
+        uint32_t most = 0;
+        for (size_t bucket = 0; bucket < PERF_BUCKETS; bucket++) {
+            most = counter.buckets[bucket] > most ? counter.buckets[bucket] : most;
+        }
+        printf("%s:\n", perf_stage_names[stage]);
+        for (size_t bucket = 0; bucket < PERF_BUCKETS; bucket++) {
+            if (!counter.buckets[bucket]) {
+                continue;
+            }
+            char bar[HISTOGRAM_WIDTH + 1];
+            int  len = (uint64_t)counter.buckets[bucket] * HISTOGRAM_WIDTH / most;
+            memset(bar, '#', len);
+            bar[len] = 0;
+            printf("  < %12.2f us %10" PRIu32 " %s\n", (double)((uint64_t)1 << bucket) / PERF_CYCLES_PER_US,
+                   counter.buckets[bucket], bar);
+        }
+    }
+}
+#endif
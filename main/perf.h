@@ -0,0 +1,127 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Performance counters: how many CPU cycles each stage of the firmware takes, as totals and log2 histograms, and a
+// ring of the most recent timings as a trace that tools/perftrace.py turns into a timeline.
+// Everything is compiled out unless CONFIG_PERF_COUNTERS is set; PERF_START and PERF_END then expand to nothing.
+// Each stage must only be timed from one task at a time, so that counting needs no lock.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#if CONFIG_PERF_COUNTERS
+#include "esp_cpu.h"
+#endif
+
+// Number of histogram buckets; bucket n counts timings from 2^(n-1) up to 2^n cycles.
+#define PERF_BUCKETS       32
+// CPU cycles per microsecond, for showing timings; with dynamic frequency scaling this is the highest frequency.
+#define PERF_CYCLES_PER_US CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+// Magic bytes at the start of a trace.
+#define PERF_TRACE_MAGIC   "BPRF"
+// Version of the trace format.
+#define PERF_TRACE_VERSION 1
+
+// Stages that are timed.
+typedef enum {
+    // Rendering a frame of the effect or stream.
+    PERF_RENDER,
+    // Gamma, brightness, current limiting and dithering of a frame.
+    PERF_OUTPUT,
+    // Sending a frame to the LEDs with `bsp_led_write`.
+    PERF_LED_WRITE,
+    // Waiting for input events in the main task.
+    PERF_INPUT_WAIT,
+    // Committing to NVS.
+    PERF_NVS_COMMIT,
+    // Number of stages.
+    PERF_STAGES,
+} perf_stage_t;
+
+// Timings of one stage, in CPU cycles.
+typedef struct {
+    // Number of timings.
+    uint32_t count;
+    // Shortest timing.
+    uint32_t min;
+    // Longest timing.
+    uint32_t max;
+    // Sum of all timings.
+    uint64_t total;
+    // Number of timings per power of two.
+    uint32_t buckets[PERF_BUCKETS];
+} perf_counter_t;
+
+// Trace header, followed by `events` events, oldest first; all numbers are little-endian.
+typedef struct __attribute__((packed)) {
+    // `PERF_TRACE_MAGIC`.
+    char     magic[4];
+    // `PERF_TRACE_VERSION`.
+    uint8_t  version;
+    // `PERF_STAGES`.
+    uint8_t  stages;
+    // Reserved, 0.
+    uint16_t reserved;
+    // `PERF_CYCLES_PER_US`.
+    uint32_t cycles_per_us;
+    // Number of events.
+    uint32_t events;
+} perf_trace_header_t;
+
+// One timing in a trace.
+typedef struct __attribute__((packed)) {
+    // Cycle counter at the start; it wraps around.
+    uint32_t start;
+    // Number of cycles taken.
+    uint32_t cycles;
+    // The `perf_stage_t`.
+    uint8_t  stage;
+    // CPU core the stage ran on; every core has its own cycle counter.
+    uint8_t  core;
+    // Reserved, 0.
+    uint16_t reserved;
+} perf_event_t;
+
+// Names of the stages.
+extern char const* const perf_stage_names[PERF_STAGES];
+
+#if CONFIG_PERF_COUNTERS
+// Start timing; declares the variable `name` that holds the start.
+#define PERF_START(name)      uint32_t name = esp_cpu_get_cycle_count()
+// Stop timing `stage`, which started at PERF_START(name).
+#define PERF_END(stage, name) perf_record(stage, name, esp_cpu_get_cycle_count())
+#else
+#define PERF_START(name)
+#define PERF_END(stage, name) ((void)0)
+#endif
+
+// Count a timing of `stage` from cycle `start` to cycle `end`.
+void perf_record(perf_stage_t stage, uint32_t start, uint32_t end);
+
+// Get a copy of the timings of `stage`.
+void perf_get_counter(perf_stage_t stage, perf_counter_t* counter);
+
+// Estimate the timing that `permille` thousandths of the timings of `counter` do not exceed, in cycles.
+// This is the upper end of the histogram bucket it falls in.
+uint32_t perf_percentile(perf_counter_t const* counter, uint32_t permille);
+
+// Forget all timings and the trace.
+void perf_reset();
+
+// Get the size of the trace in bytes.
+size_t perf_trace_size();
+
+// Write the trace into `buf`, which must be `perf_trace_size()` bytes; returns the number of bytes written.
+size_t perf_trace_read(uint8_t* buf, size_t size);
+
+// Print the timings of every stage as a table.
+void perf_print_counters();
+
+// Print the histograms of every stage that was timed.
+void perf_print_histograms();
+
+// Start the serial console with the `perf` command.
+esp_err_t perf_console_start();
@@ -0,0 +1,110 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "perf.h"
+#if CONFIG_PERF_COUNTERS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_console.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "mbedtls/base64.h"
+
+// Bytes of trace per line of the dump; 57 bytes make 76 characters of base64.
+#define TRACE_LINE_BYTES 57
+
+// Tasks whose stack use is shown, if they run.
+static char const* const task_names[] = {"main", "render", "led_output", "player", "settings", "stream", "pov"};
+
+// Print how close every task came to the end of its stack, and how low the free heap got.
+static void print_memory() {
+    printf("%-12s %16s\n", "task", "min stack left");
+    for (size_t i = 0; i < sizeof(task_names) / sizeof(task_names[0]); i++) {
+        TaskHandle_t task = xTaskGetHandle(task_names[i]);
+        if (task) {
+            // On ESP-IDF, stacks are counted in bytes.
+            printf("%-12s %10u bytes\n", task_names[i], (unsigned)uxTaskGetStackHighWaterMark(task));
+        }
+    }
+    printf("Heap: %u bytes free, %u at the lowest, largest block %u\n",
+           (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+           (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+           (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
+
+// Print the trace in base64 between markers, for tools/perftrace.py to pick out of the serial log.
+static void print_trace() {
+    size_t   size = perf_trace_size();
+    uint8_t* buf  = malloc(size);
+    if (!buf) {
+        printf("Out of memory\n");
+        return;
+    }
+    size = perf_trace_read(buf, size);
+    printf("PERF TRACE BEGIN\n");
+    for (size_t pos = 0; pos < size; pos += TRACE_LINE_BYTES) {
+        unsigned char line[4 * TRACE_LINE_BYTES / 3 + 1];
+        size_t        len;
+        mbedtls_base64_encode(line, sizeof(line), &len, buf + pos,
+                              size - pos < TRACE_LINE_BYTES ? size - pos : TRACE_LINE_BYTES);
+        printf("%s\n", line);
+    }
+    printf("PERF TRACE END\n");
+    free(buf);
+}
+
+// The `perf` console command.
+static int perf_command(int argc, char** argv) {
+    if (argc == 1) {
+        perf_print_counters();
+        print_memory();
+    } else if (argc == 2 && !strcmp(argv[1], "hist")) {
+        perf_print_histograms();
+    } else if (argc == 2 && !strcmp(argv[1], "reset")) {
+        perf_reset();
+    } else if (argc == 2 && !strcmp(argv[1], "trace")) {
+        print_trace();
+    } else {
+        printf("Usage: perf [hist|reset|trace]\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Start the serial console with the `perf` command.
+esp_err_t perf_console_start() {
+    esp_console_repl_t*       repl        = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt                    = "badge>";
+
+#if defined(CONFIG_ESP_CONSOLE_UART_DEFAULT) || defined(CONFIG_ESP_CONSOLE_UART_CUSTOM)
+    esp_console_dev_uart_config_t hw_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    esp_err_t                     res       = esp_console_new_repl_uart(&hw_config, &repl_config, &repl);
+#elif defined(CONFIG_ESP_CONSOLE_USB_CDC)
+    esp_console_dev_usb_cdc_config_t hw_config = ESP_CONSOLE_DEV_CDC_CONFIG_DEFAULT();
+    esp_err_t                        res       = esp_console_new_repl_usb_cdc(&hw_config, &repl_config, &repl);
+#elif defined(CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG)
+    esp_console_dev_usb_serial_jtag_config_t hw_config = ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+    esp_err_t res = esp_console_new_repl_usb_serial_jtag(&hw_config, &repl_config, &repl);
+#else
+    esp_err_t res = ESP_ERR_NOT_SUPPORTED;
+#endif
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    esp_console_cmd_t const command = {
+        .command = "perf",
+        .help    = "Show the performance counters, stack and heap use; 'hist' shows histograms, 'reset' clears the "
+                   "counters and 'trace' dumps the trace for tools/perftrace.py",
+        .func    = perf_command,
+    };
+    res = esp_console_cmd_register(&command);
+    if (res != ESP_OK) {
+        return res;
+    }
+    return esp_console_start_repl(repl);
+}
+#endif
@@ -0,0 +1,190 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "player.h"
+#include <dirent.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "image.h"
+
+// Largest column that can be decoded, in bytes.
+#define MAX_COLUMN_SIZE (3 * 256)
+// Bits of the column positions; they wrap around together with the phase.
+#define POS_BITS        (16 + PLAYER_CYCLE_SHIFT)
+// Mask of the column positions.
+#define POS_MASK        ((1u << POS_BITS) - 1)
+
+// Directory to play from.
+static char const* player_dir;
+// Called when the read-ahead should run.
+static void (*player_wake)();
+
+// Decoded columns waiting to be played.
+static rgb_t          ring[PLAYER_BUFFER_COLUMNS][LED_LENGTH];
+// Number of columns written into `ring`; only written by the read-ahead.
+static atomic_size_t  ring_head;
+// Number of columns taken out of `ring`; only written by the render path.
+static atomic_size_t  ring_tail;
+// Playback statistics.
+static player_stats_t stats;
+
+// File being read, or NULL.
+static FILE*          file;
+// Index of the file being read among the column images in `player_dir`.
+static size_t         file_index;
+// Header of the file being read.
+static image_header_t header;
+// Palette of the file being read.
+static rgb_t          palette[256];
+// Columns left to read from the file.
+static size_t         columns_left;
+// Column being decoded.
+static image_t        column_image;
+// Raw data of the column being decoded.
+static uint8_t        column_data[MAX_COLUMN_SIZE];
+// Whether any column was read since the player last started over at the first file.
+static bool           read_since_wrap = true;
+
+// Column that is currently shown.
+static rgb_t    shown[LED_LENGTH];
+// Position of the shown column in columns since playback started, modulo 2^`POS_BITS` like the phase.
+static uint32_t shown_pos;
+// Whether anything has been shown yet.
+static bool     started;
+
+// Set the directory to play all column image files from, in directory order.
+// `wake` is called from the render path when the read-ahead should fill the buffer.
+void player_init(char const* dir, void (*wake)()) {
+    player_dir  = dir;
+    player_wake = wake;
+}
+
+// Open the column image file with the given index in `player_dir`, leaving `file` NULL if it is not valid.
+// Returns false if there is no such file.
+static bool open_file(size_t index) {
+    DIR* dir = opendir(player_dir);
+    if (!dir) {
+        return false;
+    }
+    struct dirent* ent;
+    char           path[256];
+    size_t         i     = 0;
+    bool           found = false;
+    while (!found && (ent = readdir(dir))) {
+        size_t name_len = strlen(ent->d_name);
+        if (name_len < 4 || strcasecmp(ent->d_name + name_len - 4, ".col") || i++ != index) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", player_dir, ent->d_name);
+        found = true;
+    }
+    closedir(dir);
+    if (!found || !(file = fopen(path, "rb"))) {
+        return found;
+    }
+
+    size_t column_size;
+    if (fread(&header, sizeof(header), 1, file) != 1 || image_check_header(&header, &column_size) != ESP_OK ||
+        column_size > MAX_COLUMN_SIZE || header.palette_len > 256 ||
+        fread(palette, sizeof(rgb_t), header.palette_len, file) != header.palette_len) {
+        fclose(file);
+        file = NULL;
+        return true;
+    }
+    column_image.header      = &header;
+    column_image.palette     = palette;
+    column_image.data        = column_data;
+    column_image.column_size = column_size;
+    columns_left             = (uint32_t)header.width * header.frames;
+    stats.files_opened++;
+    return true;
+}
+
+// Open the next file to play, starting over after the last one.
+// Returns false if a whole pass over the directory did not produce anything to play.
+static bool open_next_file() {
+    if (file) {
+        fclose(file);
+        file = NULL;
+    }
+    if (!open_file(file_index)) {
+        if (!read_since_wrap) {
+            file_index = 0;
+            return false;
+        }
+        read_since_wrap = false;
+        file_index      = 0;
+        if (!open_file(file_index)) {
+            return false;
+        }
+    }
+    file_index++;
+    return true;
+}
+
+// Read ahead until the buffer is full; call this from the read-ahead task.
+// Returns false if there is nothing to play.
+bool player_fill() {
+    if (!player_dir) {
+        return false;
+    }
+    size_t head = atomic_load(&ring_head);
+    while (head - atomic_load(&ring_tail) < PLAYER_BUFFER_COLUMNS) {
+        if (!file || columns_left == 0) {
+            if (!open_next_file()) {
+                return false;
+            }
+            continue;
+        }
+        if (fread(column_data, column_image.column_size, 1, file) != 1) {
+            // Truncated file; move on to the next one.
+            columns_left = 0;
+            continue;
+        }
+        columns_left--;
+        image_column(&column_image, 0, 0, ring[head % PLAYER_BUFFER_COLUMNS]);
+        atomic_store(&ring_head, ++head);
+        stats.columns_read++;
+        read_since_wrap = true;
+    }
+    return true;
+}
+
+// Whether anything has been read that can be played.
+bool player_available() {
+    return atomic_load(&ring_head) != 0;
+}
+
+// Render the column that is due at `phase` into the first `LED_LENGTH` pixels of `fb`, for the player effect.
+void player_render(rgb_t* fb, phase_t phase) {
+    uint32_t due = phase >> (16 - PLAYER_CYCLE_SHIFT);
+    if (!started) {
+        started   = true;
+        shown_pos = (due - 1) & POS_MASK;
+    }
+
+    // Take columns out of the buffer until the due one; skips columns if playback runs faster than the frame rate.
+    // Positions are compared modulo 2^`POS_BITS`, so that playback carries on when the phase wraps around.
+    size_t tail = atomic_load(&ring_tail);
+    while ((int32_t)((due - shown_pos) << (32 - POS_BITS)) > 0) {
+        if (tail == atomic_load(&ring_head)) {
+            stats.stalls++;
+            break;
+        }
+        memcpy(shown, ring[tail % PLAYER_BUFFER_COLUMNS], sizeof(shown));
+        atomic_store(&ring_tail, ++tail);
+        shown_pos = (shown_pos + 1) & POS_MASK;
+        stats.columns_played++;
+    }
+    if (player_wake && atomic_load(&ring_head) - tail <= PLAYER_BUFFER_COLUMNS / 2) {
+        player_wake();
+    }
+    memcpy(fb, shown, sizeof(shown));
+}
+
+// Get a copy of the playback statistics.
+void player_get_stats(player_stats_t* out) {
+    *out = stats;
+}
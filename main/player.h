@@ -0,0 +1,51 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Streaming player for column images and animations on the FAT partition.
+// A read-ahead task decodes columns into a small ring buffer, so the render path never waits for flash and memory
+// use does not depend on the size of the files being played.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "effects.h"
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// Number of decoded columns buffered ahead of playback.
+#define PLAYER_BUFFER_COLUMNS CONFIG_PLAYER_BUFFER_COLUMNS
+// Columns played per animation cycle, as a power of two.
+#define PLAYER_CYCLE_SHIFT    6
+
+// Playback statistics.
+typedef struct {
+    // Number of columns decoded by the read-ahead.
+    uint32_t columns_read;
+    // Number of columns shown.
+    uint32_t columns_played;
+    // Number of times a column was due but not buffered yet.
+    uint32_t stalls;
+    // Number of files opened.
+    uint32_t files_opened;
+} player_stats_t;
+
+// Set the directory to play all column image files from, in directory order.
+// `wake` is called from the render path when the read-ahead should fill the buffer.
+void player_init(char const* dir, void (*wake)());
+
+// Read ahead until the buffer is full; call this from the read-ahead task.
+// Returns false if there is nothing to play.
+bool player_fill();
+
+// Whether anything has been read that can be played.
+bool player_available();
+
+// Render the column that is due at `phase` into the first `LED_LENGTH` pixels of `fb`, for the player effect.
+void player_render(rgb_t* fb, phase_t phase);
+
+// Get a copy of the playback statistics.
+void player_get_stats(player_stats_t* stats);
+
+// Start the read-ahead task, playing files from `dir`.
+esp_err_t player_start(char const* dir);
@@ -0,0 +1,44 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "player.h"
+
+static char const TAG[] = "player";
+
+// Task that reads ahead for the player.
+static TaskHandle_t player_task_handle;
+
+// Wake up the read-ahead task.
+static void player_task_wake() {
+    xTaskNotifyGive(player_task_handle);
+}
+
+// Task that keeps the player buffer filled.
+static void player_task(void* arg) {
+    while (1) {
+        if (player_fill()) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        } else {
+            // Nothing to play; look again later.
+            vTaskDelay(pdMS_TO_TICKS(10000));
+        }
+    }
+}
+
+// Start the read-ahead task, playing files from `dir`.
+esp_err_t player_start(char const* dir) {
+    if (player_task_handle) {
+        return ESP_OK;
+    }
+    player_init(dir, player_task_wake);
+    // Flash reads are slow but not urgent, so this runs below the render task; the buffer covers the latency.
+    if (xTaskCreate(player_task, "player", 4096, NULL, CONFIG_RENDER_TASK_PRIORITY - 1, &player_task_handle) !=
+        pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Streaming from %s with %d columns of read-ahead", dir, PLAYER_BUFFER_COLUMNS);
+    return ESP_OK;
+}
@@ -0,0 +1,61 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "playlist.h"
+#include "effect_cache.h"
+
+// Default time each effect is shown in playlist mode, in seconds.
+#define DEF_DURATION      30
+// Default crossfade duration in milliseconds.
+#define DEF_TRANSITION_MS 2000
+
+// Buffer for the effect that is being faded out.
+static rgb_t scratch[LED_COUNT] __attribute__((aligned(4)));
+
+// Fill in the default playlist: every effect in order.
+void playlist_defaults(playlist_t* playlist) {
+    playlist->version       = PLAYLIST_VERSION;
+    playlist->len           = effects_len < PLAYLIST_MAX_LEN ? effects_len : PLAYLIST_MAX_LEN;
+    playlist->transition_ms = DEF_TRANSITION_MS;
+    for (size_t i = 0; i < playlist->len; i++) {
+        playlist->entries[i].effect     = i;
+        playlist->entries[i].duration_s = DEF_DURATION;
+    }
+}
+
+// Check that a playlist has a known layout and only refers to existing effects.
+bool playlist_valid(playlist_t const* playlist) {
+    if (playlist->version != PLAYLIST_VERSION || playlist->len == 0 || playlist->len > PLAYLIST_MAX_LEN) {
+        return false;
+    }
+    for (size_t i = 0; i < playlist->len; i++) {
+        if (playlist->entries[i].effect >= effects_len || playlist->entries[i].duration_s == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Start fading to another effect; a running fade continues from what is currently shown.
+void crossfade_start(crossfade_t* fade, size_t to, int64_t now, int64_t duration) {
+    // If the previous fade is less than halfway done, keep fading out the same effect.
+    if (now - fade->start >= fade->duration / 2) {
+        fade->from = fade->to;
+    }
+    fade->to       = to;
+    fade->start    = now;
+    fade->duration = duration;
+    effect_cache_prepare(to);
+}
+
+// Render one frame of a crossfade into `fb`.
+void crossfade_render(crossfade_t* fade, rgb_t* fb, phase_t phase, int64_t now) {
+    effect_cache_render(fade->to, fb, phase);
+    int64_t elapsed = now - fade->start;
+    if (fade->from == fade->to || elapsed >= fade->duration) {
+        fade->from = fade->to;
+        return;
+    }
+    effect_cache_render(fade->from, scratch, phase);
+    rgb_blend(fb, scratch, fb, LED_COUNT, elapsed * 0x100 / fade->duration);
+}
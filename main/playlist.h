@@ -0,0 +1,59 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "effects.h"
+
+// Maximum number of entries in a playlist.
+#define PLAYLIST_MAX_LEN  16
+// Version of the `playlist_t` layout, as stored in NVS.
+#define PLAYLIST_VERSION  1
+// Value of `effect_no` that selects playlist mode instead of a single effect.
+#define PLAYLIST_EFFECT_NO 0xffff
+
+// One entry in a playlist.
+typedef struct {
+    // Index into `effects`.
+    uint8_t  effect;
+    // How long to show the effect, in seconds.
+    uint16_t duration_s;
+} playlist_entry_t;
+
+// A list of effects that are played on a schedule.
+typedef struct {
+    // Layout version, must be `PLAYLIST_VERSION`.
+    uint8_t          version;
+    // Number of entries.
+    uint8_t          len;
+    // Duration of the crossfade between two effects, in milliseconds.
+    uint16_t         transition_ms;
+    // The entries, in playing order.
+    playlist_entry_t entries[PLAYLIST_MAX_LEN];
+} playlist_t;
+
+// A crossfade from one effect to another.
+typedef struct {
+    // Effect being faded out.
+    size_t  from;
+    // Effect being faded in.
+    size_t  to;
+    // Time at which the fade started, in microseconds.
+    int64_t start;
+    // Duration of the fade in microseconds.
+    int64_t duration;
+} crossfade_t;
+
+// Fill in the default playlist: every effect in order.
+void playlist_defaults(playlist_t* playlist);
+
+// Check that a playlist has a known layout and only refers to existing effects.
+bool playlist_valid(playlist_t const* playlist);
+
+// Start fading to another effect; a running fade continues from what is currently shown.
+void crossfade_start(crossfade_t* fade, size_t to, int64_t now, int64_t duration);
+
+// Render one frame of a crossfade into `fb`.
+void crossfade_render(crossfade_t* fade, rgb_t* fb, phase_t phase, int64_t now);
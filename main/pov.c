@@ -0,0 +1,48 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "pov.h"
+#include "output.h"
+
+// Buffer holding the column-major POV image.
+static rgb_t    pov_buffer[POV_MAX_COLUMNS][LED_COUNT];
+// Gamma and brightness for the POV image; columns are shown many times, so they are not dithered.
+static output_t pov_output;
+
+// Rasterise `columns_len` columns of an effect over `cycles` animation cycles into the POV image buffer.
+// Gamma and brightness are applied here, so that playback does not have to touch the pixels.
+void pov_load_effect(pov_t* pov, effect_t const* effect, size_t columns_len, uint16_t cycles, uint16_t brightness) {
+    if (columns_len > POV_MAX_COLUMNS) {
+        columns_len = POV_MAX_COLUMNS;
+    }
+    output_set_brightness(&pov_output, brightness);
+    for (size_t i = 0; i < columns_len; i++) {
+        phase_t phase = (uint64_t)i * cycles * PHASE_ONE / columns_len;
+        effect->render(pov_buffer[i], phase);
+        output_apply_static(&pov_output, pov_buffer[i], pov_buffer[i], LED_COUNT);
+    }
+    pov->columns     = pov_buffer[0];
+    pov->columns_len = columns_len;
+    pov->index       = 0;
+    pov->emitted     = 0;
+    pov->missed      = 0;
+}
+
+// Decode the first frame of a column image into the POV image buffer, applying gamma and brightness.
+void pov_load_image(pov_t* pov, image_t const* image, uint16_t brightness) {
+    size_t columns_len = image->header->width;
+    if (columns_len > POV_MAX_COLUMNS) {
+        columns_len = POV_MAX_COLUMNS;
+    }
+    output_set_brightness(&pov_output, brightness);
+    for (size_t i = 0; i < columns_len; i++) {
+        image_column(image, 0, i, pov_buffer[i]);
+        led_extrude(pov_buffer[i]);
+        output_apply_static(&pov_output, pov_buffer[i], pov_buffer[i], LED_COUNT);
+    }
+    pov->columns     = pov_buffer[0];
+    pov->columns_len = columns_len;
+    pov->index       = 0;
+    pov->emitted     = 0;
+    pov->missed      = 0;
+}
@@ -0,0 +1,57 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "effects.h"
+#include "esp_err.h"
+#include "image.h"
+#include "sdkconfig.h"
+
+// Value of `effect_no` that selects POV playback instead of an effect.
+#define POV_EFFECT_NO 0xfffe
+
+// Maximum number of columns in a POV image.
+#define POV_MAX_COLUMNS CONFIG_POV_MAX_COLUMNS
+
+// Playback state of a POV image.
+typedef struct {
+    // Column-major image; every column is `LED_COUNT` pixels.
+    rgb_t const* columns;
+    // Number of columns in the image.
+    size_t       columns_len;
+    // Index of the next column to emit.
+    size_t       index;
+    // Number of columns emitted.
+    uint32_t     emitted;
+    // Number of timer ticks that passed without emitting a column.
+    uint32_t     missed;
+} pov_t;
+
+// Rasterise `columns_len` columns of an effect over `cycles` animation cycles into the POV image buffer.
+// Gamma and brightness are applied here, so that playback does not have to touch the pixels.
+void pov_load_effect(pov_t* pov, effect_t const* effect, size_t columns_len, uint16_t cycles, uint16_t brightness);
+
+// Decode the first frame of a column image into the POV image buffer, applying gamma and brightness.
+void pov_load_image(pov_t* pov, image_t const* image, uint16_t brightness);
+
+// Get the column to emit; `ticks` is the number of timer ticks since the previous column.
+// Missed ticks skip columns so the image keeps its proportions.
+static inline rgb_t const* pov_next(pov_t* pov, uint32_t ticks) {
+    if (ticks > 1) {
+        pov->missed += ticks - 1;
+        pov->index   = (pov->index + ticks - 1) % pov->columns_len;
+    }
+    rgb_t const* column = pov->columns + pov->index * LED_COUNT;
+    pov->index          = pov->index + 1 < pov->columns_len ? pov->index + 1 : 0;
+    pov->emitted++;
+    return column;
+}
+
+// Start emitting one column of `pov` per timer tick.
+esp_err_t pov_start(pov_t* pov);
+
+// Stop POV playback; returns once the last column has been written, so that the LEDs are free for the render task.
+void pov_stop();
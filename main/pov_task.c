@@ -0,0 +1,102 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include <inttypes.h>
+#include "bsp/led.h"
+#include "driver/gptimer.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "pov.h"
+
+static char const TAG[] = "pov";
+
+// Hardware timer that paces the columns.
+static gptimer_handle_t  timer;
+// Task that writes the columns to the LEDs.
+static TaskHandle_t      pov_task_handle;
+// Image being played back.
+static pov_t*            playing;
+// Set by `pov_stop` to ask the POV task to stop.
+static volatile bool     stop_requested;
+// Given by the POV task once it has stopped.
+static SemaphoreHandle_t stopped;
+
+// Column timer interrupt; wakes up the POV task.
+static bool IRAM_ATTR column_timer_isr(gptimer_handle_t timer, gptimer_alarm_event_data_t const* edata, void* arg) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(pov_task_handle, &woken);
+    return woken == pdTRUE;
+}
+
+// Task that emits one column per timer tick.
+static void pov_task(void* arg) {
+    while (1) {
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (stop_requested) {
+            // Ticks still pending from before the timer stopped were cleared by taking them, so they are not counted
+            // as missed columns when playback starts again.
+            stop_requested = false;
+            xSemaphoreGive(stopped);
+            continue;
+        }
+        bsp_led_write((uint8_t*)pov_next(playing, ticks), LED_COUNT * sizeof(rgb_t));
+    }
+}
+
+// Start emitting one column of `pov` per timer tick.
+esp_err_t pov_start(pov_t* pov) {
+    playing = pov;
+    if (!pov_task_handle) {
+        stopped = xSemaphoreCreateBinary();
+        if (!stopped) {
+            return ESP_ERR_NO_MEM;
+        }
+        // Columns must go out on time, so this runs above everything else the firmware does.
+        if (xTaskCreate(pov_task, "pov", 3072, NULL, configMAX_PRIORITIES - 2, &pov_task_handle) != pdPASS) {
+            return ESP_ERR_NO_MEM;
+        }
+
+        gptimer_config_t const timer_config = {
+            .clk_src       = GPTIMER_CLK_SRC_DEFAULT,
+            .direction     = GPTIMER_COUNT_UP,
+            .resolution_hz = 1000000,
+        };
+        ESP_RETURN_ON_ERROR(gptimer_new_timer(&timer_config, &timer), TAG, "Failed to create timer");
+
+        gptimer_alarm_config_t const alarm_config = {
+            .alarm_count                = CONFIG_POV_COLUMN_PERIOD_US,
+            .reload_count               = 0,
+            .flags.auto_reload_on_alarm = true,
+        };
+        ESP_RETURN_ON_ERROR(gptimer_set_alarm_action(timer, &alarm_config), TAG, "Failed to set alarm");
+
+        gptimer_event_callbacks_t const callbacks = {
+            .on_alarm = column_timer_isr,
+        };
+        ESP_RETURN_ON_ERROR(gptimer_register_event_callbacks(timer, &callbacks, NULL), TAG,
+                            "Failed to register callback");
+        ESP_RETURN_ON_ERROR(gptimer_enable(timer), TAG, "Failed to enable timer");
+    }
+
+    ESP_LOGI(TAG, "Playing %zu columns every %d us", pov->columns_len, CONFIG_POV_COLUMN_PERIOD_US);
+    return gptimer_start(timer);
+}
+
+// Stop POV playback; returns once the last column has been written, so that the LEDs are free for the render task.
+void pov_stop() {
+    if (!timer) {
+        return;
+    }
+    gptimer_stop(timer);
+    // No more ticks arrive now; wake the POV task so that it finishes the column it may be writing and acknowledges.
+    stop_requested = true;
+    xTaskNotifyGive(pov_task_handle);
+    xSemaphoreTake(stopped, portMAX_DELAY);
+    if (playing) {
+        ESP_LOGI(TAG, "Stopped after %" PRIu32 " columns, %" PRIu32 " missed", playing->emitted, playing->missed);
+    }
+}
@@ -0,0 +1,413 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "render.h"
+#include <string.h>
+#include "bsp/led.h"
+#include "effect_cache.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "output.h"
+#include "perf.h"
+#include "sdkconfig.h"
+#include "stream.h"
+#include "timebase.h"
+
+// Number of framebuffers; the next frame is rendered while the previous one is being transmitted.
+#define FRAMEBUFFER_COUNT 2
+
+// Duration of one frame in microseconds.
+#define FRAME_PERIOD_US (1000000 / CONFIG_RENDER_FPS)
+
+#if CONFIG_FREERTOS_NUMBER_OF_CORES > 1 && CONFIG_RENDER_TASK_CORE >= 0
+#define RENDER_TASK_CORE CONFIG_RENDER_TASK_CORE
+#else
+#define RENDER_TASK_CORE tskNO_AFFINITY
+#endif
+
+static char const TAG[] = "render";
+
+// Settings that are set from other tasks and picked up at the start of the next frame.
+typedef struct {
+    uint32_t   effect_no;
+    uint32_t   speed;
+    uint16_t   brightness;
+    playlist_t playlist;
+} render_settings_t;
+
+// Protects `requested`, `requested_changed` and `stats`.
+static portMUX_TYPE      lock = portMUX_INITIALIZER_UNLOCKED;
+// Settings requested by other tasks.
+static render_settings_t requested;
+// Whether `requested` changed since the render task last copied it.
+static bool              requested_changed;
+// Frame statistics.
+static render_stats_t    stats;
+
+// Settings currently used by the render task.
+static render_settings_t current;
+// Current animation phase.
+static phase_t           phase;
+// Phase as a function of time.
+static timebase_t        timebase;
+// Current position in the playlist.
+static size_t            playlist_pos;
+// When to advance to the next playlist entry.
+static int64_t           playlist_next = INT64_MAX;
+// Crossfade between effects.
+static crossfade_t       fade;
+// Gamma, brightness and dithering.
+static output_t          output;
+
+// The framebuffers.
+static rgb_t              framebuffers[FRAMEBUFFER_COUNT][LED_COUNT] __attribute__((aligned(4)));
+// Index of the framebuffer to render into next.
+static size_t             back_buffer;
+// Queue of framebuffers waiting for transmission.
+static QueueHandle_t      tx_queue;
+// Counts the framebuffers that are free to render into.
+static SemaphoreHandle_t  free_buffers;
+// Handle of the render task, notified by the frame timer.
+static TaskHandle_t       render_task_handle;
+// Timer that paces the frames.
+static esp_timer_handle_t frame_timer;
+// Whether rendering is paused.
+static volatile bool      paused;
+// Whether the frame timer is stopped because the frame is static.
+static volatile bool      idle;
+// When the frame timer was stopped, in microseconds.
+static int64_t            idle_since;
+// Last frame the effects rendered, before the output stage.
+static rgb_t              last_rendered[LED_COUNT];
+// Last frame sent to the LEDs.
+static rgb_t              last_sent[LED_COUNT];
+// Whether something else drove the LEDs, so that `last_rendered` and `last_sent` no longer match them.
+static volatile bool      last_stale;
+
+// Task that sends finished frames to the LEDs.
+static void output_task(void* arg) {
+    while (1) {
+        rgb_t* fb;
+        xQueueReceive(tx_queue, &fb, portMAX_DELAY);
+        PERF_START(write_start);
+        esp_err_t res = bsp_led_write((uint8_t*)fb, LED_COUNT * sizeof(rgb_t));
+        PERF_END(PERF_LED_WRITE, write_start);
+        if (res != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to write LEDs: %s", esp_err_to_name(res));
+        }
+        if (!stats.first_frame_us) {
+            taskENTER_CRITICAL(&lock);
+            stats.first_frame_us = esp_timer_get_time();
+            taskEXIT_CRITICAL(&lock);
+        }
+        xSemaphoreGive(free_buffers);
+    }
+}
+
+// Get the framebuffer to render the next frame into.
+// Blocks while all framebuffers are still queued for transmission.
+static rgb_t* render_begin() {
+    xSemaphoreTake(free_buffers, portMAX_DELAY);
+    return framebuffers[back_buffer];
+}
+
+// Map the framebuffer from `render_begin` to LED levels and queue it for transmission.
+// Returns false if the frame was not sent because the LEDs already show it.
+static bool render_submit() {
+    rgb_t* fb = framebuffers[back_buffer];
+
+    // A frame that did not change is shown without dithering, so that it stops changing on the LEDs too.
+    PERF_START(output_start);
+    bool stale = last_stale;
+    last_stale = false;
+    if (stale || memcmp(fb, last_rendered, sizeof(last_rendered))) {
+        memcpy(last_rendered, fb, sizeof(last_rendered));
+        output_apply(&output, fb, fb, LED_COUNT);
+    } else {
+        output_apply_static(&output, fb, fb, LED_COUNT);
+    }
+    PERF_END(PERF_OUTPUT, output_start);
+
+    if (!stale && !memcmp(fb, last_sent, sizeof(last_sent))) {
+        xSemaphoreGive(free_buffers);
+        return false;
+    }
+    memcpy(last_sent, fb, sizeof(last_sent));
+    xQueueSend(tx_queue, &fb, portMAX_DELAY);
+    back_buffer = (back_buffer + 1) % FRAMEBUFFER_COUNT;
+    return true;
+}
+
+// Stop the frame timer while nothing can change the frame; settings changes and the playlist wake it up again.
+static void enter_idle(int64_t now) {
+    idle       = true;
+    idle_since = now;
+    esp_timer_stop(frame_timer);
+    if (current.effect_no == PLAYLIST_EFFECT_NO) {
+        esp_timer_start_once(frame_timer, playlist_next > now ? playlist_next - now : 1);
+    }
+    // Settings that changed before `idle` was set did not wake this task; pick them up right away.
+    if (requested_changed) {
+        xTaskNotifyGive(render_task_handle);
+    }
+}
+
+// Restart the frame timer after `enter_idle`.
+static void leave_idle(int64_t now) {
+    idle = false;
+    esp_timer_stop(frame_timer);
+    esp_timer_start_periodic(frame_timer, FRAME_PERIOD_US);
+    taskENTER_CRITICAL(&lock);
+    stats.idle_us += now - idle_since;
+    taskEXIT_CRITICAL(&lock);
+}
+
+// Get the effect that should currently be shown.
+static size_t current_effect() {
+    if (current.effect_no == PLAYLIST_EFFECT_NO) {
+        return current.playlist.entries[playlist_pos].effect;
+    }
+    return current.effect_no;
+}
+
+// Copy the requested settings if they changed, and start a crossfade if the effect changed.
+static void apply_settings(int64_t now) {
+    if (!requested_changed) {
+        return;
+    }
+    uint32_t prev_effect_no = current.effect_no;
+    taskENTER_CRITICAL(&lock);
+    current           = requested;
+    requested_changed = false;
+    taskEXIT_CRITICAL(&lock);
+
+    if (current.speed != timebase.speed) {
+        timebase_set_speed(&timebase, now, current.speed);
+    }
+    if (current.brightness != output.brightness) {
+        output_set_brightness(&output, current.brightness);
+    }
+    if (playlist_pos >= current.playlist.len) {
+        playlist_pos = 0;
+    }
+    if (current.effect_no != prev_effect_no) {
+        if (current.effect_no == PLAYLIST_EFFECT_NO) {
+            playlist_pos  = 0;
+            playlist_next = now + current.playlist.entries[0].duration_s * 1000000LL;
+        }
+        crossfade_start(&fade, current_effect(), now, current.playlist.transition_ms * 1000);
+    }
+}
+
+// Task that renders a frame every time the frame timer fires.
+static void render_task(void* arg) {
+    while (1) {
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t  time  = esp_timer_get_time();
+        if (paused) {
+            continue;
+        }
+        if (idle) {
+            // Woken up by a settings change or the playlist; the ticks did not come from the frame timer.
+            leave_idle(time);
+            ticks = 1;
+        }
+        apply_settings(time);
+
+        phase = timebase_phase(&timebase, time);
+
+        // Advance the playlist.
+        if (current.effect_no == PLAYLIST_EFFECT_NO && time >= playlist_next) {
+            playlist_pos   = (playlist_pos + 1) % current.playlist.len;
+            playlist_next += current.playlist.entries[playlist_pos].duration_s * 1000000LL;
+            crossfade_start(&fade, current_effect(), time, current.playlist.transition_ms * 1000);
+        }
+
+        rgb_t* fb = render_begin();
+        if (paused) {
+            // Paused while waiting for a framebuffer; don't touch the LEDs anymore.
+            xSemaphoreGive(free_buffers);
+            continue;
+        }
+        PERF_START(render_start);
+#if CONFIG_STREAM_RECEIVER
+        // A live stream takes the place of the effects, which come back when it stops.
+        bool streaming = stream_render(fb, time);
+#else
+        bool streaming = false;
+#endif
+        if (!streaming) {
+            crossfade_render(&fade, fb, phase, time);
+        }
+        PERF_END(PERF_RENDER, render_start);
+        bool sent = render_submit();
+
+        // Without speed or a running crossfade, a frame that did not change will not change until something else does.
+        // A stream keeps the frame timer running, to notice when it stops; new frames wake it up when it is idle.
+        if (!sent && !streaming && current.speed == 0 && fade.from == fade.to) {
+            enter_idle(time);
+        }
+
+        uint32_t frame_us = esp_timer_get_time() - time;
+        taskENTER_CRITICAL(&lock);
+        stats.frames_rendered++;
+        stats.frames_transmitted += sent;
+        stats.frames_skipped     += !sent;
+        stats.frames_dropped     += ticks - 1;
+        stats.limited_frames      = output.stats.limited_frames;
+        stats.current_ma          = output.stats.current_ma;
+        stats.max_unlimited_ma    = output.stats.max_unlimited_ma;
+        if (frame_us > FRAME_PERIOD_US) {
+            stats.deadline_misses++;
+        }
+        if (frame_us > stats.max_frame_us) {
+            stats.max_frame_us = frame_us;
+        }
+        taskEXIT_CRITICAL(&lock);
+    }
+}
+
+// Frame timer callback; wakes up the render task.
+static void frame_timer_cb(void* arg) {
+    xTaskNotifyGive(render_task_handle);
+}
+
+// Start the render task, the LED output task and the frame timer.
+esp_err_t render_start() {
+    // Start showing whatever was requested before the render task existed.
+    current           = requested;
+    requested_changed = false;
+    if (current.effect_no == PLAYLIST_EFFECT_NO) {
+        playlist_next = esp_timer_get_time() + current.playlist.entries[0].duration_s * 1000000LL;
+    }
+    fade.from = fade.to = current_effect();
+    effect_cache_prepare(fade.to);
+    output_set_brightness(&output, current.brightness);
+    output.budget_ma = CONFIG_LED_CURRENT_BUDGET_MA;
+    timebase_init(&timebase, esp_timer_get_time(), current.speed);
+
+    tx_queue     = xQueueCreate(FRAMEBUFFER_COUNT, sizeof(rgb_t*));
+    free_buffers = xSemaphoreCreateCounting(FRAMEBUFFER_COUNT, FRAMEBUFFER_COUNT);
+    if (!tx_queue || !free_buffers) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(output_task, "led_output", 3072, NULL, CONFIG_RENDER_TASK_PRIORITY + 1, NULL,
+                                RENDER_TASK_CORE) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(render_task, "render", 4096, NULL, CONFIG_RENDER_TASK_PRIORITY, &render_task_handle,
+                                RENDER_TASK_CORE) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+#if CONFIG_RENDER_LIGHT_SLEEP
+    // Let the CPU sleep between frames, and for as long as the frame timer is stopped.
+    esp_pm_config_t const pm_config = {
+        .max_freq_mhz       = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz       = CONFIG_XTAL_FREQ,
+        .light_sleep_enable = true,
+    };
+    esp_err_t pm_res = esp_pm_configure(&pm_config);
+    if (pm_res != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to enable light sleep: %s", esp_err_to_name(pm_res));
+    }
+#endif
+
+    esp_timer_create_args_t const timer_args = {
+        .callback = frame_timer_cb,
+        .name     = "frame",
+    };
+    esp_err_t res = esp_timer_create(&timer_args, &frame_timer);
+    if (res != ESP_OK) {
+        return res;
+    }
+    ESP_LOGI(TAG, "Rendering at %d fps", CONFIG_RENDER_FPS);
+    res = esp_timer_start_periodic(frame_timer, FRAME_PERIOD_US);
+    // Render the first frame right away instead of a frame period from now.
+    xTaskNotifyGive(render_task_handle);
+    return res;
+}
+
+// Stop rendering and wait until the LEDs are no longer being written.
+void render_pause() {
+    paused = true;
+    esp_timer_stop(frame_timer);
+    // All framebuffers are free once the frame in progress and the queued frames are sent.
+    for (size_t i = 0; i < FRAMEBUFFER_COUNT; i++) {
+        xSemaphoreTake(free_buffers, portMAX_DELAY);
+    }
+    for (size_t i = 0; i < FRAMEBUFFER_COUNT; i++) {
+        xSemaphoreGive(free_buffers);
+    }
+}
+
+// Continue rendering after `render_pause`.
+esp_err_t render_resume() {
+    if (idle) {
+        idle = false;
+        taskENTER_CRITICAL(&lock);
+        stats.idle_us += esp_timer_get_time() - idle_since;
+        taskEXIT_CRITICAL(&lock);
+    }
+    // The LEDs show whatever drove them during the pause; send the next frame even if it did not change.
+    last_stale = true;
+    paused     = false;
+    // `enter_idle` may have armed a one-shot wakeup before the pause stopped the timer.
+    esp_timer_stop(frame_timer);
+    return esp_timer_start_periodic(frame_timer, FRAME_PERIOD_US);
+}
+
+// Wake up the render task if it is idle, so that it picks up changed settings or a new streamed frame.
+void render_wake() {
+    if (idle && render_task_handle) {
+        xTaskNotifyGive(render_task_handle);
+    }
+}
+
+// Select an effect by index into `effects`, or `PLAYLIST_EFFECT_NO` for playlist mode.
+void render_set_effect(uint32_t effect_no) {
+    taskENTER_CRITICAL(&lock);
+    requested.effect_no = effect_no;
+    requested_changed   = true;
+    taskEXIT_CRITICAL(&lock);
+    render_wake();
+}
+
+// Set the animation speed in thousandths of a cycle per second.
+void render_set_speed(uint32_t speed) {
+    taskENTER_CRITICAL(&lock);
+    requested.speed   = speed;
+    requested_changed = true;
+    taskEXIT_CRITICAL(&lock);
+    render_wake();
+}
+
+// Set the brightness multiplier in Q8; 0x100 is full brightness.
+void render_set_brightness(uint16_t brightness) {
+    taskENTER_CRITICAL(&lock);
+    requested.brightness = brightness;
+    requested_changed    = true;
+    taskEXIT_CRITICAL(&lock);
+    render_wake();
+}
+
+// Set the playlist used in playlist mode.
+void render_set_playlist(playlist_t const* playlist) {
+    taskENTER_CRITICAL(&lock);
+    requested.playlist = *playlist;
+    requested_changed  = true;
+    taskEXIT_CRITICAL(&lock);
+    render_wake();
+}
+
+// Get a copy of the frame statistics.
+void render_get_stats(render_stats_t* out) {
+    taskENTER_CRITICAL(&lock);
+    *out = stats;
+    taskEXIT_CRITICAL(&lock);
+}
@@ -0,0 +1,61 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#pragma once
+
+#include "effects.h"
+#include "esp_err.h"
+#include "playlist.h"
+
+// Frame statistics of the render task.
+typedef struct {
+    // Number of frames rendered.
+    uint32_t frames_rendered;
+    // Number of rendered frames that were sent to the LEDs.
+    uint32_t frames_transmitted;
+    // Number of rendered frames that were not sent because they matched the previous one.
+    uint32_t frames_skipped;
+    // Number of timer ticks that were skipped because the previous frame was not done yet.
+    uint32_t frames_dropped;
+    // Number of frames that took longer than one frame period.
+    uint32_t deadline_misses;
+    // Longest time a frame took, in microseconds.
+    uint32_t max_frame_us;
+    // Time spent with the frame timer stopped because nothing could change, in microseconds.
+    uint64_t idle_us;
+    // Number of frames the current limiter dimmed.
+    uint32_t limited_frames;
+    // Estimated LED current of the last frame, in mA.
+    uint32_t current_ma;
+    // Highest estimated LED current a frame would have drawn without the limiter, in mA.
+    uint32_t max_unlimited_ma;
+    // Time at which the first frame was sent to the LEDs, in microseconds since boot, or 0 if none was yet.
+    int64_t  first_frame_us;
+} render_stats_t;
+
+// Start the render task, the LED output task and the frame timer.
+esp_err_t render_start();
+
+// Stop rendering and wait until the LEDs are no longer being written.
+void render_pause();
+
+// Continue rendering after `render_pause`.
+esp_err_t render_resume();
+
+// Select an effect by index into `effects`, or `PLAYLIST_EFFECT_NO` for playlist mode.
+void render_set_effect(uint32_t effect_no);
+
+// Set the animation speed in thousandths of a cycle per second.
+void render_set_speed(uint32_t speed);
+
+// Set the brightness multiplier in Q8; 0x100 is full brightness.
+void render_set_brightness(uint16_t brightness);
+
+// Set the playlist used in playlist mode.
+void render_set_playlist(playlist_t const* playlist);
+
+// Wake up the render task if it is idle, so that it picks up changed settings or a new streamed frame.
+void render_wake();
+
+// Get a copy of the frame statistics.
+void render_get_stats(render_stats_t* stats);
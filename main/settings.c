@@ -0,0 +1,114 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "settings.h"
+#include <string.h>
+
+// Pack settings into the record that is stored.
+uint64_t settings_encode(settings_t const* settings) {
+    return (uint64_t)SETTINGS_VERSION << 56 | (uint64_t)settings->effect_no << 32 | (uint64_t)settings->speed << 16 |
+           settings->brightness;
+}
+
+// Unpack a stored record; returns false if it is of another version.
+bool settings_decode(uint64_t record, settings_t* settings) {
+    if (record >> 56 != SETTINGS_VERSION) {
+        return false;
+    }
+    settings->effect_no  = record >> 32;
+    settings->speed      = record >> 16;
+    settings->brightness = record;
+    return true;
+}
+
+// Initialise a writer; `record` and `playlist` are what is currently stored, or NULL if they are not.
+void settings_writer_init(settings_writer_t* writer, uint64_t const* record, playlist_t const* playlist) {
+    memset(writer, 0, sizeof(settings_writer_t));
+    if (record) {
+        writer->stored       = *record;
+        writer->stored_valid = true;
+    }
+    if (playlist) {
+        writer->stored_playlist = *playlist;
+        writer->playlist_valid  = true;
+    }
+}
+
+// Hand new settings to a writer.
+void settings_writer_request(settings_writer_t* writer, settings_t const* settings, int64_t now_us) {
+    if (!writer->dirty) {
+        writer->first_us = now_us;
+    }
+    writer->pending = *settings;
+    writer->dirty   = true;
+    writer->last_us = now_us;
+    writer->stats.requests++;
+}
+
+// Get the time at which the writer wants to write, or `INT64_MAX` if it has nothing to write.
+int64_t settings_writer_due(settings_writer_t const* writer) {
+    if (!writer->dirty) {
+        return INT64_MAX;
+    }
+    int64_t quiet  = writer->last_us + SETTINGS_QUIET_US;
+    int64_t latest = writer->first_us + SETTINGS_MAX_DELAY_US;
+    return quiet < latest ? quiet : latest;
+}
+
+// Check whether two playlists are the same, ignoring unused entries and padding.
+static bool playlist_equal(playlist_t const* a, playlist_t const* b) {
+    if (a->version != b->version || a->len != b->len || a->transition_ms != b->transition_ms) {
+        return false;
+    }
+    for (size_t i = 0; i < a->len && i < PLAYLIST_MAX_LEN; i++) {
+        if (a->entries[i].effect != b->entries[i].effect || a->entries[i].duration_s != b->entries[i].duration_s) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check whether settings must be written now; if so, stores what to write in `out` and returns true.
+bool settings_writer_take(settings_writer_t* writer, int64_t now_us, settings_write_t* out) {
+    if (now_us < settings_writer_due(writer)) {
+        return false;
+    }
+    writer->dirty       = false;
+    out->record         = settings_encode(&writer->pending);
+    out->playlist       = writer->pending.playlist;
+    out->write_record   = !writer->stored_valid || out->record != writer->stored;
+    out->write_playlist = !writer->playlist_valid || !playlist_equal(&out->playlist, &writer->stored_playlist);
+    if (!out->write_record && !out->write_playlist) {
+        // Changed back to what is stored in the mean time.
+        writer->stats.unchanged++;
+        return false;
+    }
+    return true;
+}
+
+// Report the result of writing `written`, which took `write_us` microseconds; failed writes are retried later.
+void settings_writer_done(settings_writer_t* writer, settings_write_t const* written, bool ok, int64_t now_us,
+                          uint32_t write_us) {
+    writer->stats.max_write_us = write_us > writer->stats.max_write_us ? write_us : writer->stats.max_write_us;
+    if (ok) {
+        if (written->write_record) {
+            writer->stored       = written->record;
+            writer->stored_valid = true;
+        }
+        if (written->write_playlist) {
+            writer->stored_playlist = written->playlist;
+            writer->playlist_valid  = true;
+            writer->stats.playlist_writes++;
+        }
+        writer->stats.writes++;
+        return;
+    }
+    writer->stats.failures++;
+    if (!writer->dirty) {
+        // Nothing newer was requested during the write, so `pending` is still what failed; try it again after the
+        // quiet time.
+        writer->dirty    = true;
+        writer->first_us = now_us;
+        writer->last_us  = now_us;
+    }
+}
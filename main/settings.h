@@ -0,0 +1,118 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Settings that are kept across reboots, stored as one versioned record by a background writer.
+// The record is packed into 64 bits, which NVS stores in a single entry; a blob would take at least three. The playlist
+// does not fit, so the same writer stores it as a blob of its own, which is only written when it changed.
+// Changes are coalesced: the writer waits until the settings have been left alone for a few seconds, and skips the
+// write entirely when they ended up the same as what is stored. NVS appends every write to its log and only erases a
+// page once it is full, so the fewer entries are written, the fewer erases of the small `nvs` partition.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "playlist.h"
+
+// Version of the stored record, in its top 8 bits.
+#define SETTINGS_VERSION      1
+// How long settings must stay unchanged before they are written, in microseconds.
+#define SETTINGS_QUIET_US     3000000
+// Longest a change can wait to be written while the settings keep changing, in microseconds.
+#define SETTINGS_MAX_DELAY_US 10000000
+
+// Settings that are kept across reboots.
+typedef struct {
+    // Index into `effects`, `PLAYLIST_EFFECT_NO` or `POV_EFFECT_NO`.
+    uint16_t   effect_no;
+    // Animation speed in thousandths of a cycle per second.
+    uint16_t   speed;
+    // Brightness multiplier in Q8.
+    uint16_t   brightness;
+    // Effects played in playlist mode; stored apart from the record.
+    playlist_t playlist;
+} settings_t;
+
+// Statistics of the settings writer.
+typedef struct {
+    // Number of times new settings were handed to the writer.
+    uint32_t requests;
+    // Number of times the settings were written.
+    uint32_t writes;
+    // Number of those writes that included the playlist.
+    uint32_t playlist_writes;
+    // Number of writes that were skipped because the settings matched what is stored.
+    uint32_t unchanged;
+    // Number of writes that failed.
+    uint32_t failures;
+    // Longest time a write took, in microseconds.
+    uint32_t max_write_us;
+} settings_stats_t;
+
+// What has to be written.
+typedef struct {
+    // Whether `record` has to be written.
+    bool       write_record;
+    // Record to write.
+    uint64_t   record;
+    // Whether `playlist` has to be written.
+    bool       write_playlist;
+    // Playlist to write.
+    playlist_t playlist;
+} settings_write_t;
+
+// Decides when settings have to be written.
+typedef struct {
+    // Record as it is stored.
+    uint64_t         stored;
+    // Whether a record is stored at all.
+    bool             stored_valid;
+    // Playlist as it is stored.
+    playlist_t       stored_playlist;
+    // Whether a playlist is stored at all.
+    bool             playlist_valid;
+    // Settings as last requested.
+    settings_t       pending;
+    // Whether `pending` has not been considered for writing yet.
+    bool             dirty;
+    // Time of the first request since the last write, in microseconds.
+    int64_t          first_us;
+    // Time of the last request, in microseconds.
+    int64_t          last_us;
+    // Write statistics.
+    settings_stats_t stats;
+} settings_writer_t;
+
+// Pack settings into the record that is stored.
+uint64_t settings_encode(settings_t const* settings);
+
+// Unpack a stored record; returns false if it is of another version.
+bool settings_decode(uint64_t record, settings_t* settings);
+
+// Initialise a writer; `record` and `playlist` are what is currently stored, or NULL if they are not.
+void settings_writer_init(settings_writer_t* writer, uint64_t const* record, playlist_t const* playlist);
+
+// Hand new settings to a writer.
+void settings_writer_request(settings_writer_t* writer, settings_t const* settings, int64_t now_us);
+
+// Get the time at which the writer wants to write, or `INT64_MAX` if it has nothing to write.
+int64_t settings_writer_due(settings_writer_t const* writer);
+
+// Check whether settings must be written now; if so, stores what to write in `out` and returns true.
+bool settings_writer_take(settings_writer_t* writer, int64_t now_us, settings_write_t* out);
+
+// Report the result of writing `written`, which took `write_us` microseconds; failed writes are retried later.
+void settings_writer_done(settings_writer_t* writer, settings_write_t const* written, bool ok, int64_t now_us,
+                          uint32_t write_us);
+
+// Load the settings from NVS namespace `nvs_namespace` and start the background writer.
+// Returns `ESP_ERR_NOT_FOUND` if no settings of this version are stored, in which case `settings` is left untouched
+// but for the playlist, which is loaded if a valid one is stored.
+esp_err_t settings_start(char const* nvs_namespace, settings_t* settings);
+
+// Hand new settings to the background writer; does not wait for them to be written.
+void settings_store(settings_t const* settings);
+
+// Get a copy of the writer's statistics.
+void settings_get_stats(settings_stats_t* stats);
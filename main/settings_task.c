@@ -0,0 +1,121 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "perf.h"
+#include "settings.h"
+
+static char const TAG[] = "settings";
+
+// NVS key of the settings record.
+#define SETTINGS_KEY "settings"
+// NVS key of the playlist.
+#define PLAYLIST_KEY "playlist"
+
+// Task that writes the settings.
+static TaskHandle_t      settings_task_handle;
+// NVS namespace the settings are stored in.
+static nvs_handle_t      nvs;
+// Protects `writer`.
+static portMUX_TYPE      lock = portMUX_INITIALIZER_UNLOCKED;
+// Decides when to write.
+static settings_writer_t writer;
+
+// Task that writes the settings once they have settled.
+static void settings_task(void* arg) {
+    while (1) {
+        int64_t          now = esp_timer_get_time();
+        settings_write_t out;
+        taskENTER_CRITICAL(&lock);
+        bool    write = settings_writer_take(&writer, now, &out);
+        int64_t due   = settings_writer_due(&writer);
+        taskEXIT_CRITICAL(&lock);
+
+        if (write) {
+            esp_err_t res = ESP_OK;
+            if (out.write_record) {
+                res = nvs_set_u64(nvs, SETTINGS_KEY, out.record);
+            }
+            if (res == ESP_OK && out.write_playlist) {
+                res = nvs_set_blob(nvs, PLAYLIST_KEY, &out.playlist, sizeof(playlist_t));
+            }
+            if (res == ESP_OK) {
+                PERF_START(commit_start);
+                res = nvs_commit(nvs);
+                PERF_END(PERF_NVS_COMMIT, commit_start);
+            }
+            int64_t done = esp_timer_get_time();
+            if (res != ESP_OK) {
+                ESP_LOGW(TAG, "Failed to store settings: %s", esp_err_to_name(res));
+            }
+            taskENTER_CRITICAL(&lock);
+            settings_writer_done(&writer, &out, res == ESP_OK, done, done - now);
+            taskEXIT_CRITICAL(&lock);
+            continue;
+        }
+
+        TickType_t wait = due == INT64_MAX ? portMAX_DELAY : pdMS_TO_TICKS((due - now) / 1000 + 1);
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+// Load the settings from NVS namespace `nvs_namespace` and start the background writer.
+// Returns `ESP_ERR_NOT_FOUND` if no settings of this version are stored, in which case `settings` is left untouched
+// but for the playlist, which is loaded if a valid one is stored.
+esp_err_t settings_start(char const* nvs_namespace, settings_t* settings) {
+    if (settings_task_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t res = nvs_open(nvs_namespace, NVS_READWRITE, &nvs);
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    // A playlist that is invalid, for example because it refers to an effect that was removed, counts as not stored.
+    playlist_t playlist;
+    size_t     playlist_size = sizeof(playlist);
+    res                      = nvs_get_blob(nvs, PLAYLIST_KEY, &playlist, &playlist_size);
+    bool playlist_found      = res == ESP_OK && playlist_size == sizeof(playlist) && playlist_valid(&playlist);
+    if (playlist_found) {
+        settings->playlist = playlist;
+    }
+
+    uint64_t   record;
+    settings_t stored = *settings;
+    res               = nvs_get_u64(nvs, SETTINGS_KEY, &record);
+    if (res == ESP_OK && settings_decode(record, &stored)) {
+        *settings = stored;
+    } else {
+        res = ESP_ERR_NOT_FOUND;
+    }
+    settings_writer_init(&writer, res == ESP_OK ? &record : NULL, playlist_found ? &playlist : NULL);
+
+    // Writing is never urgent, so this runs below everything else; the cache stall of a write can only be made rare.
+    if (xTaskCreate(settings_task, "settings", 3072, NULL, tskIDLE_PRIORITY + 1, &settings_task_handle) != pdPASS) {
+        nvs_close(nvs);
+        return ESP_ERR_NO_MEM;
+    }
+    return res;
+}
+
+// Hand new settings to the background writer; does not wait for them to be written.
+void settings_store(settings_t const* settings) {
+    if (!settings_task_handle) {
+        return;
+    }
+    taskENTER_CRITICAL(&lock);
+    settings_writer_request(&writer, settings, esp_timer_get_time());
+    taskEXIT_CRITICAL(&lock);
+    xTaskNotifyGive(settings_task_handle);
+}
+
+// Get a copy of the writer's statistics.
+void settings_get_stats(settings_stats_t* stats) {
+    taskENTER_CRITICAL(&lock);
+    *stats = writer.stats;
+    taskEXIT_CRITICAL(&lock);
+}
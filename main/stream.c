@@ -0,0 +1,484 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "stream.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Size of a DDP header, without and with a timecode.
+#define DDP_HEADER_SIZE          10
+#define DDP_TIMECODE_HEADER_SIZE 14
+// DDP header flags.
+#define DDP_FLAG_VERSION_MASK    0xC0
+#define DDP_FLAG_VERSION_1       0x40
+#define DDP_FLAG_TIMECODE        0x10
+#define DDP_FLAG_STORAGE         0x08
+#define DDP_FLAG_REPLY           0x04
+#define DDP_FLAG_QUERY           0x02
+#define DDP_FLAG_PUSH            0x01
+// DDP destination of the default output, and of all outputs.
+#define DDP_ID_DEFAULT           1
+#define DDP_ID_ALL               255
+// DDP sequence numbers count from 1 to 15; 0 means the sender does not number its packets.
+#define DDP_SEQUENCE_MODULO      15
+
+// Size of an E1.31 data packet header, up to and including the DMX start code.
+#define E131_HEADER_SIZE       126
+// E1.31 identifiers of the layers of a data packet.
+#define E131_ROOT_VECTOR       0x00000004
+#define E131_FRAMING_VECTOR    0x00000002
+#define E131_DMP_VECTOR        0x02
+#define E131_DMP_ADDRESS_TYPE  0xA1
+// E1.31 options.
+#define E131_OPTION_PREVIEW    0x80
+#define E131_OPTION_TERMINATED 0x40
+// E1.31 sequence numbers are 8 bits; one up to this far behind the last one is out of order rather than wrapped.
+#define E131_SEQUENCE_MODULO   256
+#define E131_SEQUENCE_WINDOW   20
+
+// Size of a frame in bytes.
+#define FRAME_SIZE   (LED_COUNT * sizeof(rgb_t))
+// Weight of a new sample in the smoothed frame interval, jitter and playout time, as a shift.
+#define SMOOTH_SHIFT 4
+
+// A frame in the jitter buffer.
+typedef struct {
+    // Colours of the LEDs.
+    rgb_t   pixels[LED_COUNT];
+    // Time at which the frame was complete, in microseconds.
+    int64_t arrival_us;
+    // Time at which the frame is to be shown, in microseconds.
+    int64_t play_us;
+} slot_t;
+
+// Sequence numbering of one protocol.
+typedef struct {
+    // Whether `last` is valid.
+    bool     valid;
+    // Sequence number of the last packet that was taken in.
+    uint32_t last;
+} sequence_t;
+
+// Where and how to receive the stream.
+static stream_config_t config;
+// Socket for DDP, or -1.
+static int             ddp_fd  = -1;
+// Socket for E1.31, or -1.
+static int             e131_fd = -1;
+// Stream statistics.
+static stream_stats_t  stats;
+
+// The jitter buffer.
+static slot_t        ring[STREAM_SLOTS];
+// Number of frames put into `ring`; only written by the receiver.
+static atomic_size_t ring_head;
+// Index of the frame that is shown, or will be shown first; only written by the render path.
+// The frames from here up to `ring_head` are in use.
+static atomic_size_t ring_tail;
+// Whether the sender said the stream ended; cleared by the next frame.
+static atomic_bool   terminated;
+
+// Whether part of a frame was received into the slot at `ring_head`.
+static bool       assembling;
+// Sequence numbering of DDP packets.
+static sequence_t ddp_sequence;
+// Sequence numbering of E1.31 packets.
+static sequence_t e131_sequence;
+// Time at which the last packet arrived, in microseconds.
+static int64_t    last_packet_us;
+// Time at which the last frame was complete, in microseconds.
+static int64_t    last_arrival_us;
+// Time at which the last frame is to be shown, in microseconds.
+static int64_t    last_play_us;
+// Smoothed time between frames, in microseconds, or 0 at the start of a stream.
+static int64_t    interval_us;
+// Smoothed variation of the time between frames, in microseconds.
+static int64_t    jitter_us;
+// Where the DMX channels before `config.start` are received to.
+static uint8_t    skipped_channels[STREAM_E131_CHANNELS];
+
+// Whether the frame at `ring_tail` was shown.
+static bool     tail_shown;
+// Whether the stream was shown in the last frame.
+static bool     live;
+// Sum of the time from arrival until shown over all shown frames, in microseconds.
+static uint64_t latency_sum_us;
+
+// Read a big-endian 16-bit number.
+static uint16_t read_be16(uint8_t const* data) {
+    return (data[0] << 8) | data[1];
+}
+
+// Read a big-endian 32-bit number.
+static uint32_t read_be32(uint8_t const* data) {
+    return ((uint32_t)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+// Open a UDP socket listening on `port`; returns -1 on failure.
+static int open_socket(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int                reuse = 1;
+    struct sockaddr_in addr  = {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Close the sockets.
+static void close_sockets() {
+    if (ddp_fd >= 0) {
+        close(ddp_fd);
+        ddp_fd = -1;
+    }
+    if (e131_fd >= 0) {
+        close(e131_fd);
+        e131_fd = -1;
+    }
+}
+
+// Open the sockets and reset the jitter buffer.
+esp_err_t stream_open(stream_config_t const* new_config) {
+    close_sockets();
+    config = *new_config;
+    if (config.start < 1 || config.start > STREAM_E131_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(&stats, 0, sizeof(stats));
+    atomic_store(&ring_head, 0);
+    atomic_store(&ring_tail, 0);
+    atomic_store(&terminated, false);
+    assembling     = false;
+    ddp_sequence   = (sequence_t){0};
+    e131_sequence  = (sequence_t){0};
+    interval_us    = 0;
+    jitter_us      = 0;
+    tail_shown     = false;
+    live           = false;
+    latency_sum_us = 0;
+
+    if (config.ddp_port && (ddp_fd = open_socket(config.ddp_port)) < 0) {
+        return ESP_FAIL;
+    }
+    if (config.e131_port) {
+        if ((e131_fd = open_socket(config.e131_port)) < 0) {
+            close_sockets();
+            return ESP_FAIL;
+        }
+        // Senders multicast every universe to its own group; unicast works without it, so failing to join is fine.
+        struct ip_mreq mreq = {
+            .imr_multiaddr.s_addr = htonl(0xEFFF0000 | config.universe),
+            .imr_interface.s_addr = htonl(INADDR_ANY),
+        };
+        setsockopt(e131_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+    }
+    return ESP_OK;
+}
+
+// Drop the datagram that is waiting on `fd`.
+static void discard(int fd) {
+    uint8_t byte;
+    recv(fd, &byte, sizeof(byte), 0);
+}
+
+// Receive the datagram that is waiting on `fd`, scattered over `iov`; whatever does not fit is dropped.
+static ssize_t receive_into(int fd, struct iovec* iov, size_t iov_len) {
+    struct msghdr msg = {
+        .msg_iov    = iov,
+        .msg_iovlen = iov_len,
+    };
+    return recvmsg(fd, &msg, 0);
+}
+
+// Count a packet that arrived at `now`, and forget the sequence numbers if the stream had stopped.
+static void packet_arrived(int64_t now) {
+    stats.packets++;
+    if (now - last_packet_us >= config.timeout_ms * 1000LL) {
+        ddp_sequence.valid  = false;
+        e131_sequence.valid = false;
+    }
+    last_packet_us = now;
+}
+
+// Check the sequence number of a packet and count the packets missing before it.
+// Returns false if the packet is a duplicate or arrived after a later one, and must be dropped.
+static bool check_sequence(sequence_t* seq, uint32_t number, uint32_t modulo, uint32_t window) {
+    if (seq->valid) {
+        uint32_t diff = (number + modulo - seq->last) % modulo;
+        if (diff == 0 || diff + window > modulo) {
+            stats.late++;
+            return false;
+        }
+        stats.lost += diff - 1;
+    }
+    seq->valid = true;
+    seq->last  = number;
+    return true;
+}
+
+// Get the slot to receive the next frame into, or NULL if the jitter buffer is full.
+// A new frame starts as a copy of the previous one, so packets that cover part of the LEDs leave the rest alone.
+static slot_t* begin_frame() {
+    size_t  head = atomic_load(&ring_head);
+    slot_t* slot = &ring[head % STREAM_SLOTS];
+    if (assembling) {
+        return slot;
+    }
+    if (head - atomic_load(&ring_tail) >= STREAM_SLOTS) {
+        return NULL;
+    }
+    if (head) {
+        memcpy(slot->pixels, ring[(head - 1) % STREAM_SLOTS].pixels, FRAME_SIZE);
+    } else {
+        memset(slot->pixels, 0, FRAME_SIZE);
+    }
+    assembling = true;
+    return slot;
+}
+
+// Pick the time to show a frame that arrived at `now`.
+// Frames are spaced by the smoothed time between frames, and pulled a little towards their arrival plus the jitter
+// delay so that the buffer follows the sender's clock. They are never shown before they arrive, nor held for more than
+// twice the jitter delay.
+static int64_t schedule(int64_t now) {
+    int64_t delay  = config.jitter_ms * 1000LL;
+    int64_t target = now + delay;
+    int64_t play   = target;
+    if (stats.frames && now - last_arrival_us < config.timeout_ms * 1000LL) {
+        int64_t gap = now - last_arrival_us;
+        if (interval_us) {
+            // Interarrival jitter, as RTP estimates it.
+            int64_t deviation  = gap > interval_us ? gap - interval_us : interval_us - gap;
+            jitter_us         += (deviation - jitter_us) >> SMOOTH_SHIFT;
+            interval_us       += (gap - interval_us) >> SMOOTH_SHIFT;
+        } else {
+            interval_us = gap;
+        }
+        play  = last_play_us + interval_us;
+        play += (target - play) >> SMOOTH_SHIFT;
+        if (play < now) {
+            play = now;
+        } else if (play > now + 2 * delay) {
+            play = now + 2 * delay;
+        }
+    } else {
+        interval_us = 0;
+    }
+    last_arrival_us   = now;
+    last_play_us      = play;
+    stats.interval_us = interval_us;
+    stats.jitter_us   = jitter_us;
+    return play;
+}
+
+// Put the frame from `begin_frame`, complete at `now`, into the jitter buffer.
+static void end_frame(int64_t now) {
+    size_t  head     = atomic_load(&ring_head);
+    slot_t* slot     = &ring[head % STREAM_SLOTS];
+    slot->arrival_us = now;
+    slot->play_us    = schedule(now);
+    assembling       = false;
+    stats.frames++;
+    atomic_store(&terminated, false);
+    atomic_store(&ring_head, head + 1);
+    if (config.wake) {
+        config.wake();
+    }
+}
+
+// Take in the DDP packet waiting on the DDP socket.
+static void receive_ddp(int64_t now) {
+    uint8_t header[DDP_TIMECODE_HEADER_SIZE];
+    ssize_t len = recv(ddp_fd, header, sizeof(header), MSG_PEEK);
+    if (len < 0) {
+        return;
+    }
+    packet_arrived(now);
+    size_t header_size = len && (header[0] & DDP_FLAG_TIMECODE) ? DDP_TIMECODE_HEADER_SIZE : DDP_HEADER_SIZE;
+    if (len < header_size || (header[0] & DDP_FLAG_VERSION_MASK) != DDP_FLAG_VERSION_1 ||
+        (header[0] & (DDP_FLAG_STORAGE | DDP_FLAG_REPLY | DDP_FLAG_QUERY)) ||
+        (header[3] != DDP_ID_DEFAULT && header[3] != DDP_ID_ALL)) {
+        stats.ignored++;
+        discard(ddp_fd);
+        return;
+    }
+    uint32_t sequence = header[1] & 0x0F;
+    if (sequence && !check_sequence(&ddp_sequence, sequence - 1, DDP_SEQUENCE_MODULO, 0)) {
+        discard(ddp_fd);
+        return;
+    }
+
+    // The pixels go straight from the socket into the frame, at the offset the packet is for.
+    uint32_t     offset  = read_be32(header + 4);
+    uint32_t     length  = read_be16(header + 8);
+    slot_t*      slot    = begin_frame();
+    struct iovec iov[2]  = {{.iov_base = header, .iov_len = header_size}};
+    size_t       iov_len = 1;
+    if (slot && offset < FRAME_SIZE) {
+        iov[iov_len++] = (struct iovec){
+            .iov_base = (uint8_t*)slot->pixels + offset,
+            .iov_len  = length < FRAME_SIZE - offset ? length : FRAME_SIZE - offset,
+        };
+    }
+    if (receive_into(ddp_fd, iov, iov_len) < 0 || !(header[0] & DDP_FLAG_PUSH)) {
+        return;
+    }
+    if (slot) {
+        end_frame(now);
+    } else {
+        stats.overflows++;
+    }
+}
+
+// Take in the E1.31 packet waiting on the E1.31 socket.
+static void receive_e131(int64_t now) {
+    static uint8_t const packet_id[12] = "ASC-E1.17\0\0";
+
+    uint8_t header[E131_HEADER_SIZE];
+    ssize_t len = recv(e131_fd, header, sizeof(header), MSG_PEEK);
+    if (len < 0) {
+        return;
+    }
+    packet_arrived(now);
+    if (len < E131_HEADER_SIZE || read_be16(header) != 0x0010 || memcmp(header + 4, packet_id, sizeof(packet_id)) ||
+        read_be32(header + 18) != E131_ROOT_VECTOR || read_be32(header + 40) != E131_FRAMING_VECTOR ||
+        header[117] != E131_DMP_VECTOR || header[118] != E131_DMP_ADDRESS_TYPE || header[125] != 0 ||
+        read_be16(header + 113) != config.universe || (header[112] & E131_OPTION_PREVIEW)) {
+        stats.ignored++;
+        discard(e131_fd);
+        return;
+    }
+    if (header[112] & E131_OPTION_TERMINATED) {
+        // The sender stopped; show the local effects after the frames it sent instead of after the timeout.
+        discard(e131_fd);
+        e131_sequence.valid = false;
+        atomic_store(&terminated, true);
+        return;
+    }
+    if (!check_sequence(&e131_sequence, header[111], E131_SEQUENCE_MODULO, E131_SEQUENCE_WINDOW)) {
+        discard(e131_fd);
+        return;
+    }
+
+    // The channels before the first LED are dropped and the pixels go straight from the socket into the frame.
+    uint32_t     skip     = config.start - 1;
+    uint32_t     channels = read_be16(header + 123) - 1;
+    slot_t*      slot     = begin_frame();
+    struct iovec iov[3]   = {
+        {.iov_base = header, .iov_len = E131_HEADER_SIZE},
+        {.iov_base = skipped_channels, .iov_len = skip},
+    };
+    size_t iov_len = 2;
+    if (slot && channels > skip) {
+        iov[iov_len++] = (struct iovec){
+            .iov_base = slot->pixels,
+            .iov_len  = channels - skip < FRAME_SIZE ? channels - skip : FRAME_SIZE,
+        };
+    }
+    if (receive_into(e131_fd, iov, iov_len) < 0) {
+        return;
+    }
+    if (slot) {
+        end_frame(now);
+    } else {
+        stats.overflows++;
+    }
+}
+
+// Wait up to `timeout_ms` for a packet and take it in; call this from the receiver task.
+// Returns ESP_ERR_TIMEOUT if nothing arrived.
+esp_err_t stream_receive(uint32_t timeout_ms) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    if (ddp_fd >= 0) {
+        FD_SET(ddp_fd, &fds);
+    }
+    if (e131_fd >= 0) {
+        FD_SET(e131_fd, &fds);
+    }
+    struct timeval timeout = {
+        .tv_sec  = timeout_ms / 1000,
+        .tv_usec = timeout_ms % 1000 * 1000,
+    };
+    int ready = select((ddp_fd > e131_fd ? ddp_fd : e131_fd) + 1, &fds, NULL, NULL, &timeout);
+    if (ready < 0) {
+        return ESP_FAIL;
+    } else if (!ready) {
+        return ESP_ERR_TIMEOUT;
+    }
+    int64_t now = config.clock();
+    if (ddp_fd >= 0 && FD_ISSET(ddp_fd, &fds)) {
+        receive_ddp(now);
+    }
+    if (e131_fd >= 0 && FD_ISSET(e131_fd, &fds)) {
+        receive_e131(now);
+    }
+    return ESP_OK;
+}
+
+// Render the newest frame that is due at `now` into `fb`.
+// Returns false, leaving `fb` alone, if there is no live stream and the local effects should be shown.
+bool stream_render(rgb_t* fb, int64_t now) {
+    size_t  head    = atomic_load(&ring_head);
+    size_t  tail    = atomic_load(&ring_tail);
+    int64_t timeout = config.timeout_ms * 1000LL;
+    if (head == tail || now - ring[(head - 1) % STREAM_SLOTS].arrival_us >= timeout) {
+        stats.fallbacks += live;
+        live             = false;
+        return false;
+    }
+
+    // Skip to the newest frame that is due; it stays in the buffer while it is shown.
+    while (tail + 1 != head && ring[(tail + 1) % STREAM_SLOTS].play_us <= now) {
+        stats.skipped += !tail_shown;
+        tail_shown     = false;
+        tail++;
+    }
+    atomic_store(&ring_tail, tail);
+
+    // A stream the sender ended is over once its last frame was shown.
+    if (atomic_load(&terminated) && tail + 1 == head && tail_shown) {
+        stats.fallbacks += live;
+        live             = false;
+        return false;
+    }
+
+    // A stream that starts (again) is shown from its first new frame that is due.
+    slot_t* slot = &ring[tail % STREAM_SLOTS];
+    if (!live && (tail_shown || slot->play_us > now || now - slot->arrival_us >= timeout)) {
+        return false;
+    }
+    memcpy(fb, slot->pixels, FRAME_SIZE);
+    if (!tail_shown) {
+        uint32_t latency_us  = now - slot->arrival_us;
+        tail_shown           = true;
+        latency_sum_us      += latency_us;
+        stats.shown++;
+        if (latency_us > stats.latency_max_us) {
+            stats.latency_max_us = latency_us;
+        }
+    }
+    live = true;
+    return true;
+}
+
+// Get a copy of the stream statistics.
+void stream_get_stats(stream_stats_t* out) {
+    *out                = stats;
+    out->latency_avg_us = stats.shown ? latency_sum_us / stats.shown : 0;
+}
@@ -0,0 +1,90 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Receiver for LED data streamed over UDP by a lighting controller, with DDP or E1.31 (sACN).
+// Pixel payloads are received straight into a small jitter buffer of timestamped frames, which plays them out at the
+// pace the sender sends them at, so network jitter does not show on the LEDs. The render task shows the stream while
+// frames keep arriving and falls back to the local effects when they stop.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "effects.h"
+#include "esp_err.h"
+
+// Number of frames the jitter buffer holds, including the one being shown.
+#define STREAM_SLOTS         16
+// Default UDP port of DDP.
+#define STREAM_DDP_PORT      4048
+// Default UDP port of E1.31.
+#define STREAM_E131_PORT     5568
+// Number of DMX channels in an E1.31 universe.
+#define STREAM_E131_CHANNELS 512
+
+// Where and how to receive the stream.
+typedef struct {
+    // UDP port to receive DDP on, or 0 to not receive DDP.
+    uint16_t ddp_port;
+    // UDP port to receive E1.31 on, or 0 to not receive E1.31.
+    uint16_t e131_port;
+    // E1.31 universe the LEDs are in.
+    uint16_t universe;
+    // DMX channel of the red channel of the first LED, from 1.
+    uint16_t start;
+    // Time frames are buffered to smooth out jitter, in milliseconds.
+    uint32_t jitter_ms;
+    // Time without frames after which the local effects take over again, in milliseconds.
+    uint32_t timeout_ms;
+    // Get the current time in microseconds.
+    int64_t (*clock)();
+    // Called by the receiver when a frame was added to the jitter buffer, or NULL.
+    void (*wake)();
+} stream_config_t;
+
+// Stream statistics.
+typedef struct {
+    // Number of packets received.
+    uint32_t packets;
+    // Number of packets that were not valid or not meant for this badge.
+    uint32_t ignored;
+    // Number of packets that went missing, going by the sequence numbers.
+    uint32_t lost;
+    // Number of packets that arrived out of order or twice, and were dropped.
+    uint32_t late;
+    // Number of complete frames put into the jitter buffer.
+    uint32_t frames;
+    // Number of frames dropped because the jitter buffer was full.
+    uint32_t overflows;
+    // Number of frames shown.
+    uint32_t shown;
+    // Number of frames that were replaced by a newer frame before they could be shown.
+    uint32_t skipped;
+    // Number of times the stream stopped and the local effects took over.
+    uint32_t fallbacks;
+    // Average time from the arrival of a frame until it was shown, in microseconds.
+    uint32_t latency_avg_us;
+    // Longest time from the arrival of a frame until it was shown, in microseconds.
+    uint32_t latency_max_us;
+    // Smoothed variation of the time between frames, in microseconds.
+    uint32_t jitter_us;
+    // Smoothed time between frames, in microseconds.
+    uint32_t interval_us;
+} stream_stats_t;
+
+// Open the sockets and reset the jitter buffer.
+esp_err_t stream_open(stream_config_t const* config);
+
+// Wait up to `timeout_ms` for a packet and take it in; call this from the receiver task.
+// Returns ESP_ERR_TIMEOUT if nothing arrived.
+esp_err_t stream_receive(uint32_t timeout_ms);
+
+// Render the newest frame that is due at `now` into `fb`.
+// Returns false, leaving `fb` alone, if there is no live stream and the local effects should be shown.
+bool stream_render(rgb_t* fb, int64_t now);
+
+// Get a copy of the stream statistics.
+void stream_get_stats(stream_stats_t* stats);
+
+// Start the receiver task, which connects to Wi-Fi first.
+esp_err_t stream_start();
@@ -0,0 +1,70 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "render.h"
+#include "sdkconfig.h"
+#include "stream.h"
+#include "wifi_connection.h"
+
+static char const TAG[] = "stream";
+
+// Time between attempts to connect to Wi-Fi, in milliseconds.
+#define CONNECT_RETRY_MS 5000
+
+// Task that receives the stream.
+static TaskHandle_t stream_task_handle;
+
+// Task that connects to Wi-Fi and then takes in packets as they arrive.
+static void stream_task(void* arg) {
+    while (!wifi_connection_is_connected() && wifi_connect_try_all() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to connect to Wi-Fi, trying again");
+        vTaskDelay(pdMS_TO_TICKS(CONNECT_RETRY_MS));
+    }
+    // Power save delays packets by up to a beacon interval, which is more than the jitter buffer covers.
+    esp_wifi_set_ps(WIFI_PS_NONE);
+
+    stream_config_t const config = {
+        .ddp_port   = CONFIG_STREAM_DDP_PORT,
+        .e131_port  = CONFIG_STREAM_E131_PORT,
+        .universe   = CONFIG_STREAM_E131_UNIVERSE,
+        .start      = CONFIG_STREAM_E131_START,
+        .jitter_ms  = CONFIG_STREAM_JITTER_MS,
+        .timeout_ms = CONFIG_STREAM_TIMEOUT_MS,
+        .clock      = esp_timer_get_time,
+        .wake       = render_wake,
+    };
+    esp_err_t res = stream_open(&config);
+    if (res != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open sockets: %s", esp_err_to_name(res));
+        stream_task_handle = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "Receiving DDP on port %d and E1.31 universe %d on port %d", CONFIG_STREAM_DDP_PORT,
+             CONFIG_STREAM_E131_UNIVERSE, CONFIG_STREAM_E131_PORT);
+    while (1) {
+        res = stream_receive(CONFIG_STREAM_TIMEOUT_MS);
+        if (res != ESP_OK && res != ESP_ERR_TIMEOUT) {
+            // The network went away; wait for it to come back instead of spinning.
+            vTaskDelay(pdMS_TO_TICKS(CONNECT_RETRY_MS));
+        }
+    }
+}
+
+// Start the receiver task, which connects to Wi-Fi first.
+esp_err_t stream_start() {
+    if (stream_task_handle) {
+        return ESP_OK;
+    }
+    // Packets only wait in the socket until they are taken in, so this runs above the render task.
+    if (xTaskCreate(stream_task, "stream", 4096, NULL, CONFIG_RENDER_TASK_PRIORITY + 1, &stream_task_handle) !=
+        pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,41 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+#include "timebase.h"
+
+// Denominator of the phase advance: microseconds per second times thousandths of a cycle.
+#define PHASE_DENOM 1000000000ULL
+
+// Start a phase clock at phase 0.
+void timebase_init(timebase_t* timebase, int64_t now_us, uint32_t speed) {
+    timebase->phase     = 0;
+    timebase->remainder = 0;
+    timebase->base_us   = now_us;
+    timebase->speed     = speed < TIMEBASE_MAX_SPEED ? speed : TIMEBASE_MAX_SPEED;
+}
+
+// Move the base of a phase clock forward to `now_us`, carrying the fraction of a phase unit.
+static void rebase(timebase_t* timebase, int64_t now_us) {
+    // An hour at `TIMEBASE_MAX_SPEED` is below 2^64: 2^32 us times 2^16 thousandths times 2^16 units per cycle.
+    uint64_t advance     = (uint64_t)(now_us - timebase->base_us) * timebase->speed * PHASE_ONE + timebase->remainder;
+    timebase->phase     += (phase_t)(advance / PHASE_DENOM);
+    timebase->remainder  = advance % PHASE_DENOM;
+    timebase->base_us    = now_us;
+}
+
+// Change the speed from `now_us` on, without changing the phase at that time; `now_us` must not be before the last call.
+void timebase_set_speed(timebase_t* timebase, int64_t now_us, uint32_t speed) {
+    timebase_phase(timebase, now_us);
+    rebase(timebase, now_us);
+    timebase->speed = speed < TIMEBASE_MAX_SPEED ? speed : TIMEBASE_MAX_SPEED;
+}
+
+// Get the phase at `now_us`, which must not be before the last call.
+phase_t timebase_phase(timebase_t* timebase, int64_t now_us) {
+    // Rebase in steps of at most an hour, so that even a long pause can't overflow the advance.
+    while (now_us - timebase->base_us >= TIMEBASE_REBASE_US) {
+        rebase(timebase, timebase->base_us + TIMEBASE_REBASE_US);
+    }
+    uint64_t advance = (uint64_t)(now_us - timebase->base_us) * timebase->speed * PHASE_ONE + timebase->remainder;
+    return timebase->phase + (phase_t)(advance / PHASE_DENOM);
+}
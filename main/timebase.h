@@ -0,0 +1,37 @@
+// SPDX-CopyRightText: 2025 Julian Scheffers
+// SPDX-License-Identifer: MIT
+
+// Animation phase as a function of time.
+// The phase is computed from the time since the last speed change instead of being accumulated frame by frame, so
+// it does not drift or lose precision however long the badge runs; the remainder of every rebase is carried exactly.
+
+#pragma once
+
+#include <stdint.h>
+#include "effects.h"
+
+// Longest time between two rebases, in microseconds; keeps the intermediate products within 64 bits.
+#define TIMEBASE_REBASE_US (3600LL * 1000000)
+// Highest speed, in thousandths of a cycle per second.
+#define TIMEBASE_MAX_SPEED 65535
+
+// Phase clock.
+typedef struct {
+    // Phase at `base_us`.
+    phase_t  phase;
+    // Fraction of a phase unit at `base_us`, in units of 1/1000000000.
+    uint32_t remainder;
+    // Time of the last rebase, in microseconds.
+    int64_t  base_us;
+    // Speed in thousandths of a cycle per second.
+    uint32_t speed;
+} timebase_t;
+
+// Start a phase clock at phase 0.
+void timebase_init(timebase_t* timebase, int64_t now_us, uint32_t speed);
+
+// Change the speed from `now_us` on, without changing the phase at that time; `now_us` must not be before the last call.
+void timebase_set_speed(timebase_t* timebase, int64_t now_us, uint32_t speed);
+
+// Get the phase at `now_us`, which must not be before the last call.
+phase_t timebase_phase(timebase_t* timebase, int64_t now_us);
@@ -1,24 +1,50 @@
 #include "wifi_ota.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <strings.h>
 #include <sys/socket.h>
+#include "delta.h"
 #include "esp_event.h"
 #include "esp_http_client.h"
-#include "esp_https_ota.h"
 #include "esp_log.h"
 #include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_random.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "lz.h"
+#include "manifest.h"
+#include "mbedtls/sha256.h"
 #include "nvs.h"
 #include "nvs_flash.h"
+#include "ota_stream.h"
 #include "string.h"
 #include "wifi_connection.h"
 
 #define HASH_LEN 32
 
+// Size of the buffer downloads are received in.
+#define OTA_BUFFER_SIZE 1024
+
+// NVS namespace the progress of downloads is stored in.
+#define OTA_NVS_NAMESPACE "ota"
+
 static const char* TAG = "OTA update";
 
+// Response headers that are needed to continue a download.
+typedef struct {
+    // Value of `Content-Range`, or empty.
+    char content_range[64];
+    // Value of `ETag`, or empty.
+    char etag[64];
+    // Value of `Last-Modified`, or empty.
+    char last_modified[64];
+} ota_headers_t;
+
 esp_err_t _http_event_handler(esp_http_client_event_t* evt) {
+    ota_headers_t* headers = evt->user_data;
     switch (evt->event_id) {
         case HTTP_EVENT_ERROR:
             ESP_LOGD(TAG, "HTTP_EVENT_ERROR");
@@ -31,6 +57,13 @@ esp_err_t _http_event_handler(esp_http_client_event_t* evt) {
             break;
         case HTTP_EVENT_ON_HEADER:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
+            if (headers && !strcasecmp(evt->header_key, "Content-Range")) {
+                snprintf(headers->content_range, sizeof(headers->content_range), "%s", evt->header_value);
+            } else if (headers && !strcasecmp(evt->header_key, "ETag")) {
+                snprintf(headers->etag, sizeof(headers->etag), "%s", evt->header_value);
+            } else if (headers && !strcasecmp(evt->header_key, "Last-Modified")) {
+                snprintf(headers->last_modified, sizeof(headers->last_modified), "%s", evt->header_value);
+            }
             break;
         case HTTP_EVENT_ON_DATA:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
@@ -53,37 +86,12 @@ esp_err_t _http_event_handler(esp_http_client_event_t* evt) {
     return ESP_OK;
 }
 
-static esp_err_t validate_image_header(esp_app_desc_t* new_app_info) {
-    if (new_app_info == NULL) {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    const esp_partition_t* running = esp_ota_get_running_partition();
-    esp_app_desc_t         running_app_info;
-    if (esp_ota_get_partition_description(running, &running_app_info) == ESP_OK) {
-        ESP_LOGI(TAG, "Running firmware version: %s, available firmware version: %s", running_app_info.version,
-                 new_app_info->version);
-        if (memcmp(new_app_info->version, running_app_info.version, sizeof(new_app_info->version)) == 0) {
-            ESP_LOGW(TAG, "Already up-to-date!");
-            return ESP_FAIL;
-        }
-    } else {
-        ESP_LOGW(TAG, "Unable to check current firmware version");
-    }
-
-    return ESP_OK;
-}
-
-static esp_err_t _http_client_init_cb(esp_http_client_handle_t http_client) {
+static esp_err_t _http_client_init_cb(esp_http_client_handle_t http_client, char const* running_version) {
     if (esp_http_client_set_header(http_client, "Badge-Type", "MCH2022") != ESP_OK) {
         ESP_LOGW(TAG, "Failed to add type header");
     }
-    const esp_partition_t* running = esp_ota_get_running_partition();
-    esp_app_desc_t         running_app_info;
-    if (esp_ota_get_partition_description(running, &running_app_info) == ESP_OK) {
-        if (esp_http_client_set_header(http_client, "Badge-Firmware", running_app_info.version) != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to add version header");
-        }
+    if (running_version[0] && esp_http_client_set_header(http_client, "Badge-Firmware", running_version) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to add version header");
     }
     return ESP_OK;
 }
@@ -113,13 +121,393 @@ static void get_sha256_of_partitions(void) {
     print_sha256(sha_256, "SHA-256 for current firmware: ");
 }*/
 
+// Where an update is installed on the badge.
+typedef struct {
+    // Partition patches apply to.
+    esp_partition_t const* running;
+    // Partition the new firmware is written to.
+    esp_partition_t const* update;
+    // Handle of the write to `update`, or 0 if none is in progress.
+    esp_ota_handle_t       handle;
+    // Hash of everything written to `update` since it was started.
+    mbedtls_sha256_context target_hash;
+    // Reports progress.
+    ota_status_cb_t        status_cb;
+} ota_target_t;
+
+// Read from the running firmware.
+static esp_err_t target_read_running(void* ctx, size_t offset, void* buf, size_t len) {
+    ota_target_t* target = ctx;
+    return esp_partition_read(target->running, offset, buf, len);
+}
+
+// Read from the update partition.
+static esp_err_t target_read_update(void* ctx, size_t offset, void* buf, size_t len) {
+    ota_target_t* target = ctx;
+    return esp_partition_read(target->update, offset, buf, len);
+}
+
+// Check that a patch was made against the running firmware.
+static esp_err_t target_check_source(void* ctx, delta_header_t const* header) {
+    ota_target_t* target = ctx;
+    if (header->source_size > target->running->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Hash the running firmware; a patch against anything else would produce garbage.
+    uint8_t* buf = malloc(OTA_BUFFER_SIZE);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    mbedtls_sha256_context hash;
+    mbedtls_sha256_init(&hash);
+    mbedtls_sha256_starts(&hash, 0);
+    esp_err_t res = ESP_OK;
+    for (uint32_t offset = 0; res == ESP_OK && offset < header->source_size; offset += OTA_BUFFER_SIZE) {
+        size_t len = header->source_size - offset < OTA_BUFFER_SIZE ? header->source_size - offset : OTA_BUFFER_SIZE;
+        res        = esp_partition_read(target->running, offset, buf, len);
+        mbedtls_sha256_update(&hash, buf, len);
+    }
+    uint8_t source_sha256[HASH_LEN];
+    mbedtls_sha256_finish(&hash, source_sha256);
+    mbedtls_sha256_free(&hash);
+    free(buf);
+    if (res != ESP_OK) {
+        return res;
+    }
+    if (memcmp(source_sha256, header->source_sha256, HASH_LEN)) {
+        ESP_LOGW(TAG, "Patch is for different firmware");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    return ESP_OK;
+}
+
+// Start writing `size` bytes of new firmware to the update partition, or as many as fit if `size` is 0, from
+// `offset` on.
+static esp_err_t target_begin(void* ctx, uint32_t size, uint32_t offset) {
+    ota_target_t* target = ctx;
+    if (size > target->update->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    mbedtls_sha256_free(&target->target_hash);
+    mbedtls_sha256_init(&target->target_hash);
+    mbedtls_sha256_starts(&target->target_hash, 0);
+    if (!offset) {
+        return esp_ota_begin(target->update, size ? size : OTA_SIZE_UNKNOWN, &target->handle);
+    }
+
+    // Hash what was written before, so that `target_end` checks the whole image and not just the rest.
+    uint8_t* buf = malloc(OTA_BUFFER_SIZE);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t res = ESP_OK;
+    for (uint32_t pos = 0; res == ESP_OK && pos < offset; pos += OTA_BUFFER_SIZE) {
+        size_t len = offset - pos < OTA_BUFFER_SIZE ? offset - pos : OTA_BUFFER_SIZE;
+        res        = esp_partition_read(target->update, pos, buf, len);
+        mbedtls_sha256_update(&target->target_hash, buf, len);
+    }
+    free(buf);
+    if (res != ESP_OK) {
+        return res;
+    }
+    // Only the sectors from `offset` on are erased, as they are written.
+    return esp_ota_resume(target->update, OTA_WITH_SEQUENTIAL_WRITES, offset, &target->handle);
+}
+
+// Write the next bytes of new firmware.
+static esp_err_t target_write(void* ctx, void const* data, size_t len) {
+    ota_target_t* target = ctx;
+    mbedtls_sha256_update(&target->target_hash, data, len);
+    return esp_ota_write(target->handle, data, len);
+}
+
+// Stop writing new firmware.
+static void target_abort(void* ctx) {
+    ota_target_t* target = ctx;
+    esp_ota_abort(target->handle);
+    target->handle = 0;
+}
+
+// Check the new firmware and boot it next.
+static esp_err_t target_end(void* ctx, uint8_t const* sha256) {
+    ota_target_t* target = ctx;
+    uint8_t       target_sha256[HASH_LEN];
+    mbedtls_sha256_finish(&target->target_hash, target_sha256);
+    if (sha256 && memcmp(target_sha256, sha256, HASH_LEN)) {
+        ESP_LOGE(TAG, "New firmware does not match");
+        target_abort(target);
+        return ESP_ERR_INVALID_CRC;
+    }
+    esp_err_t res  = esp_ota_end(target->handle);
+    target->handle = 0;
+    if (res == ESP_OK) {
+        res = esp_ota_set_boot_partition(target->update);
+    }
+    return res;
+}
+
+// Store the progress of a download in NVS, or erase it.
+static void target_save(void* ctx, ota_resume_t const* resume) {
+    nvs_handle_t nvs;
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    esp_err_t res = resume ? nvs_set_blob(nvs, "resume", resume, sizeof(ota_resume_t)) : nvs_erase_key(nvs, "resume");
+    if (res == ESP_OK) {
+        res = nvs_commit(nvs);
+    }
+    if (res != ESP_OK && res != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Failed to store download progress: %s", esp_err_to_name(res));
+    }
+    nvs_close(nvs);
+}
+
+// Load the progress of a download from NVS; returns false if there is none.
+static bool target_load(ota_resume_t* resume) {
+    nvs_handle_t nvs;
+    size_t       size = sizeof(ota_resume_t);
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return false;
+    }
+    bool found = nvs_get_blob(nvs, "resume", resume, &size) == ESP_OK && size == sizeof(ota_resume_t);
+    nvs_close(nvs);
+    return found;
+}
+
+// Report progress.
+static void target_progress(void* ctx, ota_stream_kind_t kind, int percent) {
+    ota_target_t* target = ctx;
+    char          buffer[128];
+    snprintf(buffer, sizeof(buffer), kind == OTA_STREAM_DELTA ? "Patching... %d%%" : "Updating... %d%%", percent);
+    target->status_cb(buffer, percent);
+}
+
+static ota_stream_io_t const target_io = {
+    .read_running = target_read_running,
+    .read_update  = target_read_update,
+    .check_source = target_check_source,
+    .begin        = target_begin,
+    .write        = target_write,
+    .abort        = target_abort,
+    .end          = target_end,
+    .save         = target_save,
+    .progress     = target_progress,
+};
+
+// Make one request for the rest of the download and install what it returns.
+static esp_err_t ota_request(esp_http_client_handle_t client, ota_stream_t* stream, ota_headers_t* headers,
+                             bool ask_delta, char* buf) {
+    // Once part of the download is installed, the same file must be asked for again.
+#if CONFIG_OTA_DELTA
+    if (ask_delta && !stream->resumed) {
+        esp_http_client_set_header(client, "Badge-Delta", DELTA_MAGIC);
+    } else {
+        esp_http_client_delete_header(client, "Badge-Delta");
+    }
+#endif
+#if CONFIG_OTA_COMPRESSED
+    if (!stream->resumed) {
+        esp_http_client_set_header(client, "Badge-Compression", LZ_MAGIC);
+    } else {
+        esp_http_client_delete_header(client, "Badge-Compression");
+    }
+#endif
+    char const* if_range;
+    uint32_t    offset = ota_stream_range(stream, &if_range);
+    if (offset) {
+        char range[32];
+        snprintf(range, sizeof(range), "bytes=%" PRIu32 "-", offset);
+        esp_http_client_set_header(client, "Range", range);
+        esp_http_client_set_header(client, "If-Range", if_range);
+    } else {
+        esp_http_client_delete_header(client, "Range");
+        esp_http_client_delete_header(client, "If-Range");
+    }
+    memset(headers, 0, sizeof(ota_headers_t));
+
+    esp_err_t res = esp_http_client_open(client, 0);
+    if (res != ESP_OK) {
+        return ESP_FAIL;
+    }
+    int64_t content_length = esp_http_client_fetch_headers(client);
+    if (content_length < 0) {
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+    res = ota_stream_response(stream, esp_http_client_get_status_code(client), content_length,
+                              headers->content_range[0] ? headers->content_range : NULL,
+                              headers->etag[0] ? headers->etag : NULL,
+                              headers->last_modified[0] ? headers->last_modified : NULL);
+    while (res == ESP_OK) {
+        int len = esp_http_client_read(client, buf, OTA_BUFFER_SIZE);
+        if (len < 0) {
+            res = ESP_FAIL;
+        } else if (len == 0) {
+            break;
+        } else {
+            res = ota_stream_feed(stream, buf, len);
+        }
+    }
+    if (res == ESP_OK && !esp_http_client_is_complete_data_received(client)) {
+        res = ESP_FAIL;
+    }
+    esp_http_client_close(client);
+    return res;
+}
+
+#if CONFIG_OTA_MANIFEST
+// Fetch the manifest and find what it offers on `channel`; the connection stays open for the download.
+static esp_err_t ota_check_manifest(esp_http_client_handle_t client, char const* channel, char const* running_version,
+                                    manifest_entry_t* entry) {
+    char* buf = malloc(MANIFEST_MAX_SIZE);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t res = esp_http_client_open(client, 0);
+    if (res == ESP_OK &&
+        (esp_http_client_fetch_headers(client) < 0 || esp_http_client_get_status_code(client) != 200)) {
+        res = ESP_ERR_NOT_FOUND;
+    }
+    int len = res == ESP_OK ? esp_http_client_read_response(client, buf, MANIFEST_MAX_SIZE) : -1;
+    if (res == ESP_OK && (len < 0 || !esp_http_client_is_complete_data_received(client))) {
+        res = ESP_ERR_INVALID_SIZE;
+    }
+    if (res == ESP_OK) {
+        res = manifest_find(buf, len, channel, running_version, entry);
+    } else {
+        esp_http_client_close(client);
+    }
+    free(buf);
+    return res;
+}
+#endif
+
+// Download an update and install it while it downloads, continuing where the last attempt stopped after the connection
+// is lost; with `ask_delta`, the server is asked for a patch. `expected` is what the manifest offers, or NULL.
+// Sets `up_to_date` and installs nothing if the server offers the running firmware.
+static esp_err_t ota_download(esp_http_client_handle_t client, ota_headers_t* headers, char const* url,
+                              char const* running_version, ota_status_cb_t status_cb, bool ask_delta,
+                              manifest_entry_t const* expected, bool* up_to_date) {
+    ota_target_t target = {
+        .running   = esp_ota_get_running_partition(),
+        .update    = esp_ota_get_next_update_partition(NULL),
+        .status_cb = status_cb,
+    };
+    char* buf = malloc(OTA_BUFFER_SIZE);
+    if (!buf || !target.update) {
+        free(buf);
+        return ESP_ERR_NO_MEM;
+    }
+    mbedtls_sha256_init(&target.target_hash);
+    esp_http_client_set_url(client, url);
+
+    ota_stream_t stream;
+    ota_resume_t resume;
+    ota_stream_init(&stream, &target_io, &target, url, running_version, target_load(&resume) ? &resume : NULL);
+    if (expected) {
+        ota_stream_expect(&stream, expected->size, expected->version, expected->sha256);
+    }
+    esp_err_t res = ESP_FAIL;
+    for (uint32_t attempt = 1; attempt <= OTA_MAX_ATTEMPTS; attempt++) {
+        if (attempt > 1) {
+            uint32_t delay_ms = ota_stream_backoff_ms(attempt - 1, esp_random());
+            ESP_LOGW(TAG, "Download failed (%s), retrying in %" PRIu32 " ms", esp_err_to_name(res), delay_ms);
+            status_cb("Connection lost, retrying...", stream.percent_shown < 0 ? 0 : stream.percent_shown);
+            vTaskDelay(pdMS_TO_TICKS(delay_ms));
+        }
+        res = ota_request(client, &stream, headers, ask_delta, buf);
+        if (res == ESP_OK) {
+            res = ota_stream_finish(&stream);
+        }
+        if (!ota_stream_retryable(res)) {
+            break;
+        }
+    }
+    if (res == ESP_OK) {
+        ESP_LOGI(TAG, "Installed %" PRIu32 " bytes from a %" PRIu32 " byte download", stream.written,
+                 stream.received);
+    }
+    ota_stream_close(&stream, res);
+    if (stream.current) {
+        *up_to_date = true;
+        res         = ESP_OK;
+    }
+    mbedtls_sha256_free(&target.target_hash);
+    free(buf);
+    return res;
+}
+
+// Check the manifest, if enabled, and download and install the update on `channel` on the same connection.
+// Sets `up_to_date` and installs nothing if the running firmware is the latest.
+static esp_err_t ota_install(char const* base_url, char const* channel, ota_status_cb_t status_cb, bool* up_to_date) {
+    esp_app_desc_t running_app_info = {0};
+    if (esp_ota_get_partition_description(esp_ota_get_running_partition(), &running_app_info) != ESP_OK) {
+        ESP_LOGW(TAG, "Unable to check current firmware version");
+    }
+    char url[256];
+    char manifest_url[256];
+    snprintf(url, sizeof(url), "%s%s.bin", base_url, channel);
+    snprintf(manifest_url, sizeof(manifest_url), "%s%s", base_url, MANIFEST_NAME);
+
+    ota_headers_t headers = {0};
+
+    esp_http_client_config_t config = {
+        .url                 = CONFIG_OTA_MANIFEST ? manifest_url : url,
+        .use_global_ca_store = true,
+        .event_handler       = _http_event_handler,
+        .user_data           = &headers,
+        .keep_alive_enable   = true,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) {
+        return ESP_ERR_NO_MEM;
+    }
+    _http_client_init_cb(client, running_app_info.version);
+
+    manifest_entry_t const* expected  = NULL;
+    bool                    ask_delta = CONFIG_OTA_DELTA;
+#if CONFIG_OTA_MANIFEST
+    status_cb("Checking for updates...", 0);
+    manifest_entry_t entry;
+    esp_err_t        manifest_res = ota_check_manifest(client, channel, running_app_info.version, &entry);
+    if (manifest_res == ESP_OK && manifest_is_current(&entry, running_app_info.version)) {
+        esp_http_client_cleanup(client);
+        *up_to_date = true;
+        return ESP_OK;
+    } else if (manifest_res == ESP_OK) {
+        ESP_LOGI(TAG, "Running firmware version: %s, available firmware version: %.32s%s", running_app_info.version,
+                 entry.version, entry.has_delta ? " (patch available)" : "");
+        expected  = &entry;
+        ask_delta = ask_delta && entry.has_delta;
+    } else {
+        ESP_LOGW(TAG, "No update manifest (%s), downloading anyway", esp_err_to_name(manifest_res));
+    }
+#endif
+
+    ESP_LOGI(TAG, "Attempting to download update from %s", url);
+    status_cb("Starting download...", 0);
+    esp_err_t res =
+        ota_download(client, &headers, url, running_app_info.version, status_cb, ask_delta, expected, up_to_date);
+#if CONFIG_OTA_DELTA
+    if (ask_delta && res == ESP_ERR_INVALID_VERSION) {
+        // The patch does not apply to this firmware; the whole image does.
+        ESP_LOGW(TAG, "Patch rejected, downloading the whole image");
+        res = ota_download(client, &headers, url, running_app_info.version, status_cb, false, expected, up_to_date);
+    }
+#endif
+    esp_http_client_cleanup(client);
+    return res;
+}
+
 static void default_ota_state_cb(const char* status_text, uint8_t progress) {
     ESP_LOGI(TAG, "OTA status changed [%u]: %s", progress, status_text);
 }
 
 extern bool wifi_stack_get_initialized(void);
 
-void ota_update(char* ota_url, ota_status_cb_t status_cb) {
+// Update to the latest firmware on `channel` from the server at `base_url`, and restart if it was installed.
+void ota_update(char const* base_url, char const* channel, ota_status_cb_t status_cb) {
     if (status_cb == NULL) {
         status_cb = default_ota_state_cb;
     }
@@ -145,103 +533,27 @@ void ota_update(char* ota_url, ota_status_cb_t status_cb) {
     esp_wifi_set_ps(WIFI_PS_NONE);  // Disable any WiFi power save mode
 
     ESP_LOGI(TAG, "Starting OTA update");
+    bool      up_to_date = false;
+    esp_err_t res        = ota_install(base_url, channel, status_cb, &up_to_date);
 
-    esp_http_client_config_t config = {
-        .url = ota_url, .use_global_ca_store = true, .event_handler = _http_event_handler, .keep_alive_enable = true};
-
-    esp_https_ota_config_t ota_config = {
-        .http_config = &config,
-        .http_client_init_cb =
-            _http_client_init_cb,  // Register a callback to be invoked after esp_http_client is initialized
-#ifdef CONFIG_EXAMPLE_ENABLE_PARTIAL_HTTP_DOWNLOAD
-        .partial_http_download = true,
-        .max_http_request_size = CONFIG_EXAMPLE_HTTP_REQUEST_SIZE,
-#endif
-    };
-
-    // config.skip_cert_common_name_check = true;
-
-    ESP_LOGI(TAG, "Attempting to download update from %s", config.url);
-
-    status_cb("Starting download...", 0);
-
-    esp_https_ota_handle_t https_ota_handle = NULL;
-    esp_err_t              err              = esp_https_ota_begin(&ota_config, &https_ota_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "ESP HTTPS OTA Begin failed");
-        status_cb("Failed to start download", 0);
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
-        return;
-    }
-
-    esp_app_desc_t app_desc;
-    err = esp_https_ota_get_img_desc(https_ota_handle, &app_desc);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "esp_https_ota_read_img_desc failed");
-        esp_https_ota_abort(https_ota_handle);
-        status_cb("Failed to read image desc", 0);
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
-        return;
-    }
-    err = validate_image_header(&app_desc);
-    if (err != ESP_OK) {
-        esp_https_ota_abort(https_ota_handle);
+    if (res == ESP_OK && up_to_date) {
         status_cb("Already up-to-date!", 100);
         vTaskDelay(2000 / portTICK_PERIOD_MS);
         return;
-    }
-
-    esp_err_t ota_finish_err = ESP_OK;
-    int       percent_shown  = -1;
-    while (1) {
-        err = esp_https_ota_perform(https_ota_handle);
-        if (err != ESP_ERR_HTTPS_OTA_IN_PROGRESS) {
-            break;
-        }
-
-        int len_total = esp_https_ota_get_image_size(https_ota_handle);
-        int len_read  = esp_https_ota_get_image_len_read(https_ota_handle);
-        int percent   = (len_read * 100) / len_total;
-
-        if (percent != percent_shown) {
-            ESP_LOGI(TAG, "Downloading %d / %d (%d%%)", len_read, len_total, percent);
-            percent_shown = percent;
-            char buffer[128];
-            snprintf(buffer, sizeof(buffer), "Updating... %d%%", percent);
-            status_cb(buffer, percent);
-        }
-    }
-
-    if (esp_https_ota_is_complete_data_received(https_ota_handle) != true) {
-        // the OTA image was not completely received and user can customise the response to this situation.
-        ESP_LOGE(TAG, "Complete data was not received.");
-        status_cb("Download failed", 0);
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
-        esp_restart();
+    } else if (res == ESP_OK) {
+        ESP_LOGI(TAG, "OTA upgrade successful. Rebooting ...");
+        status_cb("Update installed", 100);
+        vTaskDelay(1000 / portTICK_PERIOD_MS);
     } else {
-        ota_finish_err = esp_https_ota_finish(https_ota_handle);
-        if ((err == ESP_OK) && (ota_finish_err == ESP_OK)) {
-            ESP_LOGI(TAG, "ESP_HTTPS_OTA upgrade successful. Rebooting ...");
-            status_cb("Update installed", 0);
-            vTaskDelay(1000 / portTICK_PERIOD_MS);
-            esp_restart();
+        ESP_LOGE(TAG, "OTA upgrade failed: %s", esp_err_to_name(res));
+        if (res == ESP_ERR_OTA_VALIDATE_FAILED) {
+            status_cb("Image validation failed", 0);
+        } else if (ota_stream_retryable(res)) {
+            status_cb("Download failed", 0);
         } else {
-            if (ota_finish_err == ESP_ERR_OTA_VALIDATE_FAILED) {
-                ESP_LOGE(TAG, "Image validation failed, image is corrupted");
-                status_cb("Image validation failed", 0);
-            } else {
-                status_cb("Update failed", 0);
-            }
-            ESP_LOGE(TAG, "ESP_HTTPS_OTA upgrade failed 0x%x", ota_finish_err);
-            vTaskDelay(5000 / portTICK_PERIOD_MS);
-            esp_restart();
+            status_cb("Update failed", 0);
         }
+        vTaskDelay(5000 / portTICK_PERIOD_MS);
     }
-
-    esp_https_ota_abort(https_ota_handle);
     esp_restart();
-
-    while (1) {
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
-    }
 }
@@ -4,4 +4,5 @@
 
 typedef void (*ota_status_cb_t)(const char* status_text, uint8_t progress);
 
-void ota_update(char* ota_url, ota_status_cb_t status_cb);
+// Update to the latest firmware on `channel` from the server at `base_url`, and restart if it was installed.
+void ota_update(char const* base_url, char const* channel, ota_status_cb_t status_cb);
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# SPDX-CopyRightText: 2025 Julian Scheffers
+# SPDX-License-Identifer: MIT
+
+"""
+Stream LED frames to a badge with DDP or E1.31 (sACN), like a lighting controller does, for testing the stream
+receiver (CONFIG_STREAM_RECEIVER) or its host build, build/host/stream_recv.
+
+Frames show a rainbow that moves one LED per frame. --jitter delays every packet by a random time and --loss drops
+packets at random, to see how the receiver copes with a bad network; the first and last packets are always sent. At
+the end, the number of dropped packets and the last frame are printed, to compare with what the receiver saw.
+"""
+
+import argparse
+import colorsys
+import random
+import socket
+import struct
+import sys
+import time
+import uuid
+
+DDP_PORT = 4048
+E131_PORT = 5568
+
+# DDP header flags: version 1 and the push flag, which marks the last packet of a frame.
+DDP_FLAGS = 0x41
+# DDP data type of 8-bit RGB pixels.
+DDP_TYPE_RGB8 = 0x0B
+# DDP destination of the default output.
+DDP_ID_DEFAULT = 1
+
+# E1.31 option that tells receivers the stream ended.
+E131_OPTION_TERMINATED = 0x40
+
+
+def frame(index, leds):
+    """Get the pixels of a frame."""
+    pixels = bytearray()
+    for led in range(leds):
+        r, g, b = colorsys.hsv_to_rgb(((led + index) % leds) / leds, 1.0, 1.0)
+        pixels += bytes((round(r * 255), round(g * 255), round(b * 255)))
+    return bytes(pixels)
+
+
+def ddp_packet(sequence, pixels):
+    """Make a DDP packet with all pixels of a frame."""
+    return struct.pack(">BBBBIH", DDP_FLAGS, sequence % 15 + 1, DDP_TYPE_RGB8, DDP_ID_DEFAULT, 0, len(pixels)) + pixels
+
+
+def e131_packet(sequence, cid, universe, start, pixels, options=0):
+    """Make an E1.31 data packet with the pixels from DMX channel `start`."""
+    data = bytes(start - 1) + pixels
+    dmp = struct.pack(">HBBHHH", 0x7000 | (10 + len(data) + 1), 0x02, 0xA1, 0, 1, len(data) + 1) + b"\0" + data
+    framing = (
+        struct.pack(">HI", 0x7000 | (77 + len(dmp)), 0x00000002)
+        + b"ledsend".ljust(64, b"\0")
+        + struct.pack(">BHBBH", 100, 0, sequence % 256, options, universe)
+        + dmp
+    )
+    root = struct.pack(">HI", 0x7000 | (22 + len(framing)), 0x00000004) + cid + framing
+    return struct.pack(">HH", 0x0010, 0) + b"ASC-E1.17\0\0\0" + root
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host", help="address of the badge, or of the receiver")
+    parser.add_argument("-P", "--protocol", choices=("ddp", "e131"), default="ddp", help="protocol to send with")
+    parser.add_argument("-p", "--port", type=int, help=f"UDP port (default {DDP_PORT} for DDP, {E131_PORT} for E1.31)")
+    parser.add_argument("-u", "--universe", type=int, default=1, help="E1.31 universe")
+    parser.add_argument("-s", "--start", type=int, default=1, help="DMX channel of the first LED")
+    parser.add_argument("-l", "--leds", type=int, default=16, help="number of LEDs")
+    parser.add_argument("-f", "--fps", type=float, default=40, help="frames per second")
+    parser.add_argument("-d", "--duration", type=float, default=5, help="time to stream for, in seconds")
+    parser.add_argument("--jitter", type=float, default=0, help="largest random delay of a packet, in milliseconds")
+    parser.add_argument("--loss", type=float, default=0, help="chance that a packet is dropped, from 0 to 1")
+    parser.add_argument("--seed", type=int, help="seed for the jitter and the dropped packets")
+    parser.add_argument("--terminate", action="store_true", help="tell the receiver when an E1.31 stream ends")
+    args = parser.parse_args()
+    if not 1 <= args.start or args.start - 1 + 3 * args.leds > 512:
+        parser.error("the LEDs do not fit in a universe")
+
+    port = args.port or (DDP_PORT if args.protocol == "ddp" else E131_PORT)
+    cid = uuid.uuid4().bytes
+    rng = random.Random(args.seed)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
+    count = max(1, round(args.duration * args.fps))
+    # Packets keep their order, as they mostly do on a local network; the delays only bunch them up.
+    send_times = sorted(i / args.fps + rng.uniform(0, args.jitter / 1000) for i in range(count))
+    dropped = 0
+    pixels = b""
+    start = time.monotonic()
+    for i, send_time in enumerate(send_times):
+        pixels = frame(i, args.leds)
+        if 0 < i < count - 1 and rng.random() < args.loss:
+            dropped += 1
+            continue
+        wait = start + send_time - time.monotonic()
+        if wait > 0:
+            time.sleep(wait)
+        if args.protocol == "ddp":
+            packet = ddp_packet(i, pixels)
+        else:
+            packet = e131_packet(i, cid, args.universe, args.start, pixels)
+        sock.sendto(packet, (args.host, port))
+    if args.terminate and args.protocol == "e131":
+        packet = e131_packet(count, cid, args.universe, args.start, pixels, E131_OPTION_TERMINATED)
+        sock.sendto(packet, (args.host, port))
+
+    print(f"Sent {count - dropped} packets, dropped {dropped}")
+    print(f"Last frame: {pixels.hex()}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
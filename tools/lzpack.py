@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+# SPDX-CopyRightText: 2025 Julian Scheffers
+# SPDX-License-Identifer: MIT
+
+"""
+Compress firmware images and patches for compressed updates, or decompress them again with -d.
+
+The format is described in main/lz.h: LZSS with a window small enough for the badge to keep in memory while it
+writes the update. tools/ota_server.py serves <file>.lz instead of <file> to badges that ask for it. Only the
+Python standard library is needed.
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"BLZS"
+VERSION = 1
+HEADER = struct.Struct("<4sBBBxI")
+# Largest window the badge can decompress with, see LZ_WINDOW_BITS_MAX.
+WINDOW_BITS_MAX = 12
+# Largest length field the badge can decompress, see LZ_LENGTH_BITS_MAX.
+LENGTH_BITS_MAX = 8
+
+# Number of earlier positions with the same first bytes tried per position.
+CHAIN = 32
+
+
+def min_match(window_bits, length_bits):
+    """Get the shortest match that is smaller than the literals it replaces, see LZ_MIN_MATCH."""
+    return (1 + window_bits + length_bits) // 9 + 1
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.bits = 0
+        self.count = 0
+
+    def put(self, value, count):
+        self.bits = self.bits << count | value
+        self.count += count
+        while self.count >= 8:
+            self.count -= 8
+            self.out.append(self.bits >> self.count & 0xFF)
+        self.bits &= (1 << self.count) - 1
+
+    def finish(self):
+        if self.count:
+            self.out.append(self.bits << (8 - self.count) & 0xFF)
+        return bytes(self.out)
+
+
+def compress(data, window_bits, length_bits):
+    """Compress data; matches are found greedily, with one byte of lookahead."""
+    window = 1 << window_bits
+    shortest = min_match(window_bits, length_bits)
+    longest = shortest + (1 << length_bits) - 1
+    key_len = max(shortest, 3)
+    chains = {}
+    out = BitWriter()
+
+    def find(pos):
+        best_len, best_dist = 0, 0
+        limit = min(longest, len(data) - pos)
+        if limit < shortest:
+            return best_len, best_dist
+        for start in reversed(chains.get(data[pos : pos + key_len], ())):
+            dist = pos - start
+            if dist > window:
+                break
+            length = 0
+            while length < limit and data[start + length] == data[pos + length]:
+                length += 1
+            if length > best_len:
+                best_len, best_dist = length, dist
+                if length == limit:
+                    break
+        return best_len, best_dist
+
+    def index(pos):
+        chain = chains.setdefault(data[pos : pos + key_len], [])
+        chain.append(pos)
+        if len(chain) > CHAIN:
+            del chain[0]
+
+    pos = 0
+    while pos < len(data):
+        length, dist = find(pos)
+        if length >= shortest and pos + 1 < len(data):
+            # Emit a literal instead if the match at the next position is longer.
+            index(pos)
+            next_length, _ = find(pos + 1)
+            if next_length > length:
+                out.put(0x100 | data[pos], 9)
+                pos += 1
+                continue
+            end = pos + length
+            pos += 1
+        elif length >= shortest:
+            end = pos + length
+        else:
+            index(pos)
+            out.put(0x100 | data[pos], 9)
+            pos += 1
+            continue
+        out.put((dist - 1) << length_bits | (length - shortest), 1 + window_bits + length_bits)
+        while pos < end:
+            index(pos)
+            pos += 1
+    return HEADER.pack(MAGIC, VERSION, window_bits, length_bits, len(data)) + out.finish()
+
+
+def decompress(data):
+    magic, version, window_bits, length_bits, size = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not a compressed stream")
+    shortest = min_match(window_bits, length_bits)
+    bits = int.from_bytes(data[HEADER.size :], "big")
+    left = (len(data) - HEADER.size) * 8
+    out = bytearray()
+    while len(out) < size:
+        left -= 1
+        if bits >> left & 1:
+            left -= 8
+            out.append(bits >> left & 0xFF)
+        else:
+            left -= window_bits + length_bits
+            token = bits >> left
+            dist = (token >> length_bits & ((1 << window_bits) - 1)) + 1
+            for _ in range((token & ((1 << length_bits) - 1)) + shortest):
+                out.append(out[-dist])
+        if left < 0:
+            raise ValueError("compressed stream is cut off")
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="file to compress")
+    parser.add_argument("-o", "--out", help="file to write to (default: input with .lz appended)")
+    parser.add_argument("-d", "--decompress", action="store_true", help="decompress instead")
+    parser.add_argument("-w", "--window-bits", type=int, default=WINDOW_BITS_MAX, help="log2 of the window size")
+    parser.add_argument("-l", "--length-bits", type=int, default=4, help="number of bits of a match length")
+    args = parser.parse_args()
+    if not 1 <= args.window_bits <= WINDOW_BITS_MAX or not 1 <= args.length_bits <= LENGTH_BITS_MAX:
+        parser.error("window or length bits out of range")
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+    if args.decompress:
+        out = decompress(data)
+        path = args.out or (args.input[:-3] if args.input.endswith(".lz") else args.input + ".out")
+    else:
+        out = compress(data, args.window_bits, args.length_bits)
+        path = args.out or args.input + ".lz"
+    with open(path, "wb") as f:
+        f.write(out)
+    print(f"{path}: {len(out)} bytes from {len(data)} ({100 * len(out) / max(1, len(data)):.1f}%)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
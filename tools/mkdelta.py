@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+# SPDX-CopyRightText: 2025 Julian Scheffers
+# SPDX-License-Identifer: MIT
+
+"""
+Make a binary patch that turns one firmware image into another, for delta updates.
+
+The patch copies every run of the new image that can be found in the old image and inserts the rest; the
+format is described in main/delta.h. With --out-dir, the patch is named after the version of the old image,
+which is where tools/ota_server.py looks for it. Only the Python standard library is needed.
+"""
+
+import argparse
+import hashlib
+import os
+import struct
+import sys
+
+MAGIC = b"BDLT"
+VERSION = 1
+HEADER = struct.Struct("<4sB3xII32s32s")
+OP_END = 0x00
+OP_COPY = 0x01
+OP_INSERT = 0x02
+
+# Number of bytes hashed to find a match in the old image.
+BLOCK = 16
+# Distance between the offsets of the old image that are indexed.
+STRIDE = 4
+# Number of offsets of the old image kept per block.
+CANDIDATES = 4
+# Shortest match worth a copy; an insert split in two around a copy costs 14 bytes of operations.
+MIN_COPY = 24
+
+# Offset of the version in an ESP-IDF application image: image header, segment header and the start of esp_app_desc_t.
+APP_DESC_OFFSET = 24 + 8
+APP_DESC_MAGIC = 0xABCD5432
+APP_VERSION_OFFSET = APP_DESC_OFFSET + 16
+
+
+def app_version(image):
+    """Get the version of an ESP-IDF application image, or None if it is not one."""
+    if len(image) < APP_VERSION_OFFSET + 32:
+        return None
+    if struct.unpack_from("<I", image, APP_DESC_OFFSET)[0] != APP_DESC_MAGIC:
+        return None
+    return image[APP_VERSION_OFFSET : APP_VERSION_OFFSET + 32].split(b"\0")[0].decode("ascii", "replace")
+
+
+def index_source(source):
+    """Map every block of the old image at a multiple of STRIDE to the offsets it is found at."""
+    index = {}
+    for offset in range(0, len(source) - BLOCK + 1, STRIDE):
+        offsets = index.setdefault(source[offset : offset + BLOCK], [])
+        if len(offsets) < CANDIDATES:
+            offsets.append(offset)
+    return index
+
+
+def match_forward(source, src, target, dst):
+    """Get the number of equal bytes from source[src] and target[dst] on."""
+    length = 0
+    limit = min(len(source) - src, len(target) - dst)
+    # Compare in big steps first, then find the exact end.
+    step = 256
+    while step:
+        while length + step <= limit and source[src + length : src + length + step] == target[dst + length : dst + length + step]:
+            length += step
+        step //= 4
+    return length
+
+
+def diff(source, target):
+    """Yield ("copy", offset, length) and ("insert", start, end) operations that turn source into target."""
+    index = index_source(source)
+    literal = 0
+    pos = 0
+    while pos + BLOCK <= len(target):
+        best = None
+        for src in index.get(target[pos : pos + BLOCK], ()):
+            length = match_forward(source, src, target, pos)
+            # Extend backwards into the bytes that would otherwise be inserted.
+            back = 0
+            while pos - back > literal and src - back > 0 and source[src - back - 1] == target[pos - back - 1]:
+                back += 1
+            if not best or length + back > best[2]:
+                best = (src - back, pos - back, length + back)
+        if not best or best[2] < MIN_COPY:
+            pos += 1
+            continue
+        src, start, length = best
+        if start > literal:
+            yield ("insert", literal, start)
+        yield ("copy", src, length)
+        pos = literal = start + length
+    if literal < len(target):
+        yield ("insert", literal, len(target))
+
+
+def make_patch(source, target):
+    """Make a patch, and count the bytes copied and inserted."""
+    out = [
+        HEADER.pack(MAGIC, VERSION, len(source), len(target), hashlib.sha256(source).digest(), hashlib.sha256(target).digest())
+    ]
+    copied = inserted = 0
+    pending = None
+    for op in diff(source, target):
+        # Merge copies of adjacent ranges.
+        if op[0] == "copy" and pending and pending[1] + pending[2] == op[1]:
+            pending = ("copy", pending[1], pending[2] + op[2])
+            continue
+        if pending:
+            out.append(struct.pack("<BII", OP_COPY, pending[1], pending[2]))
+            copied += pending[2]
+            pending = None
+        if op[0] == "copy":
+            pending = op
+        else:
+            out.append(struct.pack("<BI", OP_INSERT, op[2] - op[1]))
+            out.append(target[op[1] : op[2]])
+            inserted += op[2] - op[1]
+    if pending:
+        out.append(struct.pack("<BII", OP_COPY, pending[1], pending[2]))
+        copied += pending[2]
+    out.append(bytes([OP_END]))
+    return b"".join(out), copied, inserted
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("old", help="firmware image the badge is running")
+    parser.add_argument("new", help="firmware image to update to")
+    out = parser.add_mutually_exclusive_group(required=True)
+    out.add_argument("-o", "--out", help="file to write the patch to")
+    out.add_argument("--out-dir", help="directory to write the patch to, named after the version of the old image")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        source = f.read()
+    with open(args.new, "rb") as f:
+        target = f.read()
+
+    path = args.out
+    if args.out_dir:
+        version = app_version(source)
+        if not version or "/" in version or version.startswith("."):
+            print(f"{args.old}: no usable application version; use --out", file=sys.stderr)
+            return 1
+        os.makedirs(args.out_dir, exist_ok=True)
+        path = os.path.join(args.out_dir, version)
+
+    patch, copied, inserted = make_patch(source, target)
+    with open(path, "wb") as f:
+        f.write(patch)
+    print(
+        f"{path}: {len(patch)} bytes for {len(target)} ({100 * len(patch) / max(1, len(target)):.1f}%), "
+        f"{copied} copied, {inserted} inserted"
+    )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
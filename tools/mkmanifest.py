@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+# SPDX-CopyRightText: 2025 Julian Scheffers
+# SPDX-License-Identifer: MIT
+
+"""
+Make the manifest of the firmware in a directory, which badges fetch before they download an update.
+
+Every <prefix><channel>.bin that is a firmware image is a channel; the manifest lists its version, size and
+SHA-256, and the versions in <prefix><channel>.bin.delta/ (see tools/mkdelta.py --out-dir) that there are patches
+from. The format is described in main/manifest.h. tools/ota_server.py makes one on the fly if the directory has none.
+Only the Python standard library is needed.
+"""
+
+import argparse
+import hashlib
+import os
+import struct
+import sys
+
+from mkdelta import app_version
+
+MAGIC = b"BMAN"
+VERSION = 1
+NAME = "manifest.bin"
+HEADER = struct.Struct("<4sBB2x")
+CHANNEL = struct.Struct("<16s32sI32sB3x")
+DELTA = struct.Struct("<32sI")
+
+
+def deltas(path):
+    """Get the versions there are patches from in a .delta directory, with the size of each patch."""
+    found = {}
+    if os.path.isdir(path):
+        for entry in sorted(os.listdir(path)):
+            version = entry[:-3] if entry.endswith(".lz") else entry
+            # The uncompressed patch is listed if there is one; it is what a badge without compression gets.
+            if version not in found or not entry.endswith(".lz"):
+                found[version] = os.path.getsize(os.path.join(path, entry))
+    return found
+
+
+def build(root, prefix=""):
+    """Make the manifest of the images in `root` whose names start with `prefix`."""
+    channels = []
+    for entry in sorted(os.listdir(root)):
+        if not entry.startswith(prefix) or not entry.endswith(".bin") or entry == prefix + NAME:
+            continue
+        name = entry[len(prefix) : -len(".bin")]
+        with open(os.path.join(root, entry), "rb") as f:
+            image = f.read()
+        version = app_version(image)
+        if not name or len(name) > 16 or version is None:
+            continue
+        patches = deltas(os.path.join(root, entry + ".delta"))
+        data = CHANNEL.pack(name.encode(), version.encode(), len(image), hashlib.sha256(image).digest(), len(patches))
+        for source, size in patches.items():
+            data += DELTA.pack(source.encode(), size)
+        channels.append(data)
+    if len(channels) > 255:
+        raise ValueError("too many channels")
+    return HEADER.pack(MAGIC, VERSION, len(channels)) + b"".join(channels)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("root", help="directory with the firmware images")
+    parser.add_argument("-p", "--prefix", default="", help="start of the image names, as in CONFIG_OTA_BASE_URL")
+    parser.add_argument("-o", "--out", help="file to write to (default: <root>/<prefix>" + NAME + ")")
+    args = parser.parse_args()
+
+    data = build(args.root, args.prefix)
+    path = args.out or os.path.join(args.root, args.prefix + NAME)
+    with open(path, "wb") as f:
+        f.write(data)
+    print(f"{path}: {data[5]} channels, {len(data)} bytes")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
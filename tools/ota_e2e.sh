@@ -0,0 +1,174 @@
+#!/usr/bin/env bash
+# SPDX-CopyRightText: 2025 Julian Scheffers
+# SPDX-License-Identifer: MIT
+
+# Tests delta, compressed and interrupted updates end to end on the host: makes an old and a new image, a patch between
+# them with mkdelta.py and compressed copies of both with lzpack.py, serves them with ota_server.py, downloads the
+# update with the headers the badge sends and applies or decompresses it with delta_apply and lz_bench. A badge running
+# a version there is no patch for must get the full image. The manifest must list what is served. Then ota_sim installs every kind of update from a server
+# that cuts connections, while the simulated badge also loses power now and then, also from servers that send no entity
+# tag or no validator at all.
+# Run with `make otae2e`.
+
+set -euo pipefail
+
+HOST_BUILD=${HOST_BUILD:-build/host}
+TOOLS=$(dirname "$0")
+WORK=$(mktemp -d)
+SERVER=
+CUT_SERVER=
+trap 'test -n "$SERVER" && kill "$SERVER"; test -n "$CUT_SERVER" && kill "$CUT_SERVER"; rm -rf "$WORK"' EXIT
+
+# An image with the application description where ESP-IDF puts it, and the new version of it: code moved around by
+# inserts and deletes, some constants changed and a new segment at the end. The code is made of a limited set of
+# instruction words so that it compresses somewhat, like real code does.
+python3 - "$WORK" <<'PY'
+import random, struct, sys
+rng = random.Random(2025)
+def image(version, body):
+    desc = struct.pack("<II8x32s32s16s16s32s32s", 0xABCD5432, 0, version, b"e2e", b"", b"", b"", rng.randbytes(32))
+    return b"\xe9" + bytes(23) + bytes(8) + desc.ljust(256, b"\0") + body
+words = [rng.getrandbits(32).to_bytes(4, "little") for _ in range(512)]
+body = bytearray(b"".join(words[min(rng.randrange(512), rng.randrange(512))] for _ in range(75000)))
+old = image(b"v1.0.0", bytes(body))
+for _ in range(40):
+    pos = rng.randrange(len(body))
+    kind = rng.randrange(3)
+    if kind == 0:
+        body[pos:pos] = b"".join(rng.choice(words) for _ in range(rng.randrange(1, 50)))
+    elif kind == 1:
+        del body[pos : pos + rng.randrange(1, 200)]
+    else:
+        body[pos] ^= 0x5A
+body += b"".join(rng.choice(words) for _ in range(1250))
+new = image(b"v1.1.0", bytes(body))
+open(sys.argv[1] + "/old.bin", "wb").write(old)
+open(sys.argv[1] + "/new.bin", "wb").write(new)
+PY
+
+mkdir "$WORK/www"
+cp "$WORK/new.bin" "$WORK/www/stable.bin"
+python3 "$TOOLS/mkdelta.py" "$WORK/old.bin" "$WORK/new.bin" --out-dir "$WORK/www/stable.bin.delta"
+cp "$WORK/new.bin" "$WORK/www/staging.bin"
+python3 "$TOOLS/lzpack.py" "$WORK/www/staging.bin"
+cp "$WORK/www/stable.bin.delta/v1.0.0" "$WORK/www/staging.bin.delta-v1.0.0"
+mkdir "$WORK/www/staging.bin.delta"
+python3 "$TOOLS/lzpack.py" "$WORK/www/staging.bin.delta-v1.0.0" -o "$WORK/www/staging.bin.delta/v1.0.0.lz"
+
+cp "$WORK/new.bin" "$WORK/www/beta.bin"
+python3 "$TOOLS/lzpack.py" "$WORK/www/beta.bin"
+
+# Start a server; its URL ends up in `$URL`.
+serve() {
+    python3 "$TOOLS/ota_server.py" -b 127.0.0.1 -p 0 "$@" "$WORK/www" > "$WORK/server.log" 2>&1 &
+    for _ in $(seq 50); do
+        grep -q Serving "$WORK/server.log" 2>/dev/null && break
+        sleep 0.1
+    done
+    URL=$(sed -n 's/^Serving .* on \(http:[^ ]*\)$/\1/p' "$WORK/server.log")
+}
+
+serve
+SERVER=$!
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+# A badge running the old version gets the patch.
+curl -sf -H "Badge-Delta: BDLT" -H "Badge-Firmware: v1.0.0" -o "$WORK/patch" "${URL}stable.bin"
+cmp -s "$WORK/patch" "$WORK/www/stable.bin.delta/v1.0.0" || fail "patch not served"
+for seed in 1 2 3; do
+    "$HOST_BUILD/delta_apply" -s $seed "$WORK/old.bin" "$WORK/patch" "$WORK/out.bin"
+    cmp "$WORK/out.bin" "$WORK/new.bin" || fail "patched image differs"
+done
+
+# The patch is refused for another old image.
+cp "$WORK/old.bin" "$WORK/other.bin"
+printf 'x' >> "$WORK/other.bin"
+"$HOST_BUILD/delta_apply" "$WORK/other.bin" "$WORK/patch" "$WORK/out.bin" 2>/dev/null && fail "wrong old image accepted"
+
+# A cut off patch is refused.
+head -c 1000 "$WORK/patch" > "$WORK/short"
+"$HOST_BUILD/delta_apply" "$WORK/old.bin" "$WORK/short" "$WORK/out.bin" 2>/dev/null && fail "short patch accepted"
+
+# Unknown versions and badges that do not ask for patches get the full image.
+curl -sf -H "Badge-Delta: BDLT" -H "Badge-Firmware: v0.9.0" -o "$WORK/full" "${URL}stable.bin"
+cmp "$WORK/full" "$WORK/new.bin" || fail "full image not served for an unknown version"
+curl -sf -H "Badge-Firmware: v1.0.0" -o "$WORK/full" "${URL}stable.bin"
+cmp "$WORK/full" "$WORK/new.bin" || fail "full image not served without Badge-Delta"
+
+# With compression, a badge running the old version gets the compressed patch, and others the compressed image.
+curl -sf -H "Badge-Delta: BDLT" -H "Badge-Compression: BLZS" -H "Badge-Firmware: v1.0.0" -o "$WORK/patch.lz" \
+    "${URL}staging.bin"
+cmp -s "$WORK/patch.lz" "$WORK/www/staging.bin.delta/v1.0.0.lz" || fail "compressed patch not served"
+"$HOST_BUILD/delta_apply" "$WORK/old.bin" "$WORK/patch.lz" "$WORK/out.bin"
+cmp "$WORK/out.bin" "$WORK/new.bin" || fail "image patched by a compressed patch differs"
+curl -sf -H "Badge-Delta: BDLT" -H "Badge-Compression: BLZS" -H "Badge-Firmware: v0.9.0" -o "$WORK/full.lz" \
+    "${URL}staging.bin"
+"$HOST_BUILD/lz_bench" -n 0 "$WORK/full.lz" "$WORK/new.bin" || fail "compressed image differs"
+curl -sf -H "Badge-Firmware: v1.0.0" -o "$WORK/full" "${URL}staging.bin"
+cmp "$WORK/full" "$WORK/new.bin" || fail "full image not served without Badge-Compression"
+
+# Ranges continue where a download stopped, unless the file changed.
+ETAG=$(curl -sf -D - -o /dev/null "${URL}stable.bin" | tr -d '\r' | sed -n 's/^ETag: //p')
+curl -sf -H "Range: bytes=1000-" -H "If-Range: $ETAG" -o "$WORK/rest" "${URL}stable.bin"
+cmp "$WORK/rest" <(tail -c +1001 "$WORK/new.bin") || fail "range not served"
+curl -sf -H "Range: bytes=1000-" -H 'If-Range: "changed"' -o "$WORK/full" "${URL}stable.bin"
+cmp "$WORK/full" "$WORK/new.bin" || fail "full image not served for a stale If-Range"
+
+# The manifest lists every channel, and the patch for the old version.
+python3 "$TOOLS/mkmanifest.py" "$WORK/www" -o "$WORK/manifest.bin"
+curl -sf -o "$WORK/served.bin" "${URL}manifest.bin"
+cmp "$WORK/served.bin" "$WORK/manifest.bin" || fail "manifest not served"
+
+# With the manifest, a badge that is up to date downloads nothing else, and one that is not downloads the update on the
+# connection it fetched the manifest on.
+OUT=$("$HOST_BUILD/ota_sim" -m "${URL}stable.bin" "$WORK/new.bin" "$WORK/new.bin") && STATUS=0 || STATUS=$?
+test $STATUS -eq 2 || fail "manifest did not report the running version as current"
+grep -q "after 1 boots and 1 requests (0 ranged) on 1 connections" <<< "$OUT" || fail "more than the manifest fetched"
+OUT=$("$HOST_BUILD/ota_sim" -m "${URL}stable.bin" "$WORK/old.bin" "$WORK/new.bin") || fail "update after the manifest"
+grep -q "2 requests (0 ranged) on 1 connections, 7[0-9]* bytes" <<< "$OUT" || fail "patch not fetched on the same connection"
+OUT=$("$HOST_BUILD/ota_sim" -m "${URL}beta.bin" "$WORK/old.bin" "$WORK/new.bin") || fail "compressed image after manifest"
+grep -q "on 1 connections" <<< "$OUT" || fail "image not fetched on the same connection"
+
+# Interrupted downloads of each kind of update, with power losses in between.
+serve --cut 0.5 --seed 1
+CUT_SERVER=$!
+"$HOST_BUILD/ota_sim" -p -r 30 "${URL}stable.bin" "$WORK/old.bin" "$WORK/new.bin" || fail "plain image"
+"$HOST_BUILD/ota_sim" -r 30 "${URL}stable.bin" "$WORK/old.bin" "$WORK/new.bin" || fail "patch"
+"$HOST_BUILD/ota_sim" -r 30 "${URL}staging.bin" "$WORK/old.bin" "$WORK/new.bin" || fail "compressed patch"
+"$HOST_BUILD/ota_sim" -r 30 "${URL}beta.bin" "$WORK/old.bin" "$WORK/new.bin" || fail "compressed image"
+"$HOST_BUILD/ota_sim" -m -p -r 30 "${URL}stable.bin" "$WORK/old.bin" "$WORK/new.bin" || fail "plain image after manifest"
+# A plain image continued after a power loss is checked against the manifest as a whole.
+OUT=$("$HOST_BUILD/ota_sim" -m -p -r 100 -s 1 "${URL}stable.bin" "$WORK/old.bin" "$WORK/new.bin" 2>&1) ||
+    fail "plain image continued after manifest"
+grep -q "Continuing the download" <<< "$OUT" || fail "plain image after manifest not continued"
+"$HOST_BUILD/ota_sim" -p "${URL}stable.bin" "$WORK/new.bin" "$WORK/new.bin" >/dev/null 2>&1 && STATUS=0 || STATUS=$?
+test $STATUS -eq 2 || fail "running version not reported as current"
+
+# Without an entity tag, downloads continue guarded by the date of the last change, and without either they start over.
+kill "$CUT_SERVER"
+serve --cut 0.5 --seed 1 --validator date
+CUT_SERVER=$!
+OUT=$("$HOST_BUILD/ota_sim" -p -r 30 "${URL}stable.bin" "$WORK/old.bin" "$WORK/new.bin") || fail "plain image by date"
+grep -q "([1-9][0-9]* ranged)" <<< "$OUT" || fail "download not continued with the date"
+"$HOST_BUILD/ota_sim" -r 30 "${URL}staging.bin" "$WORK/old.bin" "$WORK/new.bin" || fail "compressed patch by date"
+kill "$CUT_SERVER"
+serve --cut 0.5 --seed 1 --validator none
+CUT_SERVER=$!
+OUT=$("$HOST_BUILD/ota_sim" -p -r 30 "${URL}stable.bin" "$WORK/old.bin" "$WORK/new.bin" 2>&1) ||
+    fail "plain image without validator"
+grep -q "(0 ranged)" <<< "$OUT" || fail "download continued without a validator"
+
+# Without a Content-Length, plain images are installed without knowing their size up front, or with the size in the
+# manifest.
+kill "$CUT_SERVER"
+serve --no-length
+CUT_SERVER=$!
+"$HOST_BUILD/ota_sim" -p "${URL}stable.bin" "$WORK/old.bin" "$WORK/new.bin" || fail "plain image without length"
+"$HOST_BUILD/ota_sim" -m -p "${URL}stable.bin" "$WORK/old.bin" "$WORK/new.bin" ||
+    fail "plain image without length after manifest"
+
+echo "OK"
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# SPDX-CopyRightText: 2025 Julian Scheffers
+# SPDX-License-Identifer: MIT
+
+"""
+Serve firmware updates from a directory, like the update server does, for testing updates locally.
+
+GET /<name> returns the image <root>/<name>. A badge that can apply patches sends a Badge-Delta header along with
+the version it runs in Badge-Firmware; if <root>/<name>.delta/<version> exists (see tools/mkdelta.py --out-dir),
+that patch is returned instead. A badge that can decompress sends a Badge-Compression header, and gets the
+compressed file (see tools/lzpack.py) with .lz appended instead if there is one. Point CONFIG_OTA_BASE_URL at
+http://<this machine>:<port>/ to use it.
+
+GET /manifest.bin returns the manifest badges check before they download anything (see tools/mkmanifest.py); it
+is made from the directory if there is no such file. Connections are kept open between requests, so the download
+can follow the manifest on the same connection.
+
+Interrupted downloads continue with Range requests, guarded by If-Range with the entity tag. To test that, --cut
+makes the server drop connections at random points. --validator makes the server send the date of the last change
+instead of an entity tag, or neither; badges start those downloads over rather than continue them unguarded.
+--no-length leaves out Content-Length and ends every response by closing the connection, so that badges get no size
+up front, as with chunked transfer.
+"""
+
+import argparse
+import email.utils
+import hashlib
+import http.server
+import os
+import random
+import re
+import socket
+import sys
+
+import mkmanifest
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    # Keeps connections open.
+    protocol_version = "HTTP/1.1"
+    root = "."
+    # Chance that a response is cut off.
+    cut = 0.0
+    rng = random.Random()
+    # What is sent to check that a file did not change: "etag", "date" or "none".
+    validator = "etag"
+    # Whether Content-Length is left out.
+    no_length = False
+
+    def find(self):
+        """Get the path and content type to answer the request with, or None."""
+        name = self.path.split("?")[0].lstrip("/")
+        if not name or "/" in name or name.startswith("."):
+            return None
+        candidates = []
+        version = self.headers.get("Badge-Firmware", "")
+        if self.headers.get("Badge-Delta") and version and "/" not in version and not version.startswith("."):
+            candidates.append((os.path.join(self.root, name + ".delta", version), "application/x-badge-delta"))
+        candidates.append((os.path.join(self.root, name), "application/octet-stream"))
+        for path, content_type in candidates:
+            if self.headers.get("Badge-Compression") and os.path.isfile(path + ".lz"):
+                return path + ".lz", "application/x-badge-compressed"
+            if os.path.isfile(path):
+                return path, content_type
+        return None
+
+    def do_GET(self):
+        found = self.find()
+        if found:
+            path, content_type = found
+            with open(path, "rb") as f:
+                data = f.read()
+        elif self.path.split("?")[0] == "/" + mkmanifest.NAME:
+            data, content_type = mkmanifest.build(self.root), "application/x-badge-manifest"
+        else:
+            self.send_error(404)
+            return
+        validator = None
+        if self.validator == "etag":
+            validator = '"' + hashlib.sha256(data).hexdigest()[:16] + '"'
+        elif self.validator == "date":
+            validator = email.utils.formatdate(os.path.getmtime(path) if found else 0, usegmt=True)
+
+        start, end = 0, len(data)
+        ranged = re.fullmatch(r"bytes=(\d+)-(\d*)", self.headers.get("Range", ""))
+        if ranged and self.headers.get("If-Range", validator) == validator:
+            start = int(ranged.group(1))
+            end = min(len(data), int(ranged.group(2)) + 1) if ranged.group(2) else len(data)
+            if start >= end:
+                self.send_response(416)
+                self.send_header("Content-Range", f"bytes */{len(data)}")
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                return
+            self.send_response(206)
+            self.send_header("Content-Range", f"bytes {start}-{end - 1}/{len(data)}")
+        else:
+            self.send_response(200)
+        self.send_header("Content-Type", content_type)
+        if self.no_length:
+            self.send_header("Connection", "close")
+            self.close_connection = True
+        else:
+            self.send_header("Content-Length", str(end - start))
+        self.send_header("Accept-Ranges", "bytes")
+        if self.validator == "etag":
+            self.send_header("ETag", validator)
+        elif self.validator == "date":
+            self.send_header("Last-Modified", validator)
+        self.end_headers()
+
+        if self.rng.random() < self.cut:
+            # Send part of the body and drop the connection, like a network that goes away.
+            self.wfile.write(data[start : self.rng.randrange(start, end)])
+            self.wfile.flush()
+            self.connection.shutdown(socket.SHUT_RDWR)
+            self.close_connection = True
+            return
+        self.wfile.write(data[start:end])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("root", help="directory with the firmware images")
+    parser.add_argument("-b", "--bind", default="0.0.0.0", help="address to listen on")
+    parser.add_argument("-p", "--port", type=int, default=8070, help="port to listen on")
+    parser.add_argument("--cut", type=float, default=0.0, help="chance that a response is cut off, from 0 to 1")
+    parser.add_argument("--seed", type=int, help="seed for where responses are cut off")
+    parser.add_argument(
+        "--validator", choices=["etag", "date", "none"], default="etag", help="what is sent to guard range requests"
+    )
+    parser.add_argument("--no-length", action="store_true", help="send no Content-Length and close every connection")
+    args = parser.parse_args()
+
+    Handler.root = args.root
+    Handler.cut = args.cut
+    Handler.rng = random.Random(args.seed)
+    Handler.validator = args.validator
+    Handler.no_length = args.no_length
+    server = http.server.ThreadingHTTPServer((args.bind, args.port), Handler)
+    print(f"Serving {args.root} on http://{args.bind}:{server.server_port}/", flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+# SPDX-CopyRightText: 2025 Julian Scheffers
+# SPDX-License-Identifer: MIT
+
+"""
+Turn a trace of the performance counters (CONFIG_PERF_COUNTERS) into a timeline.
+
+The input is either a binary trace, as build/host/perf_sim -o writes it, or a serial log in which `perf trace` was run
+on the badge; the last trace in the log is used. The timeline is written in the Chrome trace event format, which
+https://ui.perfetto.dev and chrome://tracing show with a row per stage. A summary of every stage is printed.
+
+Every core has its own cycle counter, so the rows of different cores may be shifted against each other. The counter
+wraps around every 2^32 cycles (18 seconds at 240 MHz); events further apart than that are placed too close together.
+"""
+
+import argparse
+import base64
+import json
+import struct
+import sys
+
+MAGIC = b"BPRF"
+VERSION = 1
+HEADER = struct.Struct("<4sBBHII")
+EVENT = struct.Struct("<IIBBH")
+STAGES = ["render", "output", "led_write", "input_wait", "nvs_commit"]
+
+
+def extract(data):
+    """Get the binary trace out of a serial log, or return binary data as it is."""
+    if data.startswith(MAGIC):
+        return data
+    lines = data.decode("utf-8", "replace").splitlines()
+    begin = max((i for i, line in enumerate(lines) if line.strip().endswith("PERF TRACE BEGIN")), default=None)
+    if begin is None:
+        raise ValueError("no trace found")
+    encoded = []
+    for line in lines[begin + 1 :]:
+        if line.strip().endswith("PERF TRACE END"):
+            return base64.b64decode("".join(encoded))
+        encoded.append(line.strip())
+    raise ValueError("trace is cut off")
+
+
+def parse(trace):
+    """Get the cycles per microsecond and the events of a binary trace, with the start unwrapped into 64 bits."""
+    if len(trace) < HEADER.size:
+        raise ValueError("trace is cut off")
+    magic, version, stages, _, cycles_per_us, count = HEADER.unpack_from(trace)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not a trace of a known version")
+    if len(trace) < HEADER.size + count * EVENT.size:
+        raise ValueError("trace is cut off")
+    events = []
+    last = {}
+    for i in range(count):
+        start, cycles, stage, core, _ = EVENT.unpack_from(trace, HEADER.size + i * EVENT.size)
+        # Unwrap the cycle counter of each core, assuming events are less than 2^31 cycles apart.
+        if core in last:
+            prev = last[core]
+            start = prev + ((start - prev) & 0xFFFFFFFF)
+            if start - prev >= 1 << 31:
+                start -= 1 << 32
+        last[core] = start
+        name = STAGES[stage] if stage < len(STAGES) else f"stage {stage}"
+        events.append({"start": start, "cycles": cycles, "stage": name, "core": core})
+    return cycles_per_us, events
+
+
+def chrome_trace(cycles_per_us, events):
+    """Make a timeline in the Chrome trace event format."""
+    origin = {}
+    for event in events:
+        origin[event["core"]] = min(origin.get(event["core"], event["start"]), event["start"])
+    timeline = []
+    for event in events:
+        timeline.append(
+            {
+                "name": event["stage"],
+                "ph": "X",
+                "pid": event["core"],
+                "tid": event["stage"],
+                "ts": (event["start"] - origin[event["core"]]) / cycles_per_us,
+                "dur": event["cycles"] / cycles_per_us,
+            }
+        )
+    for core in origin:
+        timeline.append({"name": "process_name", "ph": "M", "pid": core, "args": {"name": f"core {core}"}})
+    return {"traceEvents": timeline, "displayTimeUnit": "ns"}
+
+
+def summary(cycles_per_us, events):
+    """Print the number of events and the average and longest time of each stage."""
+    print(f"{'stage':<12} {'events':>8} {'avg us':>10} {'max us':>10}")
+    for stage in STAGES:
+        cycles = [event["cycles"] for event in events if event["stage"] == stage]
+        if cycles:
+            avg = sum(cycles) / len(cycles) / cycles_per_us
+            print(f"{stage:<12} {len(cycles):>8} {avg:>10.1f} {max(cycles) / cycles_per_us:>10.1f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="binary trace or serial log, or - for standard input")
+    parser.add_argument("-o", "--out", help="write the timeline as JSON to this file")
+    args = parser.parse_args()
+
+    if args.input == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.input, "rb") as f:
+            data = f.read()
+    try:
+        cycles_per_us, events = parse(extract(data))
+    except ValueError as e:
+        print(f"{args.input}: {e}", file=sys.stderr)
+        return 1
+
+    summary(cycles_per_us, events)
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(chrome_trace(cycles_per_us, events), f)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
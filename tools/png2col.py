@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+# SPDX-CopyRightText: 2025 Julian Scheffers
+# SPDX-License-Identifer: MIT
+
+"""
+Convert PNG images into pre-rasterised column images (.col) for the LED firmware.
+
+Images are scaled to the LED count in height, stored column by column and, when they have few enough
+colours, as palette indices. Every colour is kept unless --colors is given, which quantises the images
+to a smaller palette with median cut: smaller files, at the cost of colours that shift and gradients
+that band. Files that are not PNG images are copied as-is. The layout is described in main/image.h;
+only the Python standard library is needed.
+"""
+
+import argparse
+import os
+import shutil
+import struct
+import sys
+import zlib
+
+MAGIC = b"LCOL"
+VERSION = 1
+FORMAT_RGB = 0
+FORMAT_PAL8 = 1
+FORMAT_PAL4 = 2
+HEADER = struct.Struct("<4sBBHHHHH")
+
+
+def read_png(path):
+    """Decode a non-interlaced PNG into (width, height, rows of (r, g, b, a) tuples)."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise ValueError(f"{path}: not a PNG file")
+
+    pos = 8
+    idat = b""
+    palette = []
+    trns = b""
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos : pos + 8])
+        body = data[pos + 8 : pos + 8 + length]
+        pos += 12 + length
+        if kind == b"IHDR":
+            width, height, depth, color, _, _, interlace = struct.unpack(">IIBBBBB", body)
+        elif kind == b"PLTE":
+            palette = [tuple(body[i : i + 3]) for i in range(0, len(body), 3)]
+        elif kind == b"tRNS":
+            trns = body
+        elif kind == b"IDAT":
+            idat += body
+        elif kind == b"IEND":
+            break
+
+    if interlace:
+        raise ValueError(f"{path}: interlaced PNG files are not supported")
+    if depth == 16:
+        raise ValueError(f"{path}: 16-bit PNG files are not supported")
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color]
+    bits = channels * depth
+    stride = (width * bits + 7) // 8
+    bpp = max(1, bits // 8)
+
+    raw = zlib.decompress(idat)
+    prev = bytearray(stride)
+    rows = []
+    for y in range(height):
+        filt = raw[y * (stride + 1)]
+        line = bytearray(raw[y * (stride + 1) + 1 : (y + 1) * (stride + 1)])
+        for x in range(stride):
+            a = line[x - bpp] if x >= bpp else 0
+            b = prev[x]
+            c = prev[x - bpp] if x >= bpp else 0
+            if filt == 1:
+                line[x] = (line[x] + a) & 0xFF
+            elif filt == 2:
+                line[x] = (line[x] + b) & 0xFF
+            elif filt == 3:
+                line[x] = (line[x] + (a + b) // 2) & 0xFF
+            elif filt == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                pred = a if pa <= pb and pa <= pc else b if pb <= pc else c
+                line[x] = (line[x] + pred) & 0xFF
+        prev = line
+
+        samples = []
+        if depth == 8:
+            samples = list(line)
+        else:
+            for byte in line:
+                for shift in range(8 - depth, -1, -depth):
+                    samples.append((byte >> shift) & ((1 << depth) - 1))
+
+        row = []
+        for x in range(width):
+            s = samples[x * channels : (x + 1) * channels]
+            if color == 0:
+                v = s[0] * 255 // ((1 << depth) - 1)
+                row.append((v, v, v, 255))
+            elif color == 2:
+                row.append((s[0], s[1], s[2], 255))
+            elif color == 3:
+                alpha = trns[s[0]] if s[0] < len(trns) else 255
+                row.append(palette[s[0]] + (alpha,))
+            elif color == 4:
+                row.append((s[0], s[0], s[0], s[1]))
+            else:
+                row.append(tuple(s))
+        rows.append(row)
+    return width, height, rows
+
+
+def rasterise(width, height, rows, out_height):
+    """Scale an image to `out_height` pixels tall with a box filter; returns a list of columns of RGB tuples."""
+    out_width = max(1, round(width * out_height / height))
+    columns = []
+    for cx in range(out_width):
+        x0, x1 = cx * width / out_width, (cx + 1) * width / out_width
+        column = []
+        for cy in range(out_height):
+            y0, y1 = cy * height / out_height, (cy + 1) * height / out_height
+            acc = [0.0, 0.0, 0.0]
+            area = 0.0
+            for y in range(int(y0), min(height, int(y1 + 0.999999))):
+                wy = min(y + 1, y1) - max(y, y0)
+                for x in range(int(x0), min(width, int(x1 + 0.999999))):
+                    w = wy * (min(x + 1, x1) - max(x, x0))
+                    r, g, b, a = rows[y][x]
+                    # Transparent pixels are dark LEDs.
+                    acc[0] += w * r * a / 255
+                    acc[1] += w * g * a / 255
+                    acc[2] += w * b * a / 255
+                    area += w
+            column.append(tuple(min(255, round(c / area)) for c in acc))
+        columns.append(column)
+    return columns
+
+
+def quantise(frames, max_colors):
+    """Reduce the colours of a list of frames to at most `max_colors` with median cut."""
+    counts = {}
+    for frame in frames:
+        for column in frame:
+            for px in column:
+                counts[px] = counts.get(px, 0) + 1
+    if len(counts) <= max_colors:
+        return frames
+
+    boxes = [list(counts)]
+    while len(boxes) < max_colors:
+        # Split the box with the widest channel range at its median.
+        def spread(box):
+            return max(max(px[c] for px in box) - min(px[c] for px in box) for c in range(3))
+
+        box = max((b for b in boxes if len(b) > 1), key=spread, default=None)
+        if box is None:
+            break
+        channel = max(range(3), key=lambda c: max(px[c] for px in box) - min(px[c] for px in box))
+        box.sort(key=lambda px: px[channel])
+        boxes.remove(box)
+        boxes += [box[: len(box) // 2], box[len(box) // 2 :]]
+
+    mapping = {}
+    for box in boxes:
+        total = sum(counts[px] for px in box)
+        mean = tuple(round(sum(px[c] * counts[px] for px in box) / total) for c in range(3))
+        for px in box:
+            mapping[px] = mean
+    return [[[mapping[px] for px in column] for column in frame] for frame in frames]
+
+
+def encode(frames, fmt, frame_delay_ms):
+    """Encode a list of frames (each a list of columns) into a .col file."""
+    height = len(frames[0][0])
+    width = len(frames[0])
+    colors = sorted({px for frame in frames for column in frame for px in column})
+
+    if fmt == "auto":
+        fmt = "pal4" if len(colors) <= 16 else "pal8" if len(colors) <= 256 else "rgb"
+    if fmt == "pal4" and len(colors) > 16 or fmt == "pal8" and len(colors) > 256:
+        raise ValueError(f"{len(colors)} colours do not fit in {fmt}")
+
+    if fmt == "rgb":
+        palette = []
+        code = FORMAT_RGB
+        body = bytes(c for frame in frames for column in frame for px in column for c in px)
+    else:
+        palette = colors
+        index = {px: i for i, px in enumerate(colors)}
+        body = bytearray()
+        if fmt == "pal8":
+            code = FORMAT_PAL8
+            for frame in frames:
+                for column in frame:
+                    body += bytes(index[px] for px in column)
+        else:
+            code = FORMAT_PAL4
+            for frame in frames:
+                for column in frame:
+                    # Two pixels per byte, first pixel in the low nibble; columns start on a byte boundary.
+                    for y in range(0, height, 2):
+                        lo = index[column[y]]
+                        hi = index[column[y + 1]] if y + 1 < height else 0
+                        body.append(lo | (hi << 4))
+
+    header = HEADER.pack(MAGIC, VERSION, code, height, width, len(frames), len(palette), frame_delay_ms)
+    return header + bytes(c for px in palette for c in px) + bytes(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--height", type=int, required=True, help="LED count; height of the converted images")
+    parser.add_argument("--format", choices=["auto", "rgb", "pal8", "pal4"], default="auto")
+    parser.add_argument(
+        "--colors", type=int, default=0, help="Quantise to at most this many colours, losing the others; 0 keeps all"
+    )
+    parser.add_argument("--frame-width", type=int, default=0, help="Split images into frames of this many columns")
+    parser.add_argument("--frame-delay", type=int, default=100, help="Time per frame in milliseconds")
+    parser.add_argument("--out", required=True, help="Output directory")
+    parser.add_argument("inputs", nargs="+")
+    args = parser.parse_args()
+
+    os.makedirs(args.out, exist_ok=True)
+    png_bytes = col_bytes = 0
+    for path in args.inputs:
+        name = os.path.basename(path)
+        if os.path.isdir(path) or name.startswith("."):
+            continue
+        if not name.lower().endswith(".png"):
+            shutil.copyfile(path, os.path.join(args.out, name))
+            continue
+
+        columns = rasterise(*read_png(path), args.height)
+        if args.frame_width:
+            frames = [columns[i : i + args.frame_width] for i in range(0, len(columns), args.frame_width)]
+            frames = [f for f in frames if len(f) == args.frame_width]
+        else:
+            frames = [columns]
+        if args.colors:
+            frames = quantise(frames, args.colors)
+        data = encode(frames, args.format, args.frame_delay)
+
+        with open(os.path.join(args.out, os.path.splitext(name)[0] + ".col"), "wb") as f:
+            f.write(data)
+        png_bytes += os.path.getsize(path)
+        col_bytes += len(data)
+
+    if png_bytes:
+        print(f"Converted {png_bytes} bytes of PNG into {col_bytes} bytes of column images", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
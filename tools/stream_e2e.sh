@@ -0,0 +1,79 @@
+#!/usr/bin/env bash
+# SPDX-CopyRightText: 2025 Julian Scheffers
+# SPDX-License-Identifer: MIT
+
+# Tests the LED stream receiver end to end on the host: ledsend.py streams DDP and E1.31 over a network with jitter and
+# loss to stream_recv, which must count exactly the packets that were dropped, show the last frame that was sent and
+# fall back to the effect once the stream stops, or right away when an E1.31 sender says it stopped. Packets for
+# another universe must be ignored.
+# Run with `make streame2e`.
+
+set -euo pipefail
+
+HOST_BUILD=${HOST_BUILD:-build/host}
+TOOLS=$(dirname "$0")
+WORK=$(mktemp -d)
+RECEIVER=
+trap 'test -n "$RECEIVER" && kill "$RECEIVER" 2>/dev/null; rm -rf "$WORK"' EXIT
+
+# Ports that nothing else on the machine is likely to use.
+DDP_PORT=14048
+E131_PORT=15568
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+# Run the receiver for `$1` seconds with the options after it, and stream to it with the ledsend.py options from
+# `$SEND`; the outputs end up in `$WORK/recv.log` and `$WORK/send.log`.
+stream() {
+    local seconds=$1
+    shift
+    "$HOST_BUILD/stream_recv" -d $DDP_PORT -e $E131_PORT -n "$seconds" "$@" > "$WORK/recv.log" &
+    RECEIVER=$!
+    for _ in $(seq 50); do
+        grep -q Listening "$WORK/recv.log" 2>/dev/null && break
+        sleep 0.1
+    done
+    python3 "$TOOLS/ledsend.py" 127.0.0.1 $SEND > "$WORK/send.log"
+    wait $RECEIVER
+    RECEIVER=
+}
+
+# Get the number after `$2` on the line of the receiver's log that starts with `$1`.
+stat() {
+    sed -n "s/^$1: .*\b\([0-9][0-9]*\) $2\b.*/\1/p" "$WORK/recv.log"
+}
+
+# Check that every dropped packet was counted as lost and that the last frame sent was shown.
+check_stream() {
+    local dropped
+    dropped=$(sed -n 's/^Sent .* dropped \([0-9]*\)$/\1/p' "$WORK/send.log")
+    test "$(stat Packets lost)" = "$dropped" || fail "$1: lost $(stat Packets lost) packets, $dropped were dropped"
+    test "$(stat Packets late)" = 0 || fail "$1: packets out of order"
+    test "$(stat Frames shown)" -gt 0 || fail "$1: no frames shown"
+    test "$(grep '^Last frame' "$WORK/send.log")" = "$(grep '^Last frame' "$WORK/recv.log")" ||
+        fail "$1: last frame differs"
+    test "$(stat Frames fallbacks)" = 1 || fail "$1: no fallback after the stream stopped"
+}
+
+SEND="-P ddp -p $DDP_PORT -d 1.5 --jitter 15 --loss 0.1 --seed 1"
+stream 2.5 -t 300
+check_stream DDP
+
+SEND="-P e131 -p $E131_PORT -u 3 -s 4 -d 1.5 --jitter 15 --loss 0.1 --seed 2"
+stream 2.5 -u 3 -s 4 -t 300
+check_stream E1.31
+
+# With a timeout longer than the test, only the end of stream packet can make the receiver fall back.
+SEND="-P e131 -p $E131_PORT -d 1 --terminate"
+stream 2 -t 5000
+check_stream "E1.31 end of stream"
+
+SEND="-P e131 -p $E131_PORT -u 2 -d 0.5"
+stream 1 -u 1
+test "$(stat Packets ignored)" = "$(stat Packets received)" || fail "packets for another universe taken in"
+test "$(stat Frames shown)" = 0 || fail "frames for another universe shown"
+
+echo "OK"